@@ -44,6 +44,7 @@
 #define configUSE_PREEMPTION 1
 #define configUSE_TICKLESS_IDLE 0
 #define configUSE_IDLE_HOOK 0
+#define configUSE_PASSIVE_IDLE_HOOK 0
 #define configUSE_TICK_HOOK 0
 #define configTICK_RATE_HZ ((TickType_t)1000)
 #define configMAX_PRIORITIES 32
@@ -102,10 +103,12 @@
 */
 
 /* SMP port only */
-#define configNUM_CORES 2
+#define configNUMBER_OF_CORES 2
 #define configTICK_CORE 0
 #define configRUN_MULTIPLE_PRIORITIES 1
-#define configUSE_CORE_AFFINITY 0
+#define configUSE_CORE_AFFINITY 1
+/* keep the timer service task off core 1 so it can be dedicated to acquisition */
+#define configTIMER_SERVICE_TASK_CORE_AFFINITY (1 << 0)
 
 /* RP2040 specific */
 #define configSUPPORT_PICO_SYNC_INTEROP 1
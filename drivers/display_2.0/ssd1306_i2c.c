@@ -267,4 +267,15 @@ void SSD1306_update(void) {
     render(ssd1306_buf, &ssd1306_full_area);
 }
 
+void SSD1306_update_page(int page) {
+    struct render_area area = {
+        .start_col = 0,
+        .end_col = SSD1306_WIDTH - 1,
+        .start_page = page,
+        .end_page = page,
+    };
+    calc_render_area_buflen(&area);
+    render(ssd1306_buf + page * SSD1306_WIDTH, &area);
+}
+
 #endif
\ No newline at end of file
@@ -77,6 +77,8 @@ void WriteString(uint8_t *buf, int16_t x, int16_t y, char *str);
 void SSD1306_clear(void);
 void SSD1306_draw_string(int x, int y, char *str);
 void SSD1306_update(void);
+// envia só uma página (8 linhas, SSD1306_WIDTH bytes) do quadro
+void SSD1306_update_page(int page);
 void SSD1306_draw_image_full(const uint8_t *img);
 void SSD1306_draw_image(int x0, int y0, int w, int h, const uint8_t *img);
 
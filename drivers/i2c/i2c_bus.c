@@ -1,11 +1,17 @@
 #include "i2c_bus.h"
 
+static SemaphoreHandle_t i2c_mutex = NULL;
+
 void i2c_bus_init(void) {
     i2c_init(I2C_COM_PORT, I2C_BAUDRATE);
     gpio_set_function(SDA_COM_PIN, GPIO_FUNC_I2C);
     gpio_set_function(SCL_COM_PIN, GPIO_FUNC_I2C);
     gpio_pull_up(SDA_COM_PIN);
     gpio_pull_up(SCL_COM_PIN);
+
+    if (!i2c_mutex) {
+        i2c_mutex = xSemaphoreCreateMutex();
+    }
 }
 
 void i2c_oled_init(void) {
@@ -18,4 +24,12 @@ void i2c_oled_init(void) {
 
 i2c_inst_t* i2c_bus_get(void) {
     return I2C_COM_PORT;
+}
+
+void i2c_bus_lock(void) {
+    xSemaphoreTake(i2c_mutex, portMAX_DELAY);
+}
+
+void i2c_bus_unlock(void) {
+    xSemaphoreGive(i2c_mutex);
 }
\ No newline at end of file
@@ -4,6 +4,9 @@
 #include "hardware/i2c.h"
 #include "hardware/gpio.h"
 
+#include "FreeRTOS.h"
+#include "semphr.h"
+
 #define I2C_COM_PORT i2c0
 #define SDA_COM_PIN  0
 #define SCL_COM_PIN  1
@@ -14,4 +17,8 @@ void i2c_bus_init(void);
 void i2c_oled_init(void);
 i2c_inst_t* i2c_bus_get(void);
 
+// exclusão mútua do barramento entre tarefas (sensores e OLED dividem o i2c0)
+void i2c_bus_lock(void);
+void i2c_bus_unlock(void);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lwip/dns.h"
+
+#include "endpoints.h"
+
+bool endpoints_init(endpoints_t *e, const char *spec, uint16_t default_port, const char *tag) {
+    *e = (endpoints_t) { .tag = tag };
+
+    const char *p = spec;
+    while (p && *p) {
+        const char *end = strchr(p, ',');
+        size_t len = end ? (size_t) (end - p) : strlen(p);
+        const char *colon = memchr(p, ':', len);
+        size_t host_len = colon ? (size_t) (colon - p) : len;
+
+        if (e->count == ENDPOINTS_MAX || host_len == 0 || host_len >= ENDPOINTS_HOST_MAX) {
+            printf("%s: servidor inválido na lista \"%s\"\n", tag, spec);
+            return false;
+        }
+        endpoint_t *ep = &e->list[e->count++];
+        memcpy(ep->host, p, host_len);
+        ep->host[host_len] = '\0';
+        ep->port = default_port;
+        if (colon) {
+            long port = strtol(colon + 1, NULL, 10);
+            if (port <= 0 || port > 65535) {
+                printf("%s: porta inválida em \"%s\"\n", tag, spec);
+                return false;
+            }
+            ep->port = (uint16_t) port;
+        }
+        p = end ? end + 1 : NULL;
+    }
+    return e->count > 0;
+}
+
+void endpoints_reset(endpoints_t *e) {
+    e->current = 0;
+    e->pending = false;
+}
+
+void endpoints_next(endpoints_t *e) {
+    e->pending = false;
+    if (e->count > 1) {
+        e->current = (e->current + 1) % e->count;
+        printf("%s: tentando o servidor %s:%u\n", e->tag, e->list[e->current].host,
+               (unsigned) e->list[e->current].port);
+    }
+}
+
+void endpoints_cancel(endpoints_t *e) {
+    e->pending = false;
+}
+
+const endpoint_t *endpoints_current(const endpoints_t *e) {
+    return &e->list[e->current];
+}
+
+const ip_addr_t *endpoints_addr(const endpoints_t *e) {
+    return &e->list[e->current].last;
+}
+
+// consulta sem resposta (NULL): usa o último endereço bom, se houver
+static bool endpoints_settle(endpoints_t *e, const ip_addr_t *addr) {
+    endpoint_t *ep = &e->list[e->current];
+    if (addr) {
+        ep->last = *addr;
+        ep->have_last = true;
+        return true;
+    }
+    if (ep->have_last) {
+        printf("%s: %s sem resposta do DNS, usando %s\n", e->tag, ep->host, ipaddr_ntoa(&ep->last));
+        return true;
+    }
+    printf("%s: não resolveu %s\n", e->tag, ep->host);
+    endpoints_next(e);
+    return false;
+}
+
+static void endpoints_dns_found(const char *name, const ip_addr_t *addr, void *arg) {
+    endpoints_t *e = arg;
+    // resposta para uma consulta abandonada (ou de outro nome)
+    if (!e->pending || strcmp(name, e->list[e->current].host) != 0) {
+        return;
+    }
+    e->pending = false;
+    bool ok = endpoints_settle(e, addr);
+    if (e->found) {
+        e->found(e, ok);
+    }
+}
+
+endpoints_result_t endpoints_resolve(endpoints_t *e, endpoints_found_fn found) {
+    endpoint_t *ep = &e->list[e->current];
+    if (e->pending) {
+        return ENDPOINTS_PENDING;
+    }
+
+    // IP literal, ou nome no cache do lwIP dentro do TTL: ERR_OK sem consulta
+    ip_addr_t addr;
+    err_t err = dns_gethostbyname(ep->host, &addr, endpoints_dns_found, e);
+    if (err == ERR_OK) {
+        endpoints_settle(e, &addr);
+        return ENDPOINTS_READY;
+    }
+    if (err == ERR_INPROGRESS) {
+        e->pending = true;
+        e->found = found;
+        return ENDPOINTS_PENDING;
+    }
+    return endpoints_settle(e, NULL) ? ENDPOINTS_READY : ENDPOINTS_FAILED;
+}
@@ -0,0 +1,66 @@
+#ifndef ENDPOINTS_H
+#define ENDPOINTS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lwip/ip_addr.h"
+
+// --- servidores por nome, em ordem de preferência ---
+// "host[:porta],host[:porta],..."; host é um IP ou um nome resolvido pelo
+// DNS do lwIP (servidores do DHCP) ou, terminando em .local, por mDNS.
+// A resolução passa sempre pelo cache do lwIP, que respeita o TTL; se a
+// consulta falhar depois do TTL, o último endereço bom do nome ainda é
+// usado (servido vencido) antes de passar ao próximo da lista. Uma conexão
+// que não chega a ser confirmada pelo servidor também passa ao próximo:
+// com dois coletores, o reserva é tentado já na reconexão seguinte
+
+#define ENDPOINTS_MAX        4
+#define ENDPOINTS_HOST_MAX   48
+
+typedef enum {
+    ENDPOINTS_READY = 0,     // endereço em endpoints_addr()
+    ENDPOINTS_PENDING,       // consulta em curso: o callback avisa
+    ENDPOINTS_FAILED,        // nome sem endereço; a lista já passou ao próximo
+} endpoints_result_t;
+
+typedef struct {
+    char host[ENDPOINTS_HOST_MAX];
+    uint16_t port;
+    bool have_last;          // já resolveu alguma vez
+    ip_addr_t last;
+} endpoint_t;
+
+typedef struct endpoints endpoints_t;
+
+// resultado de uma consulta PENDING (contexto do lwIP)
+typedef void (*endpoints_found_fn)(endpoints_t *e, bool ok);
+
+struct endpoints {
+    endpoint_t list[ENDPOINTS_MAX];
+    int count;
+    int current;
+    bool pending;            // consulta de list[current] em curso
+    endpoints_found_fn found;
+    const char *tag;         // prefixo das mensagens
+};
+
+// interpreta a lista; false se vazia ou inválida
+bool endpoints_init(endpoints_t *e, const char *spec, uint16_t default_port, const char *tag);
+
+// link novo: volta ao primeiro da lista e esquece consultas em curso
+void endpoints_reset(endpoints_t *e);
+
+// endereço do atual (com o lwIP travado); `found` só é chamado se PENDING
+endpoints_result_t endpoints_resolve(endpoints_t *e, endpoints_found_fn found);
+
+// a conexão ao atual falhou: o próximo da lista (volta ao início no fim)
+void endpoints_next(endpoints_t *e);
+
+// ignora a resposta da consulta em curso (conexão encerrada)
+void endpoints_cancel(endpoints_t *e);
+
+const endpoint_t *endpoints_current(const endpoints_t *e);
+const ip_addr_t *endpoints_addr(const endpoints_t *e);
+
+#endif
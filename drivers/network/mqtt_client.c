@@ -0,0 +1,684 @@
+#include "pico/time.h"
+#include "pico/unique_id.h"
+
+#include "mqtt_client.h"
+#include "station_config.h"
+#include "reconnect.h"
+#include "net_health.h"
+#include "endpoints.h"
+
+// tipos de pacote (byte 0, nibble alto)
+#define MQTT_CONNECT     0x10
+#define MQTT_CONNACK     0x20
+#define MQTT_PUBLISH     0x30
+#define MQTT_PUBACK      0x40
+#define MQTT_PINGREQ     0xC0
+#define MQTT_PINGRESP    0xD0
+#define MQTT_DISCONNECT  0xE0
+
+#define MQTT_FLAG_DUP    0x08
+#define MQTT_TOPIC_MAX   64
+
+static struct tcp_pcb *mqtt_pcb = NULL;
+static endpoints_t brokers;
+static bool mqtt_connected = false;   // CONNACK aceito
+static bool mqtt_trying = false;
+
+// próxima tentativa de conexão (backoff e disjuntor, como no tcp_client)
+static reconnect_t reconnect;
+static net_meter_t meter;
+
+// PUBLISH prontos, na ordem de envio; pin_inflight como no tcp_client
+static outbox_t outbox;
+static bool outbox_ready = false;
+
+static char client_id[8 + 2 * PICO_UNIQUE_BOARD_ID_SIZE_BYTES + 1];
+static char topic_base[sizeof(MQTT_TOPIC_PREFIX) + 2 * PICO_UNIQUE_BOARD_ID_SIZE_BYTES + 1];
+static uint16_t next_packet_id = 1;
+static uint8_t packet_buf[OUTBOX_RECORD_MAX];
+
+// lote em formação, como no tcp_client
+static uint32_t batch_count;
+static uint32_t batch_bytes;
+static uint32_t batch_since_ms;
+static bool batch_release;
+
+// fim (outbox.head) dos PUBLISH atrasados por uma queda, como em tcp_client
+static uint32_t late_mark;
+
+// tudo o que foi escrito no TCP, na ordem do stream: pacotes de controle
+// (CONNECT, PINGREQ) e PUBLISH. Um PUBLISH sai da fila quando o TCP
+// confirmou os bytes dele e, em QoS 1, chegou o PUBACK
+typedef struct {
+    uint16_t packet_id;   // 0: QoS 0
+    uint16_t len;
+    uint16_t unacked;     // bytes ainda sem confirmação do TCP
+    bool publish;
+    bool puback;
+} mqtt_pending_t;
+
+#define MQTT_PENDING_MAX  (MQTT_INFLIGHT + 4)
+
+static mqtt_pending_t pending[MQTT_PENDING_MAX];
+static uint32_t pending_head, pending_count, pending_publish;
+
+// PUBLISH do início da fila que já foram enviados antes de uma queda
+static uint32_t resend_count;
+
+// keep-alive
+static uint32_t last_tx_ms;
+static uint32_t ping_sent_ms;
+static bool ping_out;
+
+// pacote chegando do broker: só os primeiros bytes do corpo interessam
+static uint8_t rx_type;
+static uint8_t rx_stage;      // 0 = tipo, 1 = tamanho, 2 = corpo
+static uint32_t rx_rem, rx_mult, rx_have;
+static uint8_t rx_body[4];
+
+static bool mqtt_client_write(const outbox_span_t *span, int n, uint8_t flags);
+static err_t mqtt_client_output(void);
+
+static mqtt_pending_t *pending_at(uint32_t i) {
+    return &pending[(pending_head + i) % MQTT_PENDING_MAX];
+}
+
+static void mqtt_client_lost(void) {
+    if (mqtt_pcb != NULL && !reconnect.healthy) {
+        endpoints_next(&brokers);   // sem CONNACK: a próxima vai ao reserva
+    }
+    if (mqtt_pcb != NULL || mqtt_trying) {
+        reconnect_lost(&reconnect, to_ms_since_boot(get_absolute_time()));
+    }
+    endpoints_cancel(&brokers);
+    mqtt_connected = false;
+    mqtt_trying = false;
+    mqtt_pcb = NULL;
+    outbox_rewind(&outbox);
+    late_mark = outbox.head;
+    batch_release = true;
+    resend_count += pending_publish;
+    pending_head = pending_count = pending_publish = 0;
+    rx_stage = 0;
+    ping_out = false;
+}
+
+// tamanho restante do pacote, em base 128; retorna quantos bytes usou
+static int put_varint(uint8_t *p, uint32_t v) {
+    int n = 0;
+    do {
+        uint8_t b = v % 128;
+        v /= 128;
+        p[n++] = v ? (b | 0x80) : b;
+    } while (v);
+    return n;
+}
+
+static uint8_t *put_str(uint8_t *p, const char *s, uint16_t len) {
+    *p++ = (uint8_t) (len >> 8);
+    *p++ = (uint8_t) len;
+    memcpy(p, s, len);
+    return p + len;
+}
+
+// byte `i` de um pacote guardado em um ou dois trechos
+static uint8_t span_byte(const outbox_span_t *span, uint32_t i) {
+    return i < span[0].len ? span[0].data[i] : span[1].data[i - span[0].len];
+}
+
+// packet id de um PUBLISH guardado (0 em QoS 0)
+static uint16_t publish_id(const outbox_span_t *span) {
+    if (!(span_byte(span, 0) & 0x06)) {
+        return 0;
+    }
+    uint32_t i = 1;
+    while (span_byte(span, i) & 0x80) i++;
+    i++;
+    uint32_t topic = (span_byte(span, i) << 8) | span_byte(span, i + 1);
+    i += 2 + topic;
+    return (uint16_t) ((span_byte(span, i) << 8) | span_byte(span, i + 1));
+}
+
+// registra no stream um pacote de controle (com cópia) ou um PUBLISH
+static void pending_push(uint16_t packet_id, uint16_t len, bool publish) {
+    *pending_at(pending_count) = (mqtt_pending_t) { packet_id, len, len, publish, false };
+    pending_count++;
+    if (publish) {
+        pending_publish++;
+    }
+    last_tx_ms = to_ms_since_boot(get_absolute_time());
+}
+
+// libera da fila, em ordem, o que o TCP e o broker já confirmaram
+static void pending_release(void) {
+    while (pending_count > 0) {
+        mqtt_pending_t *p = pending_at(0);
+        if (p->unacked > 0 || (p->packet_id != 0 && !p->puback)) {
+            return;
+        }
+        if (p->publish) {
+            outbox_ack(&outbox, p->len);
+            pending_publish--;
+        }
+        pending_head = (pending_head + 1) % MQTT_PENDING_MAX;
+        pending_count--;
+    }
+}
+
+static bool mqtt_client_control(const uint8_t *pkt, uint16_t len) {
+    if (pending_count == MQTT_PENDING_MAX) {
+        return false;
+    }
+    outbox_span_t span = { pkt, len };
+    if (!mqtt_client_write(&span, 1, TCP_WRITE_FLAG_COPY)) {
+        return false;
+    }
+    pending_push(0, len, false);
+    return true;
+}
+
+static void mqtt_client_send_connect(void) {
+    uint8_t pkt[16 + sizeof(client_id)];
+    uint16_t id_len = (uint16_t) strlen(client_id);
+    uint8_t *p = pkt + 2;
+
+    p = put_str(p, "MQTT", 4);
+    *p++ = 4;                                  // 3.1.1
+    *p++ = 0x02;                               // clean session
+    *p++ = (uint8_t) (MQTT_KEEPALIVE_S >> 8);
+    *p++ = (uint8_t) MQTT_KEEPALIVE_S;
+    p = put_str(p, client_id, id_len);
+
+    pkt[0] = MQTT_CONNECT;
+    pkt[1] = (uint8_t) (p - pkt - 2);
+    if (!mqtt_client_control(pkt, (uint16_t) (p - pkt))) {
+        printf("mqtt_client: falha ao enviar CONNECT\n");
+    }
+    tcp_output(mqtt_pcb);
+}
+
+// pacote completo do broker
+static void mqtt_client_dispatch(void) {
+    switch (rx_type & 0xF0) {
+    case MQTT_CONNACK:
+        if (rx_have >= 2 && rx_body[1] == 0) {
+            mqtt_connected = true;
+            reconnect_success(&reconnect);
+            printf("MQTT conectado ao broker %s:%u (%lu na fila)\n", endpoints_current(&brokers)->host,
+                   (unsigned) endpoints_current(&brokers)->port, (unsigned long) mqtt_client_backlog());
+        }
+        else {
+            printf("mqtt_client: broker recusou a conexão (%d)\n", rx_have >= 2 ? rx_body[1] : -1);
+        }
+        break;
+
+    case MQTT_PUBACK:
+        if (rx_have >= 2) {
+            uint16_t id = (uint16_t) ((rx_body[0] << 8) | rx_body[1]);
+            for (uint32_t i = 0; i < pending_count; i++) {
+                if (pending_at(i)->publish && pending_at(i)->packet_id == id) {
+                    pending_at(i)->puback = true;
+                    break;
+                }
+            }
+            pending_release();
+        }
+        break;
+
+    case MQTT_PINGRESP:
+        ping_out = false;
+        break;
+
+    default:
+        break;   // não assinamos nada
+    }
+}
+
+static void mqtt_client_rx(const uint8_t *p, uint32_t n) {
+    for (uint32_t k = 0; k < n; k++) {
+        uint8_t b = p[k];
+        switch (rx_stage) {
+        case 0:
+            rx_type = b;
+            rx_rem = 0;
+            rx_mult = 1;
+            rx_stage = 1;
+            break;
+        case 1:
+            rx_rem += (b & 0x7F) * rx_mult;
+            rx_mult *= 128;
+            if (!(b & 0x80)) {
+                rx_have = 0;
+                rx_stage = 2;
+                if (rx_rem == 0) {
+                    mqtt_client_dispatch();
+                    rx_stage = 0;
+                }
+            }
+            break;
+        default:
+            if (rx_have < sizeof(rx_body)) {
+                rx_body[rx_have] = b;
+            }
+            if (++rx_have == rx_rem) {
+                if (rx_have > sizeof(rx_body)) rx_have = sizeof(rx_body);
+                mqtt_client_dispatch();
+                rx_stage = 0;
+            }
+            break;
+        }
+    }
+}
+
+/* ------------- TCP callbacks --------------- */
+
+static err_t mqtt_client_connected_cb(void *arg, struct tcp_pcb *tpcb, err_t err) {
+    (void) arg;
+    (void) tpcb;
+
+    if (err != ERR_OK) {
+        printf("mqtt_client: erro ao conectar: %d\n", err);
+        mqtt_trying = false;
+        return err;
+    }
+    mqtt_trying = false;
+    net_meter_reset(&meter);
+    mqtt_client_send_connect();
+    return mqtt_pcb == NULL ? ERR_ABRT : ERR_OK;   // abortado no tcp_write
+}
+
+static void mqtt_client_err(void *arg, err_t err) {
+    (void) arg;
+    printf("mqtt_client: conexão encerrada com erro %d\n", err);
+    mqtt_client_lost();
+}
+
+// keep-alive e envios parados
+static err_t mqtt_client_poll(void *arg, struct tcp_pcb *tpcb) {
+    (void) arg;
+
+    if (!mqtt_connected) {
+        return ERR_OK;
+    }
+    uint32_t now = to_ms_since_boot(get_absolute_time());
+    if (ping_out && now - ping_sent_ms > MQTT_KEEPALIVE_S * 1000u / 2) {
+        // broker mudo: derruba e reconecta
+        printf("mqtt_client: sem PINGRESP, reconectando\n");
+        tcp_abort(tpcb);   // chama mqtt_client_err
+        return ERR_ABRT;
+    }
+    if (!ping_out && now - last_tx_ms >= MQTT_KEEPALIVE_S * 1000u / 2) {
+        static const uint8_t pingreq[2] = { MQTT_PINGREQ, 0 };
+        if (mqtt_client_control(pingreq, sizeof(pingreq))) {
+            ping_out = true;
+            ping_sent_ms = now;
+            tcp_output(tpcb);
+        }
+        else if (mqtt_pcb == NULL) {
+            return ERR_ABRT;
+        }
+    }
+    return mqtt_client_output();
+}
+
+// o TCP confirmou bytes: abate na ordem do stream
+static err_t mqtt_client_sent(void *arg, struct tcp_pcb *tpcb, u16_t len) {
+    (void) arg;
+    (void) tpcb;
+
+    net_meter_acked(&meter, len, to_ms_since_boot(get_absolute_time()));
+
+    for (uint32_t i = 0; i < pending_count && len > 0; i++) {
+        mqtt_pending_t *p = pending_at(i);
+        uint16_t k = len < p->unacked ? len : p->unacked;
+        p->unacked -= k;
+        len -= k;
+    }
+    pending_release();
+    return mqtt_client_output();
+}
+
+static err_t mqtt_client_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err) {
+    (void) arg;
+
+    if (p == NULL) {
+        printf("mqtt_client: conexão fechada pelo broker\n");
+        tcp_abort(tpcb);   // chama mqtt_client_err
+        return ERR_ABRT;
+    }
+    if (err != ERR_OK) {
+        pbuf_free(p);
+        return ERR_OK;
+    }
+
+    for (struct pbuf *q = p; q != NULL; q = q->next) {
+        mqtt_client_rx((const uint8_t *) q->payload, q->len);
+    }
+    tcp_recved(tpcb, p->tot_len);
+    pbuf_free(p);
+
+    return mqtt_client_output();
+}
+
+/* ------------- API ---------------- */
+
+bool mqtt_client_init(void) {
+    if (outbox_ready) {
+        return true;
+    }
+    outbox_init(&outbox, TCP_OUTBOX_POLICY);
+    outbox.pin_inflight = TCP_ZERO_COPY;
+    outbox_ready = true;
+
+    char id[2 * PICO_UNIQUE_BOARD_ID_SIZE_BYTES + 1];
+    pico_get_unique_board_id_string(id, sizeof(id));
+    snprintf(client_id, sizeof(client_id), "solar-%s", id);
+    snprintf(topic_base, sizeof(topic_base), "%s/%s", MQTT_TOPIC_PREFIX, id);
+
+    uint32_t seed = 2166136261u;
+    for (const char *c = id; *c; c++) seed = (seed ^ (uint8_t) *c) * 16777619u;
+    reconnect_init(&reconnect, seed);
+
+    return endpoints_init(&brokers, MQTT_BROKER_ENDPOINTS, MQTT_BROKER_PORT, "mqtt_client");
+}
+
+bool mqtt_client_connected(void) {
+    return mqtt_connected;
+}
+
+bool mqtt_client_active(void) {
+    return mqtt_pcb != NULL || mqtt_trying;
+}
+
+static void mqtt_client_open(void) {
+    if (mqtt_pcb) {
+        return;
+    }
+    mqtt_pcb = tcp_new_ip_type(IPADDR_TYPE_V4);
+    if (!mqtt_pcb) {
+        printf("mqtt_client_start: erro ao criar PCB\n");
+        mqtt_trying = false;
+        reconnect_lost(&reconnect, to_ms_since_boot(get_absolute_time()));
+        return;
+    }
+    tcp_arg(mqtt_pcb, NULL);
+    tcp_err(mqtt_pcb, mqtt_client_err);
+    tcp_poll(mqtt_pcb, mqtt_client_poll, 4);
+    tcp_sent(mqtt_pcb, mqtt_client_sent);
+    tcp_recv(mqtt_pcb, mqtt_client_recv);
+
+    err_t err = tcp_connect(mqtt_pcb, endpoints_addr(&brokers), endpoints_current(&brokers)->port,
+                            mqtt_client_connected_cb);
+    if (err != ERR_OK) {
+        printf("mqtt_client_start: falha tcp_connect: %d\n", err);
+        tcp_abort(mqtt_pcb);   // chama mqtt_client_err
+        return;
+    }
+    mqtt_trying = true;
+}
+
+static void mqtt_client_resolved(endpoints_t *e, bool ok) {
+    (void) e;
+    mqtt_trying = false;
+    if (ok) {
+        mqtt_client_open();
+    }
+    else {
+        reconnect_lost(&reconnect, to_ms_since_boot(get_absolute_time()));
+    }
+}
+
+// resolve o broker atual (endpoints.h) e conecta
+static void mqtt_client_connect(void) {
+    if (mqtt_pcb || mqtt_trying) {
+        return;
+    }
+    reconnect_attempt(&reconnect);
+
+    switch (endpoints_resolve(&brokers, mqtt_client_resolved)) {
+    case ENDPOINTS_READY:
+        mqtt_client_open();
+        break;
+    case ENDPOINTS_PENDING:
+        mqtt_trying = true;
+        break;
+    default:
+        reconnect_lost(&reconnect, to_ms_since_boot(get_absolute_time()));
+        break;
+    }
+}
+
+void mqtt_client_start(void) {
+    reconnect_reset(&reconnect);
+    endpoints_reset(&brokers);
+    mqtt_client_connect();
+}
+
+void mqtt_client_try_reconnect(void) {
+    if (!mqtt_trying && mqtt_pcb == NULL && reconnect_due(&reconnect, to_ms_since_boot(get_absolute_time()))) {
+        mqtt_client_connect();
+    }
+}
+
+uint32_t mqtt_client_reconnect_due_ms(uint32_t now_ms) {
+    return reconnect_wait_ms(&reconnect, now_ms);
+}
+
+const reconnect_stats_t *mqtt_client_reconnect_stats(void) {
+    return &reconnect.stats;
+}
+
+void mqtt_client_health(net_health_t *h) {
+    net_meter_report(&meter, h);
+    h->conn_attempts = reconnect.stats.attempts;
+    h->conn_failures = reconnect.stats.failures;
+    h->backlog = mqtt_client_backlog();
+}
+
+void mqtt_client_close(void) {
+    if (mqtt_pcb) {
+        tcp_err(mqtt_pcb, NULL);
+        tcp_sent(mqtt_pcb, NULL);
+        tcp_recv(mqtt_pcb, NULL);
+        tcp_poll(mqtt_pcb, NULL, 0);
+        // sem cópia, dados em voo ainda são referenciados: aborta
+        bool referenced = TCP_ZERO_COPY && outbox_in_flight(&outbox);
+        if (!referenced && mqtt_connected) {
+            static const uint8_t disconnect[2] = { MQTT_DISCONNECT, 0 };
+            mqtt_client_control(disconnect, sizeof(disconnect));
+        }
+        if (mqtt_pcb != NULL && (referenced || tcp_close(mqtt_pcb) != ERR_OK)) {
+            tcp_abort(mqtt_pcb);
+        }
+    }
+    mqtt_client_lost();
+}
+
+// monta o PUBLISH na fila; o packet id acompanha o registro até o PUBACK
+static void mqtt_client_publish(const char *topic, const void *payload, size_t len) {
+    if (!outbox_ready) return;
+
+    uint16_t topic_len = (uint16_t) strlen(topic);
+    uint32_t rem = 2 + topic_len + (MQTT_QOS ? 2 : 0) + len;
+    if (rem + 5 > sizeof(packet_buf)) {
+        printf("mqtt_client: mensagem grande demais (%u bytes)\n", (unsigned) len);
+        return;
+    }
+
+    uint8_t *p = packet_buf;
+    *p++ = MQTT_PUBLISH | (MQTT_QOS << 1);
+    p += put_varint(p, rem);
+    p = put_str(p, topic, topic_len);
+    if (MQTT_QOS) {
+        *p++ = (uint8_t) (next_packet_id >> 8);
+        *p++ = (uint8_t) next_packet_id;
+        if (++next_packet_id == 0) next_packet_id = 1;
+    }
+    memcpy(p, payload, len);
+    p += len;
+
+    uint16_t n = (uint16_t) (p - packet_buf);
+    if (!outbox_push(&outbox, packet_buf, n) && TCP_OUTBOX_POLICY == OUTBOX_DROP_NEWEST) {
+        printf("mqtt_client: fila cheia, mensagem descartada\n");
+    }
+    if (!mqtt_connected) {
+        late_mark = outbox.head;
+    }
+    if (batch_count++ == 0) {
+        batch_since_ms = to_ms_since_boot(get_absolute_time());
+    }
+    batch_bytes += n;
+}
+
+static void mqtt_client_kick(void) {
+    if (mqtt_connected) {
+        mqtt_client_flush();
+    }
+    else {
+        mqtt_client_try_reconnect();
+    }
+}
+
+void mqtt_client_send_sample(const telemetry_sample_t *s, bool pend) {
+    char topic[MQTT_TOPIC_MAX];
+
+#if MQTT_PER_FIELD
+    (void) pend;
+    for (int i = 0; i < TELEMETRY_FIELDS; i++) {
+        const char *name;
+        char value[24];
+        int len = telemetry_format_field(s, i, &name, value, sizeof(value));
+        if (len > 0) {
+            snprintf(topic, sizeof(topic), "%s/%s", topic_base, name);
+            mqtt_client_publish(topic, value, (size_t) len);
+        }
+    }
+#else
+    uint8_t payload[512];
+    int len = telemetry_encode(s, pend, payload, sizeof(payload));
+    if (len > 0) {
+        snprintf(topic, sizeof(topic), "%s/telemetry", topic_base);
+        mqtt_client_publish(topic, payload, (size_t) len);
+    }
+#endif
+    mqtt_client_kick();
+}
+
+void mqtt_client_send(const char *msg) {
+    if (!msg) return;
+    char topic[MQTT_TOPIC_MAX];
+    snprintf(topic, sizeof(topic), "%s/log", topic_base);
+    mqtt_client_publish(topic, msg, strlen(msg));
+    mqtt_client_kick();
+}
+
+void mqtt_client_send_health(const char *json) {
+    char topic[MQTT_TOPIC_MAX];
+    snprintf(topic, sizeof(topic), "%s/health", topic_base);
+    mqtt_client_publish(topic, json, strlen(json));
+    mqtt_client_kick();
+}
+
+// como tcp_client_write: false se não coube ou se a conexão caiu (pcb
+// abortado; num callback, quem chamou devolve ERR_ABRT)
+static bool mqtt_client_write(const outbox_span_t *span, int n, uint8_t flags) {
+    uint32_t len = span[0].len + (n > 1 ? span[1].len : 0);
+    if (len > tcp_sndbuf(mqtt_pcb) || tcp_sndqueuelen(mqtt_pcb) + 2 * n > TCP_SND_QUEUELEN) {
+        return false;
+    }
+
+    for (int i = 0; i < n; i++) {
+        u8_t f = flags | (i + 1 < n ? TCP_WRITE_FLAG_MORE : 0);
+        err_t err = tcp_write(mqtt_pcb, span[i].data, span[i].len, f);
+        if (err == ERR_MEM && i == 0) {
+            return false;
+        }
+        if (err != ERR_OK) {
+            printf("mqtt_client: erro ao tcp_write: %d\n", err);
+            tcp_abort(mqtt_pcb);   // chama mqtt_client_err
+            mqtt_pcb = NULL;       // no mqtt_client_close o err já foi desligado
+            return false;
+        }
+        net_meter_written(&meter, span[i].len, to_ms_since_boot(get_absolute_time()));
+    }
+    return true;
+}
+
+static bool mqtt_client_batch_ready(void) {
+    if (batch_release || batch_count >= station_config.batch_records || batch_bytes >= TCP_MSS) {
+        return true;
+    }
+    return batch_count > 0 && mqtt_client_batch_due_ms(to_ms_since_boot(get_absolute_time())) == 0;
+}
+
+uint32_t mqtt_client_batch_due_ms(uint32_t now_ms) {
+    if (batch_count == 0 || batch_release) {
+        return UINT32_MAX;
+    }
+    uint32_t age = now_ms - batch_since_ms;
+    uint32_t delay = station_config.batch_delay_ms;
+    return age >= delay ? 0 : delay - age;
+}
+
+// como tcp_client_output: ERR_ABRT se a conexão caiu no meio do lote
+static err_t mqtt_client_output(void) {
+    if (!outbox_ready || !mqtt_connected || mqtt_pcb == NULL || !mqtt_client_batch_ready()) {
+        return ERR_OK;
+    }
+    batch_release = true;
+
+    bool wrote = false;
+    outbox_span_t span[2];
+    int n;
+    while (pending_publish < MQTT_INFLIGHT && pending_count < MQTT_PENDING_MAX &&
+           (n = outbox_peek(&outbox, span)) > 0) {
+        uint16_t id = publish_id(span);
+
+        // reenvio após queda: o broker pode já ter recebido. O registro
+        // voltou com o rewind, então nenhum pcb referencia esses bytes
+        bool resend = resend_count > 0;
+        if (resend && id != 0) {
+            ((uint8_t *) span[0].data)[0] |= MQTT_FLAG_DUP;
+        }
+
+        u8_t flags = (TCP_ZERO_COPY ? 0 : TCP_WRITE_FLAG_COPY) |
+                     (outbox_next_is_last(&outbox) ? 0 : TCP_WRITE_FLAG_MORE);
+        if (!mqtt_client_write(span, n, flags)) {
+            break;
+        }
+        outbox_advance(&outbox);
+        pending_push(id, (uint16_t) (span[0].len + (n > 1 ? span[1].len : 0)), true);
+        if (resend) {
+            resend_count--;
+        }
+        wrote = true;
+    }
+
+    if (mqtt_pcb == NULL) {
+        return ERR_ABRT;
+    }
+    if (!outbox_has_unsent(&outbox)) {
+        batch_count = 0;
+        batch_bytes = 0;
+        batch_release = false;
+    }
+    if (wrote) {
+        tcp_output(mqtt_pcb);
+    }
+    return ERR_OK;
+}
+
+// fora dos callbacks (tarefa de rede)
+void mqtt_client_flush(void) {
+    if (mqtt_client_output() == ERR_ABRT) {
+        mqtt_client_try_reconnect();
+    }
+}
+
+uint32_t mqtt_client_backlog(void) {
+    return outbox_ready ? outbox.stats.depth : 0;
+}
+
+bool mqtt_client_late(void) {
+    return outbox_ready && outbox_holds(&outbox, late_mark);
+}
@@ -0,0 +1,103 @@
+#ifndef MQTT_CLIENT_H
+#define MQTT_CLIENT_H
+
+#include <stdbool.h>
+
+#include "pico/cyw43_arch.h"
+
+#include "lwip/pbuf.h"
+#include "lwip/tcp.h"
+#include "lwip/err.h"
+#include "lwip/ip_addr.h"
+
+#include "outbox.h"
+#include "tcp_client.h"
+#include "reconnect.h"
+#include "net_health.h"
+#include "drivers/telemetry/telemetry.h"
+
+// --- MQTT 3.1.1 sobre a raw API do lwIP (alternativo ao tcp_client) ---
+// Cada registro vira um PUBLISH pronto na fila de saída (com packet id), que
+// sai sem cópia e em pipeline: até MQTT_INFLIGHT publicações aguardando o
+// broker. QoS 1 libera o registro no PUBACK; QoS 0, quando o TCP confirma.
+// Após uma queda, o que não foi confirmado sai de novo com DUP.
+
+#ifndef MQTT_BROKER_IP
+#define MQTT_BROKER_IP      SERVER_IP
+#endif
+#ifndef MQTT_BROKER_PORT
+#define MQTT_BROKER_PORT    1883
+#endif
+// brokers em ordem de preferência, como SERVER_ENDPOINTS
+#ifndef MQTT_BROKER_ENDPOINTS
+#define MQTT_BROKER_ENDPOINTS MQTT_BROKER_IP
+#endif
+
+#ifndef MQTT_QOS
+#define MQTT_QOS            1       // 0 ou 1
+#endif
+#ifndef MQTT_INFLIGHT
+#define MQTT_INFLIGHT       16      // publicações aguardando o broker
+#endif
+#ifndef MQTT_KEEPALIVE_S
+#define MQTT_KEEPALIVE_S    60
+#endif
+
+// tópicos: <prefixo>/<id da placa>/telemetry com o registro inteiro (JSON
+// ou binário), ou, com MQTT_PER_FIELD, um tópico por campo (.../lux1, ...)
+// com o valor em texto (null se a leitura é inválida); net_send publica em .../log
+#ifndef MQTT_TOPIC_PREFIX
+#define MQTT_TOPIC_PREFIX   "solar"
+#endif
+#ifndef MQTT_PER_FIELD
+#define MQTT_PER_FIELD      0
+#endif
+
+// prepara a fila e o id do cliente (tarefa, antes do primeiro envio);
+// false se MQTT_BROKER_ENDPOINTS é inválida
+bool mqtt_client_init(void);
+
+// (re)conecta ao broker; chamado quando o link sobe (zera a agenda de
+// reconexão, reconnect.h)
+void mqtt_client_start(void);
+void mqtt_client_close(void);
+
+// nova tentativa, se desconectado e a agenda permitir
+void mqtt_client_try_reconnect(void);
+
+// ms até a agenda permitir a próxima tentativa (0 = já pode, UINT32_MAX =
+// nada agendado)
+uint32_t mqtt_client_reconnect_due_ms(uint32_t now_ms);
+const reconnect_stats_t *mqtt_client_reconnect_stats(void);
+
+// parte do transporte no registro de saúde (como tcp_client_health)
+void mqtt_client_health(net_health_t *h);
+
+// sessão aceita pelo broker (CONNACK recebido)
+bool mqtt_client_connected(void);
+
+// há um pcb ou uma tentativa em andamento (resolução do nome, conexão)
+bool mqtt_client_active(void);
+
+// enfileira uma amostra (registro inteiro ou um PUBLISH por campo)
+void mqtt_client_send_sample(const telemetry_sample_t *s, bool pend);
+
+// enfileira um texto em .../log
+void mqtt_client_send(const char *msg);
+
+// enfileira o registro de saúde (net_health) em .../health
+void mqtt_client_send_health(const char *json);
+
+// envia os PUBLISH pendentes que couberem, se o lote estiver pronto
+void mqtt_client_flush(void);
+
+// ms até o lote aberto vencer (UINT32_MAX se não há lote esperando)
+uint32_t mqtt_client_batch_due_ms(uint32_t now_ms);
+
+// registros aguardando envio ou confirmação
+uint32_t mqtt_client_backlog(void);
+
+// há PUBLISH atrasados por uma queda (como tcp_client_late)
+bool mqtt_client_late(void);
+
+#endif // MQTT_CLIENT_H
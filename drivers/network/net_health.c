@@ -0,0 +1,102 @@
+#include <stdio.h>
+
+#include "pico/cyw43_arch.h"
+#include "lwip/stats.h"
+
+#include "net_health.h"
+#include "wifi_manager.h"
+
+void net_meter_reset(net_meter_t *m) {
+    m->written = m->acked = 0;
+    m->timing = false;
+}
+
+void net_meter_written(net_meter_t *m, uint32_t len, uint32_t now_ms) {
+    m->written += len;
+    if (!m->timing) {
+        m->mark = m->written;
+        m->mark_ms = now_ms;
+        m->timing = true;
+    }
+    if (m->written - m->acked > m->sndbuf_max) {
+        m->sndbuf_max = m->written - m->acked;
+    }
+}
+
+void net_meter_acked(net_meter_t *m, uint32_t len, uint32_t now_ms) {
+    m->acked += len;
+    if (m->timing && (int32_t) (m->acked - m->mark) >= 0) {
+        uint32_t rtt = now_ms - m->mark_ms;
+        m->srtt_ms = m->srtt_ms ? m->srtt_ms + ((int32_t) (rtt - m->srtt_ms)) / 8 : (rtt ? rtt : 1);
+        m->timing = false;
+    }
+}
+
+void net_meter_report(net_meter_t *m, net_health_t *h) {
+    h->rtt_ms = m->srtt_ms;
+    h->sndbuf_max = m->sndbuf_max;
+    m->sndbuf_max = m->written - m->acked;
+}
+
+void net_health_read(net_health_t *h, bool link) {
+    *h = (net_health_t) { 0 };
+
+    int32_t rssi;
+    if (link && cyw43_wifi_get_rssi(&cyw43_state, &rssi) == 0) {
+        h->rssi_ok = true;
+        h->rssi_dbm = rssi;
+    }
+    h->wifi_losses = wifi_manager_stats()->link_losses;
+
+#if LWIP_STATS
+    h->stats = true;
+#if MIB2_STATS
+    h->tcp_segs = lwip_stats.mib2.tcpoutsegs;
+    h->tcp_rexmit = lwip_stats.mib2.tcpretranssegs;
+#endif
+#if MEMP_STATS
+    h->pbuf_pool_max = lwip_stats.memp[MEMP_PBUF_POOL]->max;
+    h->pbuf_ref_max = lwip_stats.memp[MEMP_PBUF]->max;
+    h->tcp_seg_max = lwip_stats.memp[MEMP_TCP_SEG]->max;
+#endif
+#if MEM_STATS
+    h->mem_max = lwip_stats.mem.max;
+#endif
+#endif
+}
+
+// número ou null
+static int put_field(char *buf, size_t len, const char *name, bool valid, long v, const char *sep) {
+    return valid ? snprintf(buf, len, "\"%s\": %ld%s", name, v, sep)
+                 : snprintf(buf, len, "\"%s\": null%s", name, sep);
+}
+
+int net_health_format_json(const net_health_t *h, char *buf, size_t len) {
+    struct {
+        const char *name;
+        bool valid;
+        long v;
+    } f[] = {
+        { "rssi",       h->rssi_ok,     h->rssi_dbm },
+        { "rtt_ms",     h->rtt_ms != 0, (long) h->rtt_ms },
+        { "sndbuf_max", true,           (long) h->sndbuf_max },
+        { "conn",       true,           (long) h->conn_attempts },
+        { "conn_fail",  true,           (long) h->conn_failures },
+        { "wifi_loss",  true,           (long) h->wifi_losses },
+        { "backlog",    true,           (long) h->backlog },
+        { "acq_drop",   true,           (long) h->acq_dropped },
+        { "tcp_segs",   h->stats,       (long) h->tcp_segs },
+        { "rexmit",     h->stats,       (long) h->tcp_rexmit },
+        { "pbuf_max",   h->stats,       (long) h->pbuf_pool_max },
+        { "pbuf_ref_max", h->stats,     (long) h->pbuf_ref_max },
+        { "seg_max",    h->stats,       (long) h->tcp_seg_max },
+        { "mem_max",    h->stats,       (long) h->mem_max },
+    };
+    const int count = (int) (sizeof(f) / sizeof(f[0]));
+
+    int n = snprintf(buf, len, "{ \"health\": { ");
+    for (int i = 0; i < count && n > 0 && (size_t) n < len; i++) {
+        n += put_field(buf + n, len - n, f[i].name, f[i].valid, f[i].v, i + 1 < count ? ", " : " } }");
+    }
+    return (n > 0 && (size_t) n < len) ? n : -1;
+}
@@ -0,0 +1,67 @@
+#ifndef NET_HEALTH_H
+#define NET_HEALTH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// --- saúde do link e do transporte ---
+// Um registro JSON a cada station_config.health_period_ms, na mesma fila
+// da telemetria (e com seq, no TCP): lacunas nos dados podem ser cruzadas
+// com o rádio e com a pilha. Campos sem leitura vão como null
+
+#ifndef HEALTH_PERIOD_MS
+#define HEALTH_PERIOD_MS      60000
+#endif
+
+#define NET_HEALTH_JSON_MAX   352
+
+typedef struct {
+    bool rssi_ok;            // sem link (ou sem resposta do rádio) o RSSI vai null
+    int32_t rssi_dbm;
+    uint32_t rtt_ms;         // RTT suavizado do transporte (0 = sem amostra)
+    uint32_t sndbuf_max;     // maior ocupação do buffer de envio do TCP (bytes) no período
+    uint32_t conn_attempts;  // conexões iniciadas (reconnect.h)
+    uint32_t conn_failures;
+    uint32_t wifi_losses;    // quedas do Wi-Fi (wifi_manager)
+    uint32_t backlog;        // registros aguardando envio ou confirmação
+    uint32_t acq_dropped;    // amostras perdidas entre a aquisição e a rede (desde o boot)
+
+    // lwIP (LWIP_STATS); `stats` false sem eles
+    bool stats;
+    uint32_t tcp_segs;       // segmentos TCP enviados
+    uint32_t tcp_rexmit;     // segmentos retransmitidos
+    uint32_t pbuf_pool_max;  // máximos de ocupação dos pools (high-water)
+    uint32_t pbuf_ref_max;
+    uint32_t tcp_seg_max;
+    uint32_t mem_max;        // heap do lwIP (MEM_STATS)
+} net_health_t;
+
+// RTT medido pelo próprio cliente: do tcp_write do primeiro byte sem
+// medida em curso até o tcp_sent que o cobre (resolução de ms, contra os
+// 500 ms do estimador interno do lwIP). Um por conexão TCP
+typedef struct {
+    uint32_t written;        // bytes aceitos por tcp_write nesta conexão
+    uint32_t acked;          // bytes confirmados (tcp_sent)
+    uint32_t mark;           // `written` que fecha a medida em curso
+    uint32_t mark_ms;
+    bool timing;
+    uint32_t srtt_ms;        // média móvel (1/8), mantida entre conexões
+    uint32_t sndbuf_max;     // written - acked máximo desde o último registro
+} net_meter_t;
+
+// conexão nova: zera as contagens de bytes (o RTT fica)
+void net_meter_reset(net_meter_t *m);
+void net_meter_written(net_meter_t *m, uint32_t len, uint32_t now_ms);
+void net_meter_acked(net_meter_t *m, uint32_t len, uint32_t now_ms);
+
+// passa RTT e pico do buffer para `h` e recomeça o pico
+void net_meter_report(net_meter_t *m, net_health_t *h);
+
+// rádio (RSSI), Wi-Fi e contadores do lwIP; o transporte completa o resto
+void net_health_read(net_health_t *h, bool link);
+
+// registro JSON: { "health": { ... } }; retorna o tamanho ou -1
+int net_health_format_json(const net_health_t *h, char *buf, size_t len);
+
+#endif
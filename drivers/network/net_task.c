@@ -0,0 +1,355 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/cyw43_arch.h"
+
+#include "net_task.h"
+#include "tcp_client.h"
+#include "udp_client.h"
+#include "mqtt_client.h"
+#include "station_config.h"
+#include "net_health.h"
+#include "wifi_manager.h"
+
+typedef struct {
+    char data[NET_MSG_MAX];
+} net_msg_t;
+
+volatile bool flag_wf_state = 0;
+const char *volatile net_status = NULL;
+volatile uint32_t net_samples_dropped = 0;
+
+static TaskHandle_t net_task_handle = NULL;
+static QueueHandle_t net_msg_queue = NULL;
+static net_sample_source_t net_source = NULL;
+
+// última amostra enviada, para os limiares de envio (station_config)
+static telemetry_sample_t last_report;
+static bool have_report = false;
+
+// próximo registro de saúde (net_health)
+static uint32_t health_at_ms;
+
+static void network_task(void *params);
+static void network_halt(void);
+static void net_drain_inputs(void);
+static void net_send_health(uint32_t now, bool link_up);
+
+void net_task_start(net_sample_source_t source, UBaseType_t priority, UBaseType_t core_mask) {
+    net_source = source;
+    net_msg_queue = xQueueCreate(NET_MSG_QUEUE_LEN, sizeof(net_msg_t));
+
+#if configUSE_CORE_AFFINITY && configNUMBER_OF_CORES > 1
+    xTaskCreateAffinitySet(network_task, "net", NET_TASK_STACK, NULL, priority, core_mask, &net_task_handle);
+#else
+    (void) core_mask;
+    xTaskCreate(network_task, "net", NET_TASK_STACK, NULL, priority, &net_task_handle);
+#endif
+}
+
+void net_task_wake(void) {
+    if (net_task_handle) {
+        xTaskNotifyGive(net_task_handle);
+    }
+}
+
+bool net_send(const char *msg, TickType_t timeout) {
+    if (!msg || !net_msg_queue) return false;
+
+    size_t len = strlen(msg);
+    if (len == 0 || len >= NET_MSG_MAX) {
+        printf("net_send: tamanho inválido (%u bytes)\n", (unsigned) len);
+        return false;
+    }
+
+    net_msg_t m;
+    memcpy(m.data, msg, len + 1);
+
+    if (xQueueSend(net_msg_queue, &m, timeout) != pdTRUE) {
+        return false;
+    }
+    net_task_wake();
+    return true;
+}
+
+/* --------------- transporte ---------------- */
+
+// o cliente escolhido em NET_TRANSPORT; todos rodam com o lock do lwIP
+
+// false se a lista de servidores não é válida
+static bool transport_init(void) {
+#if NET_TRANSPORT == NET_TRANSPORT_UDP
+    return udp_client_init();
+#elif NET_TRANSPORT == NET_TRANSPORT_MQTT
+    return mqtt_client_init();
+#else
+    return tcp_client_init();
+#endif
+}
+
+// link (re)estabelecido: reinicia a conexão (no UDP, só o pcb). Na primeira
+// subida, uma conexão que o envio já abriu (ou está abrindo) continua: fechá-la
+// reenviaria o que estava em voo. Depois de uma queda, o pcb velho não vale
+static void transport_link_up(bool flapped) {
+#if NET_TRANSPORT == NET_TRANSPORT_UDP
+    (void) flapped;
+    udp_client_start();
+#elif NET_TRANSPORT == NET_TRANSPORT_MQTT
+    if (flapped || !mqtt_client_active()) {
+        mqtt_client_close();
+        mqtt_client_start();
+    }
+#else
+    if (flapped || (client_pcb == NULL && !tcp_trying_connect)) {
+        tcp_client_close();
+        tcp_client_start();
+    }
+#endif
+}
+
+// ms até o cliente precisar da tarefa (lote vencendo, reenvio ou, sem
+// conexão, fim da espera da reconexão)
+static uint32_t transport_due_ms(uint32_t now) {
+#if NET_TRANSPORT == NET_TRANSPORT_UDP
+    return udp_client_due_ms(now);
+#elif NET_TRANSPORT == NET_TRANSPORT_MQTT
+    return mqtt_client_connected() ? mqtt_client_batch_due_ms(now) : mqtt_client_reconnect_due_ms(now);
+#else
+    return tcp_connected_flag ? tcp_client_batch_due_ms(now) : tcp_client_reconnect_due_ms(now);
+#endif
+}
+
+// sem conexão: tenta de novo quando a agenda deixar (no UDP não há conexão)
+static void transport_reconnect(void) {
+#if NET_TRANSPORT == NET_TRANSPORT_MQTT
+    if (!mqtt_client_connected()) {
+        mqtt_client_try_reconnect();
+    }
+#elif NET_TRANSPORT == NET_TRANSPORT_TCP
+    if (!tcp_connected_flag && !tcp_trying_connect) {
+        tcp_client_try_reconnect();
+    }
+#endif
+}
+
+// registros atrasados por uma queda (não os que só esperam o lote ou o ACK)
+static bool transport_late(void) {
+#if NET_TRANSPORT == NET_TRANSPORT_UDP
+    return udp_client_late();
+#elif NET_TRANSPORT == NET_TRANSPORT_MQTT
+    return mqtt_client_late();
+#else
+    return tcp_client_late();
+#endif
+}
+
+// monta o registro (JSON ou binário) e enfileira; "pend" indica que há
+// registros atrasados por uma queda
+static void transport_send_sample(const telemetry_sample_t *s) {
+    bool pend = transport_late();
+#if NET_TRANSPORT == NET_TRANSPORT_MQTT
+    mqtt_client_send_sample(s, pend);
+#else
+    uint8_t payload[512];
+    int len = telemetry_encode(s, pend, payload, sizeof(payload));
+    if (len <= 0) {
+        return;
+    }
+#if NET_TRANSPORT == NET_TRANSPORT_UDP
+    udp_client_send_record(payload, (size_t) len);
+#else
+    tcp_client_send_record(payload, (size_t) len);
+#endif
+#endif
+}
+
+static void transport_send(const char *msg) {
+#if NET_TRANSPORT == NET_TRANSPORT_UDP
+    udp_client_send(msg);
+#elif NET_TRANSPORT == NET_TRANSPORT_MQTT
+    mqtt_client_send(msg);
+#else
+    tcp_client_send(msg);
+#endif
+}
+
+// RTT, buffer de envio, conexões e fila; no UDP só a fila
+static void transport_health(net_health_t *h) {
+#if NET_TRANSPORT == NET_TRANSPORT_UDP
+    h->backlog = udp_client_backlog();
+#elif NET_TRANSPORT == NET_TRANSPORT_MQTT
+    mqtt_client_health(h);
+#else
+    tcp_client_health(h);
+#endif
+}
+
+// saúde vai como os textos de net_send (no MQTT, em tópico próprio)
+static void transport_send_health(const char *json) {
+#if NET_TRANSPORT == NET_TRANSPORT_MQTT
+    mqtt_client_send_health(json);
+#else
+    transport_send(json);
+#endif
+}
+
+static void transport_flush(void) {
+#if NET_TRANSPORT == NET_TRANSPORT_UDP
+    udp_client_flush();
+#elif NET_TRANSPORT == NET_TRANSPORT_MQTT
+    mqtt_client_flush();
+#else
+    tcp_client_flush();
+#endif
+}
+
+// confirmações do log vão para a flash (só o TCP usa o log para os dados)
+static void transport_sync(void) {
+#if NET_TRANSPORT == NET_TRANSPORT_TCP
+    tcp_client_sync();
+#endif
+}
+
+/* ------------- tarefa de rede -------------- */
+
+// Wi-Fi, reconexão e envio (TCP, UDP ou MQTT); só esta tarefa chama o lwIP (sempre dentro
+// de cyw43_arch_lwip_begin/end, o que vale para os dois modos de integração).
+// Nada aqui bloqueia além da espera por trabalho: a conexão Wi-Fi é uma
+// máquina de estados assíncrona (wifi_manager)
+static void network_task(void *params) {
+    (void) params;
+
+    // fila de saída e log da flash (registros de antes do reboot voltam
+    // aqui) e a lista de servidores
+    bool servers_ok = transport_init();
+
+    // Wi-Fi init (precisa rodar com o escalonador ativo)
+    if (cyw43_arch_init()) {
+        printf("Erro ao inicializar Wi-Fi\n");
+        net_status = "falha no wifi";
+        network_halt();
+    }
+    cyw43_arch_enable_sta_mode();
+
+    // servidores (SERVER_ENDPOINTS): nomes só são resolvidos com o link
+    if (!servers_ok) {
+        printf("Lista de servidores inválida: %s\n", SERVER_ENDPOINTS);
+        net_status = "Server IP ?";
+        network_halt();
+    }
+
+    wifi_manager_init(WIFI_SSID, WIFI_PASS, CYW43_AUTH_WPA2_AES_PSK);
+    net_status = "wifi init...";
+
+    bool link_up = false;
+    bool was_up = false;
+
+    while (true) {
+        uint32_t now = to_ms_since_boot(get_absolute_time());
+        wifi_state_t st = wifi_manager_poll(now);
+
+        if (st == WIFI_STATE_CONNECTED && !link_up) {
+            // link (re)estabelecido: reinicia o cliente
+            cyw43_arch_lwip_begin();
+            transport_link_up(was_up);
+            cyw43_arch_lwip_end();
+        }
+        link_up = (st == WIFI_STATE_CONNECTED);
+        was_up = was_up || link_up;
+        flag_wf_state = link_up;
+
+        // a mensagem de boot some na primeira conexão ou na primeira falha
+        if (st == WIFI_STATE_CONNECTED || st == WIFI_STATE_BACKOFF) {
+            net_status = NULL;
+        }
+
+        // dorme até um produtor avisar (amostra ou net_send), até o próximo
+        // passo da máquina de estados do Wi-Fi ou até o lote aberto vencer
+        uint32_t wait = link_up ? NET_WAIT_MS : WIFI_POLL_MS;
+        uint32_t due = transport_due_ms(now);
+        if (link_up && due < wait) {
+            wait = due;
+        }
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait));
+
+        net_drain_inputs();
+        net_send_health(to_ms_since_boot(get_absolute_time()), link_up);
+
+        // retoma a fila de saída (ex.: parada por buffer do TCP cheio; no
+        // UDP, lote vencido ou reenvio) ou a conexão, vencida a espera
+        if (link_up) {
+            cyw43_arch_lwip_begin();
+            transport_reconnect();
+            transport_flush();
+            cyw43_arch_lwip_end();
+        }
+
+        // confirmações do log vão para a flash aqui, fora dos callbacks do lwIP
+        cyw43_arch_lwip_begin();
+        transport_sync();
+        cyw43_arch_lwip_end();
+    }
+}
+
+// envia tudo o que chegou das amostras e de net_send
+static void net_drain_inputs(void) {
+    telemetry_sample_t s;
+    while (net_source && net_source(&s)) {
+        // dentro dos limiares: a amostra fica só no display
+        if (have_report && !station_config_should_report(&s, &last_report, s.t_ms - last_report.t_ms)) {
+            continue;
+        }
+        last_report = s;
+        have_report = true;
+
+        // enfileira e envia o que couber (ou espera a reconexão na fila)
+        cyw43_arch_lwip_begin();
+        transport_send_sample(&s);
+        cyw43_arch_lwip_end();
+    }
+
+    net_msg_t m;
+    while (xQueueReceive(net_msg_queue, &m, 0) == pdTRUE) {
+        cyw43_arch_lwip_begin();
+        transport_send(m.data);
+        cyw43_arch_lwip_end();
+    }
+}
+
+// registro de saúde a cada health_period_ms, com ou sem link (sem link,
+// espera na fila com o RSSI null)
+static void net_send_health(uint32_t now, bool link_up) {
+    uint32_t period = station_config.health_period_ms;
+    if (period == 0) {
+        return;
+    }
+    if (health_at_ms == 0 || (int32_t) (health_at_ms - now) > (int32_t) period) {
+        health_at_ms = now + period;   // primeiro registro, ou período encurtado
+    }
+    if ((int32_t) (now - health_at_ms) < 0) {
+        return;
+    }
+    health_at_ms = now + period;
+
+    net_health_t h;
+    char json[NET_HEALTH_JSON_MAX];
+    cyw43_arch_lwip_begin();
+    net_health_read(&h, link_up);
+    transport_health(&h);
+    h.acq_dropped = net_samples_dropped;
+    if (net_health_format_json(&h, json, sizeof(json)) > 0) {
+        transport_send_health(json);
+    }
+    cyw43_arch_lwip_end();
+}
+
+// rede inutilizável: segue consumindo as entradas para não travar produtores
+static void network_halt(void) {
+    telemetry_sample_t s;
+    net_msg_t m;
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        while (net_source && net_source(&s));
+        while (xQueueReceive(net_msg_queue, &m, 0) == pdTRUE);
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef NET_TASK_H
+#define NET_TASK_H
+
+#include <stdbool.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+#include "drivers/telemetry/telemetry.h"
+
+// --- Wi-Fi ---
+#define WIFI_SSID     "KAUA_LQ"
+#define WIFI_PASS     "12345678"
+
+// --- tarefa de rede ---
+#define NET_TASK_STACK        2048
+#define NET_WAIT_MS           1000  // espera máxima por trabalho antes de revisar a rede
+#define NET_MSG_MAX           512   // maior mensagem aceita por net_send (com '\0')
+#define NET_MSG_QUEUE_LEN     4     // mensagens aguardando a tarefa de rede
+
+// transporte da telemetria
+#define NET_TRANSPORT_TCP     0     // conexão TCP com o servidor (tcp_client)
+#define NET_TRANSPORT_UDP     1     // lotes em datagramas (udp_client), sem handshake nem reconexão
+#define NET_TRANSPORT_MQTT    2     // publicações MQTT 3.1.1 num broker (mqtt_client)
+#ifndef NET_TRANSPORT
+#define NET_TRANSPORT         NET_TRANSPORT_TCP
+#endif
+
+// fonte de amostras da aplicação (fila ou ring); não deve bloquear
+typedef bool (*net_sample_source_t)(telemetry_sample_t *s);
+
+// estado para o display
+extern volatile bool flag_wf_state;
+extern const char *volatile net_status;   // mensagem de estado (NULL = nenhuma)
+
+// amostras que a aplicação descartou antes da fonte (fila cheia); só o
+// produtor escreve. Vai no registro de saúde
+extern volatile uint32_t net_samples_dropped;
+
+// cria a tarefa de rede: ela é a única dona do Wi-Fi e do cliente de NET_TRANSPORT
+void net_task_start(net_sample_source_t source, UBaseType_t priority, UBaseType_t core_mask);
+
+// produtores avisam que há amostras novas na fonte
+void net_task_wake(void);
+
+// envia uma mensagem pela tarefa de rede; pode ser chamada de qualquer tarefa.
+// bloqueia no máximo `timeout` esperando espaço; false se não couber ou expirar
+bool net_send(const char *msg, TickType_t timeout);
+
+#endif
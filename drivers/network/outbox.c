@@ -0,0 +1,149 @@
+#include <string.h>
+
+#include "outbox.h"
+
+#define OUTBOX_HDR 2   // tamanho do registro, u16 little-endian
+
+_Static_assert((OUTBOX_BYTES & (OUTBOX_BYTES - 1)) == 0, "OUTBOX_BYTES deve ser potência de 2");
+
+// cópias com volta no fim do buffer
+static void ob_write(outbox_t *ob, uint32_t at, const void *src, uint32_t len) {
+    uint32_t off = at & (OUTBOX_BYTES - 1);
+    uint32_t first = OUTBOX_BYTES - off;
+    if (first > len) first = len;
+    memcpy(&ob->buf[off], src, first);
+    memcpy(ob->buf, (const uint8_t *) src + first, len - first);
+}
+
+static void ob_read(const outbox_t *ob, uint32_t at, void *dst, uint32_t len) {
+    uint32_t off = at & (OUTBOX_BYTES - 1);
+    uint32_t first = OUTBOX_BYTES - off;
+    if (first > len) first = len;
+    memcpy(dst, &ob->buf[off], first);
+    memcpy((uint8_t *) dst + first, ob->buf, len - first);
+}
+
+static uint16_t ob_len_at(const outbox_t *ob, uint32_t at) {
+    uint8_t h[OUTBOX_HDR];
+    ob_read(ob, at, h, OUTBOX_HDR);
+    return (uint16_t) (h[0] | (h[1] << 8));
+}
+
+// remove o registro mais antigo (confirmado ou descartado)
+static void ob_pop_tail(outbox_t *ob) {
+    uint16_t len = ob_len_at(ob, ob->tail);
+    ob->tail += OUTBOX_HDR + len;
+    if ((int32_t) (ob->cursor - ob->tail) < 0) {
+        ob->cursor = ob->tail;
+    }
+    ob->acked = 0;
+    ob->stats.depth--;
+    ob->stats.bytes -= OUTBOX_HDR + len;
+}
+
+void outbox_init(outbox_t *ob, outbox_policy_t policy) {
+    memset(ob, 0, sizeof(*ob));
+    ob->policy = policy;
+}
+
+bool outbox_push(outbox_t *ob, const void *data, uint16_t len) {
+    if (len == 0 || len > OUTBOX_RECORD_MAX) {
+        return false;
+    }
+
+    uint32_t need = OUTBOX_HDR + len;
+    while (OUTBOX_BYTES - (ob->head - ob->tail) < need) {
+        // sem cópia, o mais antigo em voo ainda está nas mãos do TCP
+        if (ob->policy == OUTBOX_DROP_NEWEST || (ob->pin_inflight && ob->cursor != ob->tail)) {
+            ob->stats.dropped++;
+            return false;
+        }
+
+        // o descartado pode já estar em voo: as confirmações dele serão ignoradas
+        if (ob->cursor != ob->tail) {
+            ob->ack_skip += ob_len_at(ob, ob->tail) - ob->acked;
+        }
+        ob_pop_tail(ob);
+        ob->stats.dropped++;
+    }
+
+    uint8_t h[OUTBOX_HDR] = { (uint8_t) len, (uint8_t) (len >> 8) };
+    ob_write(ob, ob->head, h, OUTBOX_HDR);
+    ob_write(ob, ob->head + OUTBOX_HDR, data, len);
+    ob->head += need;
+
+    ob->stats.depth++;
+    ob->stats.bytes += need;
+    if (ob->stats.depth > ob->stats.high_water) {
+        ob->stats.high_water = ob->stats.depth;
+    }
+    return true;
+}
+
+uint16_t outbox_next(const outbox_t *ob, uint8_t *dst, uint16_t max) {
+    if (ob->cursor == ob->head) {
+        return 0;
+    }
+    uint16_t len = ob_len_at(ob, ob->cursor);
+    if (len > max) {
+        return 0;
+    }
+    ob_read(ob, ob->cursor + OUTBOX_HDR, dst, len);
+    return len;
+}
+
+int outbox_peek(const outbox_t *ob, outbox_span_t span[2]) {
+    if (ob->cursor == ob->head) {
+        return 0;
+    }
+    uint16_t len = ob_len_at(ob, ob->cursor);
+    uint32_t off = (ob->cursor + OUTBOX_HDR) & (OUTBOX_BYTES - 1);
+    uint32_t first = OUTBOX_BYTES - off;
+
+    span[0].data = &ob->buf[off];
+    if (first >= len) {
+        span[0].len = len;
+        return 1;
+    }
+    span[0].len = (uint16_t) first;
+    span[1].data = ob->buf;
+    span[1].len = (uint16_t) (len - first);
+    return 2;
+}
+
+bool outbox_next_is_last(const outbox_t *ob) {
+    return ob->cursor != ob->head && ob->cursor + OUTBOX_HDR + ob_len_at(ob, ob->cursor) == ob->head;
+}
+
+void outbox_advance(outbox_t *ob) {
+    if (ob->cursor != ob->head) {
+        ob->cursor += OUTBOX_HDR + ob_len_at(ob, ob->cursor);
+    }
+}
+
+void outbox_ack(outbox_t *ob, uint32_t len) {
+    if (ob->ack_skip) {
+        uint32_t skip = len < ob->ack_skip ? len : ob->ack_skip;
+        ob->ack_skip -= skip;
+        len -= skip;
+    }
+
+    while (len > 0 && ob->cursor != ob->tail) {
+        uint32_t rest = ob_len_at(ob, ob->tail) - ob->acked;
+        if (len < rest) {
+            ob->acked += len;
+            return;
+        }
+        len -= rest;
+        ob_pop_tail(ob);
+    }
+}
+
+void outbox_rewind(outbox_t *ob) {
+    if (ob->cursor != ob->tail) {
+        ob->stats.rewinds++;
+    }
+    ob->cursor = ob->tail;
+    ob->acked = 0;
+    ob->ack_skip = 0;
+}
@@ -0,0 +1,93 @@
+#ifndef OUTBOX_H
+#define OUTBOX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Fila de registros de tamanho variável (store-and-forward) em buffer
+// circular de bytes. Cada registro passa por três estados:
+//   enfileirado -> em voo (entregue ao TCP) -> confirmado (sai da fila).
+// Se a conexão cai, o que estava em voo volta a ser enviado (rewind).
+// Os registros podem ser lidos no lugar (outbox_peek) e entregues ao TCP sem
+// cópia; nesse caso `pin_inflight` impede que a política de descarte
+// reaproveite bytes ainda referenciados pelo stack.
+// Não é thread-safe: o tcp_client só usa com o lock do lwIP.
+
+#define OUTBOX_BYTES       16384   // capacidade total (cabeçalhos incluídos)
+#define OUTBOX_RECORD_MAX  1024    // maior registro aceito
+
+typedef enum {
+    OUTBOX_DROP_OLDEST = 0,   // fila cheia: descarta os mais antigos (mantém o recente)
+    OUTBOX_DROP_NEWEST,       // fila cheia: recusa o novo (mantém o histórico)
+} outbox_policy_t;
+
+typedef struct {
+    uint32_t depth;          // registros na fila (em voo incluídos)
+    uint32_t bytes;          // bytes ocupados
+    uint32_t high_water;     // maior depth já visto
+    uint32_t dropped;        // registros descartados por falta de espaço
+    uint32_t rewinds;        // reenvios após queda de conexão
+} outbox_stats_t;
+
+// trecho contíguo de um registro dentro do buffer
+typedef struct {
+    const uint8_t *data;
+    uint16_t len;
+} outbox_span_t;
+
+typedef struct {
+    uint8_t buf[OUTBOX_BYTES];
+    uint32_t head;           // próximo byte livre (offsets crescem sem parar)
+    uint32_t tail;           // registro mais antigo ainda não confirmado
+    uint32_t cursor;         // próximo registro a enviar (tail <= cursor <= head)
+    uint32_t acked;          // bytes do registro em tail já confirmados
+    uint32_t ack_skip;       // confirmações de registros em voo já descartados
+    outbox_policy_t policy;
+    bool pin_inflight;       // em voo referenciado pelo TCP: nunca é descartado
+    outbox_stats_t stats;
+} outbox_t;
+
+void outbox_init(outbox_t *ob, outbox_policy_t policy);
+
+// enfileira uma cópia; false se o registro for inválido ou recusado
+bool outbox_push(outbox_t *ob, const void *data, uint16_t len);
+
+// copia o próximo registro não enviado; retorna o tamanho (0 = nada a enviar)
+uint16_t outbox_next(const outbox_t *ob, uint8_t *dst, uint16_t max);
+
+// o próximo registro não enviado sem copiar: um trecho, ou dois quando ele
+// dá a volta no fim do buffer; retorna quantos (0 = nada a enviar). Os bytes
+// ficam válidos até o registro ser confirmado ou descartado
+int outbox_peek(const outbox_t *ob, outbox_span_t span[2]);
+
+// o registro de outbox_next/outbox_peek é o último ainda não enviado
+bool outbox_next_is_last(const outbox_t *ob);
+
+// marca o registro retornado por outbox_next como em voo
+void outbox_advance(outbox_t *ob);
+
+// `len` bytes de payload confirmados, na ordem de envio
+void outbox_ack(outbox_t *ob, uint32_t len);
+
+// conexão perdida: tudo o que estava em voo volta a ser pendente
+void outbox_rewind(outbox_t *ob);
+
+static inline bool outbox_empty(const outbox_t *ob) {
+    return ob->head == ob->tail;
+}
+
+static inline bool outbox_has_unsent(const outbox_t *ob) {
+    return ob->cursor != ob->head;
+}
+
+static inline bool outbox_in_flight(const outbox_t *ob) {
+    return ob->cursor != ob->tail;
+}
+
+// marca de posição (ob->head no momento): algum registro enfileirado antes
+// dela ainda não foi confirmado
+static inline bool outbox_holds(const outbox_t *ob, uint32_t mark) {
+    return (int32_t) (mark - ob->tail) > 0;
+}
+
+#endif
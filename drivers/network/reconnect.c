@@ -0,0 +1,93 @@
+#include <stdio.h>
+
+#include "reconnect.h"
+
+// xorshift32: só para espalhar as esperas, não precisa de qualidade
+static uint32_t next_rand(reconnect_t *r) {
+    uint32_t x = r->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return r->rng = x;
+}
+
+void reconnect_init(reconnect_t *r, uint32_t seed) {
+    *r = (reconnect_t) { 0 };
+    r->backoff_ms = RECONNECT_BACKOFF_MIN_MS;
+    r->rng = seed | 1;   // nunca zero
+}
+
+bool reconnect_due(reconnect_t *r, uint32_t now_ms) {
+    if (r->waiting && (int32_t) (now_ms - r->retry_at_ms) < 0) {
+        r->stats.deferred++;
+        return false;
+    }
+    return true;
+}
+
+uint32_t reconnect_wait_ms(const reconnect_t *r, uint32_t now_ms) {
+    if (!r->waiting) {
+        return UINT32_MAX;   // tentativa em curso (ou nenhuma agendada)
+    }
+    int32_t left = (int32_t) (r->retry_at_ms - now_ms);
+    return left > 0 ? (uint32_t) left : 0;
+}
+
+void reconnect_attempt(reconnect_t *r) {
+    r->waiting = false;
+    r->healthy = false;
+    r->stats.attempts++;
+}
+
+void reconnect_success(reconnect_t *r) {
+    if (r->state == RECONNECT_OPEN) {
+        printf("reconnect: servidor de volta, disjuntor fechado\n");
+    }
+    r->state = RECONNECT_CLOSED;
+    r->healthy = true;
+    r->streak = 0;
+    r->backoff_ms = RECONNECT_BACKOFF_MIN_MS;
+}
+
+void reconnect_lost(reconnect_t *r, uint32_t now_ms) {
+    if (r->waiting) {
+        return;   // já agendada (ex.: err depois de uma falha no tcp_connect)
+    }
+
+    uint32_t wait;
+    if (r->healthy) {
+        // a conexão funcionou: só uma pausa curta antes de voltar
+        r->healthy = false;
+        wait = RECONNECT_BACKOFF_MIN_MS;
+    }
+    else {
+        r->stats.failures++;
+        if (++r->streak >= RECONNECT_TRIP_FAILURES) {
+            if (r->state != RECONNECT_OPEN) {
+                printf("reconnect: %lu falhas seguidas, disjuntor aberto (sonda a cada %u ms)\n",
+                       (unsigned long) r->streak, RECONNECT_OPEN_MS);
+                r->stats.trips++;
+            }
+            r->state = RECONNECT_OPEN;
+            wait = RECONNECT_OPEN_MS;
+        }
+        else {
+            wait = r->backoff_ms;
+            r->backoff_ms = wait * 2 > RECONNECT_BACKOFF_MAX_MS ? RECONNECT_BACKOFF_MAX_MS : wait * 2;
+        }
+    }
+
+    // jitter de ±25%
+    wait = wait - wait / 4 + next_rand(r) % (wait / 2 + 1);
+
+    r->waiting = true;
+    r->retry_at_ms = now_ms + wait;
+}
+
+void reconnect_reset(reconnect_t *r) {
+    r->state = RECONNECT_CLOSED;
+    r->waiting = false;
+    r->healthy = false;
+    r->streak = 0;
+    r->backoff_ms = RECONNECT_BACKOFF_MIN_MS;
+}
@@ -0,0 +1,64 @@
+#ifndef RECONNECT_H
+#define RECONNECT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// --- agenda de reconexão com o servidor (tcp_client, mqtt_client) ---
+// Cada falha seguida dobra a espera (com jitter de ±25%, para estações que
+// caíram juntas não voltarem juntas) até RECONNECT_BACKOFF_MAX_MS. Depois
+// de RECONNECT_TRIP_FAILURES falhas seguidas o disjuntor abre: só uma
+// sonda a cada RECONNECT_OPEN_MS, até o servidor responder. Enquanto
+// espera, nenhum pcb é criado e a rede não disputa CPU nem rádio
+#define RECONNECT_BACKOFF_MIN_MS   500
+#define RECONNECT_BACKOFF_MAX_MS   8000
+#define RECONNECT_TRIP_FAILURES    6
+#define RECONNECT_OPEN_MS          20000
+
+typedef enum {
+    RECONNECT_CLOSED = 0,    // normal: tenta de novo após o backoff
+    RECONNECT_OPEN,          // disjuntor aberto: uma sonda por RECONNECT_OPEN_MS
+} reconnect_state_t;
+
+typedef struct {
+    uint32_t attempts;       // conexões iniciadas
+    uint32_t failures;       // tentativas (ou conexões sem resposta) que falharam
+    uint32_t deferred;       // pedidos de reconexão adiados pela espera
+    uint32_t trips;          // vezes que o disjuntor abriu
+} reconnect_stats_t;
+
+typedef struct {
+    reconnect_state_t state;
+    bool waiting;            // há uma espera em curso (até retry_at_ms)
+    bool healthy;            // o servidor respondeu nesta conexão
+    uint32_t retry_at_ms;
+    uint32_t backoff_ms;     // próxima espera, antes do jitter
+    uint32_t streak;         // falhas seguidas
+    uint32_t rng;
+    reconnect_stats_t stats;
+} reconnect_t;
+
+// `seed` espalha o jitter entre estações que ligaram juntas (ex.: id da placa)
+void reconnect_init(reconnect_t *r, uint32_t seed);
+
+// pode tentar agora? false (e conta o adiamento) durante a espera
+bool reconnect_due(reconnect_t *r, uint32_t now_ms);
+
+// ms até a próxima tentativa agendada (0 se já pode; UINT32_MAX se não há
+// espera, ex.: tentativa em curso)
+uint32_t reconnect_wait_ms(const reconnect_t *r, uint32_t now_ms);
+
+// tentativa iniciada (tcp_connect)
+void reconnect_attempt(reconnect_t *r);
+
+// o servidor respondeu (não só o handshake): zera o backoff e fecha o disjuntor
+void reconnect_success(reconnect_t *r);
+
+// conexão perdida ou tentativa falhou: agenda a próxima. Depois de uma
+// conexão saudável a primeira nova tentativa sai em RECONNECT_BACKOFF_MIN_MS
+void reconnect_lost(reconnect_t *r, uint32_t now_ms);
+
+// link novo (Wi-Fi voltou): esquece as falhas e tenta já
+void reconnect_reset(reconnect_t *r);
+
+#endif
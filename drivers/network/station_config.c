@@ -0,0 +1,109 @@
+#include <math.h>
+
+#include "station_config.h"
+#include "tcp_client.h"
+#include "net_health.h"
+
+volatile station_config_t station_config = {
+    .sample_period_ms = SAMPLE_PERIOD_MS,
+    .batch_records = TCP_BATCH_RECORDS,
+    .batch_delay_ms = TCP_BATCH_DELAY_MS,
+    .sensors = STATION_SENSOR_ALL,
+    .display_mode = 0,
+    .report_max_ms = REPORT_MAX_MS,
+    .health_period_ms = HEALTH_PERIOD_MS,
+};
+
+// faixa aceita de cada parâmetro; false se o id não existe
+static bool param_range(uint8_t id, int32_t *min, int32_t *max) {
+    *min = 0;
+    switch (id) {
+    case STATION_CFG_SAMPLE_PERIOD_MS: *min = 100; *max = 3600000; return true;
+    case STATION_CFG_BATCH_RECORDS:    *min = 1;   *max = 256;     return true;
+    case STATION_CFG_BATCH_DELAY_MS:   *max = 600000;              return true;
+    case STATION_CFG_SENSORS:          *max = STATION_SENSOR_ALL;  return true;
+    case STATION_CFG_DISPLAY_MODE:     *max = 1;                   return true;
+    case STATION_CFG_REPORT_MAX_MS:    *max = 86400000;            return true;
+    case STATION_CFG_HEALTH_PERIOD_MS: *max = 86400000;            return true;
+    default:
+        *max = INT32_MAX;
+        return id >= STATION_CFG_DEADBAND && id < STATION_CFG_DEADBAND + TELEMETRY_FIELDS;
+    }
+}
+
+static volatile uint32_t *param_word(uint8_t id) {
+    switch (id) {
+    case STATION_CFG_SAMPLE_PERIOD_MS: return &station_config.sample_period_ms;
+    case STATION_CFG_BATCH_RECORDS:    return &station_config.batch_records;
+    case STATION_CFG_BATCH_DELAY_MS:   return &station_config.batch_delay_ms;
+    case STATION_CFG_SENSORS:          return &station_config.sensors;
+    case STATION_CFG_DISPLAY_MODE:     return &station_config.display_mode;
+    case STATION_CFG_REPORT_MAX_MS:    return &station_config.report_max_ms;
+    case STATION_CFG_HEALTH_PERIOD_MS: return &station_config.health_period_ms;
+    default:
+        return (volatile uint32_t *) &station_config.deadband[id - STATION_CFG_DEADBAND];
+    }
+}
+
+static int32_t get_le32(const uint8_t *p) {
+    return (int32_t) ((uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24));
+}
+
+int station_config_apply(const uint8_t *pairs, size_t n, size_t *bad) {
+    // confere tudo antes: um comando recusado não deixa nada pela metade
+    for (size_t i = 0; i < n; i++) {
+        const uint8_t *p = pairs + i * STATION_CFG_PAIR;
+        int32_t min, max, v = get_le32(p + 1);
+        *bad = i;
+        if (!param_range(p[0], &min, &max)) {
+            return STATION_CFG_UNKNOWN;
+        }
+        if (v < min || v > max) {
+            return STATION_CFG_RANGE;
+        }
+    }
+    for (size_t i = 0; i < n; i++) {
+        const uint8_t *p = pairs + i * STATION_CFG_PAIR;
+        *param_word(p[0]) = (uint32_t) get_le32(p + 1);
+    }
+    return STATION_CFG_OK;
+}
+
+size_t station_config_dump(uint8_t *buf, size_t len) {
+    static const uint8_t ids[] = {
+        STATION_CFG_SAMPLE_PERIOD_MS, STATION_CFG_BATCH_RECORDS, STATION_CFG_BATCH_DELAY_MS,
+        STATION_CFG_SENSORS, STATION_CFG_DISPLAY_MODE, STATION_CFG_REPORT_MAX_MS,
+        STATION_CFG_HEALTH_PERIOD_MS,
+    };
+    size_t n = 0;
+    for (size_t i = 0; i < STATION_CFG_PARAMS && n + STATION_CFG_PAIR <= len; i++) {
+        uint8_t id = i < sizeof(ids) ? ids[i] : (uint8_t) (STATION_CFG_DEADBAND + i - sizeof(ids));
+        uint32_t v = *param_word(id);
+        buf[n++] = id;
+        for (int k = 0; k < 4; k++, v >>= 8) {
+            buf[n++] = (uint8_t) v;
+        }
+    }
+    return n;
+}
+
+bool station_config_should_report(const telemetry_sample_t *s, const telemetry_sample_t *last, uint32_t since_ms) {
+    bool limited = false;
+    for (int i = 0; i < TELEMETRY_FIELDS; i++) {
+        int32_t deadband = station_config.deadband[i];
+        if (deadband <= 0) {
+            continue;
+        }
+        limited = true;
+
+        // compara em ponto fixo, como o servidor recebe; leitura que
+        // aparece ou some (NaN) sempre conta
+        float scale;
+        float a = telemetry_field(s, i, &scale);
+        float b = telemetry_field(last, i, &scale);
+        if (isnan(a) != isnan(b) || (!isnan(a) && fabsf(a - b) * scale >= (float) deadband)) {
+            return true;
+        }
+    }
+    return !limited || since_ms >= station_config.report_max_ms;
+}
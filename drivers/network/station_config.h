@@ -0,0 +1,78 @@
+#ifndef STATION_CONFIG_H
+#define STATION_CONFIG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "drivers/telemetry/telemetry.h"
+
+// --- ajustes em tempo de execução ---
+// Valores de boot; o servidor muda pelo quadro CMD (tcp_client) sem
+// regravar o firmware. Ficam só na RAM: um reboot volta a estes
+
+#ifndef SAMPLE_PERIOD_MS
+#define SAMPLE_PERIOD_MS      2000  // período de amostragem (vTaskDelayUntil)
+#endif
+
+// sensores lidos pela aquisição (máscara); os desligados vão como inválidos
+#define STATION_SENSOR_LUX    0x01  // BH1750 (3 canais do mux)
+#define STATION_SENSOR_ANGLE  0x02  // MPU6050
+#define STATION_SENSOR_TEMP   0x04  // DS18B20
+#define STATION_SENSOR_ENERGY 0x08  // INA219
+#define STATION_SENSOR_ALL    0x0F
+
+// limiares: com algum ajustado, a amostra só vai ao servidor se um desses
+// campos variou ao menos o limiar desde a última enviada, ou se passou
+// REPORT_MAX_MS. Limiar 0 = o campo não dispara envio
+#ifndef REPORT_MAX_MS
+#define REPORT_MAX_MS         60000
+#endif
+
+// parâmetros no quadro CMD: pares (id u8, valor i32 LE)
+typedef enum {
+    STATION_CFG_SAMPLE_PERIOD_MS = 1,
+    STATION_CFG_BATCH_RECORDS    = 2,
+    STATION_CFG_BATCH_DELAY_MS   = 3,
+    STATION_CFG_SENSORS          = 4,
+    STATION_CFG_DISPLAY_MODE     = 5,
+    STATION_CFG_REPORT_MAX_MS    = 6,
+    STATION_CFG_HEALTH_PERIOD_MS = 7,    // registro de saúde (net_health); 0 = desligado
+    STATION_CFG_DEADBAND         = 16,   // + campo (ordem do esquema), em ponto fixo do campo
+} station_param_t;
+
+#define STATION_CFG_PAIR      5
+#define STATION_CFG_PARAMS    (7 + TELEMETRY_FIELDS)
+
+// resultado de station_config_apply
+#define STATION_CFG_OK        0
+#define STATION_CFG_UNKNOWN   1     // parâmetro desconhecido
+#define STATION_CFG_RANGE     2     // valor fora da faixa
+
+typedef struct {
+    uint32_t sample_period_ms;
+    uint32_t batch_records;            // lote do transporte (ver TCP_BATCH_RECORDS)
+    uint32_t batch_delay_ms;
+    uint32_t sensors;                  // STATION_SENSOR_*
+    uint32_t display_mode;             // 0 = luz, ângulo e temperatura; 1 = energia
+    uint32_t report_max_ms;
+    uint32_t health_period_ms;
+    int32_t deadband[TELEMETRY_FIELDS];
+} station_config_t;
+
+// a tarefa de rede (e o botão, no display_mode) escreve; cada campo é uma
+// palavra, lida pelas outras tarefas sem trava
+extern volatile station_config_t station_config;
+
+// confere e aplica `n` pares (tudo ou nada); retorna STATION_CFG_OK ou o
+// erro, com o índice do par recusado em `bad`
+int station_config_apply(const uint8_t *pairs, size_t n, size_t *bad);
+
+// todos os parâmetros atuais como pares; retorna os bytes escritos
+size_t station_config_dump(uint8_t *buf, size_t len);
+
+// limiares: a amostra `s` deve ir ao servidor? `last` é a última enviada,
+// há `since_ms`
+bool station_config_should_report(const telemetry_sample_t *s, const telemetry_sample_t *last, uint32_t since_ms);
+
+#endif
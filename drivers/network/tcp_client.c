@@ -1,19 +1,301 @@
+#include "pico/time.h"
+#include "pico/unique_id.h"
+
 #include "tcp_client.h"
+#include "station_config.h"
+#include "reconnect.h"
+#include "net_health.h"
+#include "endpoints.h"
 
 // --- TCP state & buffers ---
 struct tcp_pcb *client_pcb = NULL;
-ip_addr_t server_addr;
 volatile int tcp_connected_flag = 0;
 volatile int tcp_trying_connect = 0;
 
-// mensagem pendente (simples fila de 1 elemento)
-char pending_msg[PENDING_MSG_MAX];
-volatile int has_pending_msg = 0;
+// fila de saída: guarda as mensagens enquanto conectado e só descarta um
+// registro depois que o servidor confirmou que o gravou (quadro ACK)
+static outbox_t outbox;
+static bool outbox_ready = false;
+
+// sem conexão, os registros vão para o log na flash (sobrevive a reboot);
+// o log é enviado antes da fila, então a ordem no stream é sempre
+// log -> fila, a mesma dos números de sequência
+static bool use_flash_log = false;
+
+// cópia de um registro da fila a caminho da flash (só com o lock do lwIP)
+static uint8_t tx_scratch[OUTBOX_RECORD_MAX];
+
+// lote em formação: registros novos ainda não entregues ao TCP
+static uint32_t batch_count;
+static uint32_t batch_bytes;
+static uint32_t batch_since_ms;
+static bool batch_release;   // lote liberado (ou reenvio após queda): vai tudo sem esperar
+
+// numeração dos registros: época do boot (setor aberto no log, cresce a
+// cada boot) nos 32 bits altos e contador do boot nos baixos, a partir de 1
+static uint64_t next_seq;
+static uint64_t acked_seq;       // maior seq confirmado pelo servidor nesta sessão
+static bool seq_reset;           // sem log: o servidor esquece a numeração antiga
+static char station_id[2 * PICO_UNIQUE_BOARD_ID_SIZE_BYTES + 1];
+
+// próxima tentativa de conexão (backoff e disjuntor)
+static reconnect_t reconnect;
+
+// SERVER_ENDPOINTS: servidor atual e os reservas
+static endpoints_t servers;
+
+// RTT e ocupação do buffer de envio, para o registro de saúde
+static net_meter_t meter;
+
+// quadro DATA do registro sendo enfileirado
+static uint8_t frame_buf[OUTBOX_RECORD_MAX];
+
+// codec delta da conexão atual: referência e seq do último comprimido
+static telemetry_delta_t delta;
+static uint64_t delta_seq;
+static uint8_t delta_frame[TCP_FRAME_HDR + 8 + TELEMETRY_DELTA_MAX];
+
+// registros em voo aguardando o ACK, na ordem do stream
+typedef struct {
+    uint64_t seq;
+    uint16_t len;
+    bool from_log;
+} tcp_pending_t;
+
+static tcp_pending_t pending[TCP_APP_WINDOW];
+static uint32_t pending_head, pending_count;
+
+// vigia do servidor mudo: início do SYN e da espera pelo próximo ACK
+static uint32_t connect_since_ms;
+static uint32_t ack_wait_ms;
+
+// quadro ACK ou CMD chegando em pedaços; quadros desconhecidos são pulados
+static uint8_t rx_frame[TCP_FRAME_HDR + TCP_CMD_MAX];
+static uint32_t rx_len, rx_skip;
+
+// fim (outbox.head) dos registros atrasados por uma queda: enfileirados sem
+// conexão ou sem confirmação quando ela caiu
+static uint32_t late_mark;
+
+static void tcp_client_spill(void);
+static err_t tcp_client_output(void);
+static bool tcp_client_write(const outbox_span_t *span, int n, bool last, bool copy);
+
+// tcp_write que passa pelo medidor de RTT: todo byte escrito na conexão
+// precisa ser contado para casar com os tcp_sent
+static err_t tcp_client_put(const void *data, u16_t len, u8_t flags) {
+    err_t err = tcp_write(client_pcb, data, len, flags);
+    if (err == ERR_OK) {
+        net_meter_written(&meter, len, to_ms_since_boot(get_absolute_time()));
+    }
+    return err;
+}
+
+// conexão perdida: o que estava em voo volta para a fila
+static void tcp_client_lost(void) {
+    if (client_pcb != NULL && !reconnect.healthy) {
+        // o servidor não respondeu nesta conexão: a próxima vai ao reserva
+        endpoints_next(&servers);
+    }
+    if (client_pcb != NULL || tcp_trying_connect) {
+        reconnect_lost(&reconnect, to_ms_since_boot(get_absolute_time()));
+    }
+    endpoints_cancel(&servers);
+    tcp_connected_flag = 0;
+    tcp_trying_connect = 0;
+    client_pcb = NULL;
+    outbox_rewind(&outbox);
+    late_mark = outbox.head;
+    batch_release = true;
+    if (use_flash_log) {
+        flash_log_rewind();
+    }
+    pending_head = pending_count = 0;
+    rx_len = rx_skip = 0;
+    telemetry_delta_reset(&delta);   // o servidor recomeça o stream na próxima conexão
+}
+
+static uint64_t get_le64(const uint8_t *p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+static void put_le64(uint8_t *p, uint64_t v) {
+    for (int i = 0; i < 8; i++, v >>= 8) p[i] = (uint8_t) v;
+}
+
+// byte `i` de um quadro guardado em um ou dois trechos
+static uint8_t span_byte(const outbox_span_t *span, uint32_t i) {
+    return i < span[0].len ? span[0].data[i] : span[1].data[i - span[0].len];
+}
+
+// seq de um quadro DATA guardado
+static uint64_t frame_seq(const outbox_span_t *span) {
+    uint8_t hdr[TCP_DATA_HDR];
+    for (uint32_t i = 0; i < TCP_DATA_HDR; i++) {
+        hdr[i] = span_byte(span, i);
+    }
+    return get_le64(hdr + TCP_FRAME_HDR);
+}
+
+// quadro KEY ou DELTA em delta_frame para o registro binário do quadro DATA
+// guardado; retorna o tamanho ou 0 se o registro não for binário (texto,
+// JSON), que sai como está. `d` recebe a referência nova
+static uint16_t tcp_client_compress(const outbox_span_t *span, uint16_t len, uint64_t seq, telemetry_delta_t *d) {
+    uint8_t rec[TELEMETRY_BIN_MAX];
+    if (len <= TCP_DATA_HDR || (size_t) (len - TCP_DATA_HDR) > sizeof(rec) || span_byte(span, TCP_DATA_HDR) != TELEMETRY_BIN_MAGIC) {
+        return 0;
+    }
+    for (uint32_t i = TCP_DATA_HDR; i < len; i++) {
+        rec[i - TCP_DATA_HDR] = span_byte(span, i);
+    }
+
+    // quadro-chave com o seq inteiro; depois, só quanto ele avançou
+    uint8_t kind = d->key ? TCP_FRAME_KEY : TCP_FRAME_DELTA;
+    uint8_t *p = delta_frame + TCP_FRAME_HDR;
+    if (d->key) {
+        put_le64(p, seq);
+        p += 8;
+    }
+    else {
+        uint64_t gap = seq - delta_seq;
+        do {
+            uint8_t b = gap & 0x7F;
+            gap >>= 7;
+            *p++ = gap ? (b | 0x80) : b;
+        } while (gap);
+    }
+
+    int n = telemetry_delta_encode(d, rec, len - TCP_DATA_HDR, p, delta_frame + sizeof(delta_frame) - p);
+    if (n <= 0) {
+        return 0;
+    }
+    uint16_t body = (uint16_t) (p + n - delta_frame - TCP_FRAME_HDR);
+    delta_frame[0] = TCP_FRAME_MAGIC;
+    delta_frame[1] = kind;
+    delta_frame[2] = (uint8_t) body;
+    delta_frame[3] = (uint8_t) (body >> 8);
+    return (uint16_t) (TCP_FRAME_HDR + body);
+}
+
+// o servidor gravou tudo até `seq`: libera os registros correspondentes
+static void tcp_client_app_ack(uint64_t seq) {
+    seq_reset = false;   // a numeração deste boot já é conhecida
+    reconnect_success(&reconnect);
+    if (seq > acked_seq) {
+        acked_seq = seq;
+    }
+    ack_wait_ms = to_ms_since_boot(get_absolute_time());
+    while (pending_count > 0 && pending[pending_head].seq <= seq) {
+        tcp_pending_t *p = &pending[pending_head];
+        if (p->from_log) {
+            flash_log_ack(p->len);
+        }
+        else {
+            outbox_ack(&outbox, p->len);
+        }
+        pending_head = (pending_head + 1) % TCP_APP_WINDOW;
+        pending_count--;
+    }
+}
+
+// comando do servidor: aplica os ajustes e responde com os valores atuais
+// (um CMD sem ajustes só consulta). A resposta vai entre dois quadros
+// inteiros do stream, com cópia; sem espaço no TCP o servidor não recebe
+// e pode repetir o comando
+static void tcp_client_command(const uint8_t *body, uint16_t len) {
+    if (len < 2 || (len - 2) % STATION_CFG_PAIR != 0) {
+        printf("tcp_client: comando inválido (%u bytes)\n", (unsigned) len);
+        return;
+    }
+
+    size_t bad = 0;
+    int status = station_config_apply(body + 2, (len - 2) / STATION_CFG_PAIR, &bad);
+    printf("tcp_client: comando %u, %u ajustes, resultado %d\n",
+           (unsigned) (body[0] | (body[1] << 8)), (unsigned) ((len - 2) / STATION_CFG_PAIR), status);
+
+    uint8_t reply[TCP_FRAME_HDR + 4 + STATION_CFG_PARAMS * STATION_CFG_PAIR];
+    uint16_t n = (uint16_t) (4 + station_config_dump(&reply[TCP_FRAME_HDR + 4], sizeof(reply) - TCP_FRAME_HDR - 4));
+    reply[0] = TCP_FRAME_MAGIC;
+    reply[1] = TCP_FRAME_CMD_ACK;
+    reply[2] = (uint8_t) n;
+    reply[3] = (uint8_t) (n >> 8);
+    reply[4] = body[0];
+    reply[5] = body[1];
+    reply[6] = (uint8_t) status;
+    reply[7] = (uint8_t) bad;
+
+    if (tcp_client_put(reply, TCP_FRAME_HDR + n, TCP_WRITE_FLAG_COPY) != ERR_OK) {
+        printf("tcp_client: sem espaço para a resposta do comando\n");
+        return;
+    }
+    tcp_output(client_pcb);
+}
+
+// separa os quadros ACK e CMD do que chegou do servidor
+static void tcp_client_rx(const uint8_t *p, uint32_t n) {
+    while (n > 0) {
+        if (rx_skip > 0) {
+            uint32_t k = n < rx_skip ? n : rx_skip;
+            rx_skip -= k;
+            p += k;
+            n -= k;
+            continue;
+        }
+
+        rx_frame[rx_len++] = *p++;
+        n--;
+        if (rx_frame[0] != TCP_FRAME_MAGIC) {
+            rx_len = 0;   // fora de sincronia: procura o próximo quadro
+            continue;
+        }
+        if (rx_len < TCP_FRAME_HDR) {
+            continue;
+        }
+
+        uint16_t body = (uint16_t) (rx_frame[2] | (rx_frame[3] << 8));
+        bool ack = rx_frame[1] == TCP_FRAME_ACK && body == 8;
+        bool cmd = rx_frame[1] == TCP_FRAME_CMD && body <= TCP_CMD_MAX;
+        if (!ack && !cmd) {
+            rx_skip = body;
+            rx_len = 0;
+        }
+        else if (rx_len == TCP_FRAME_HDR + (uint32_t) body) {
+            if (ack) {
+                tcp_client_app_ack(get_le64(rx_frame + TCP_FRAME_HDR));
+            }
+            else {
+                tcp_client_command(rx_frame + TCP_FRAME_HDR, body);
+            }
+            rx_len = 0;
+        }
+    }
+}
+
+// apresenta a estação; o servidor responde com o último seq que gravou
+static bool tcp_client_hello(void) {
+    uint8_t frame[TCP_FRAME_HDR + 1 + sizeof(station_id)];
+    uint16_t id_len = (uint16_t) strlen(station_id);
+    uint16_t body = 1 + id_len;
+
+    frame[0] = TCP_FRAME_MAGIC;
+    frame[1] = TCP_FRAME_HELLO;
+    frame[2] = (uint8_t) body;
+    frame[3] = (uint8_t) (body >> 8);
+    frame[4] = seq_reset ? TCP_HELLO_RESET : 0;
+    memcpy(&frame[5], station_id, id_len);
+
+    return tcp_client_put(frame, TCP_FRAME_HDR + body, TCP_WRITE_FLAG_COPY) == ERR_OK;
+}
 
 /* ------------- TCP callbacks --------------- */
 
 // chamado quando conexão estabelecida (ou falha)
 static err_t tcp_client_connected(void *arg, struct tcp_pcb *tpcb, err_t err) {
+    (void) arg;
+    (void) tpcb;
+
     if (err != ERR_OK) {
         printf("tcp_client_connected: erro ao conectar: %d\n", err);
         tcp_connected_flag = 0;
@@ -24,46 +306,61 @@ static err_t tcp_client_connected(void *arg, struct tcp_pcb *tpcb, err_t err) {
 
     tcp_connected_flag = 1;
     tcp_trying_connect = 0;
-    printf("TCP conectado ao servidor %s:%d\n", SERVER_IP, SERVER_PORT);
+    net_meter_reset(&meter);
+    printf("TCP conectado ao servidor %s:%u (%lu na fila)\n", endpoints_current(&servers)->host,
+           (unsigned) endpoints_current(&servers)->port, (unsigned long) tcp_client_backlog());
 
-    // Registrar callbacks úteis
-    tcp_err(tpcb, NULL); // registramos error callback separadamente se quisermos
-    tcp_sent(tpcb, NULL); // podemos usar para saber quando o TX buffer foi liberado
-    tcp_poll(tpcb, NULL, 0);
+    // err, poll, sent e recv continuam registrados: a fila depende deles
+    // para saber o que foi gravado e o que precisa voltar após uma queda
 
-    // se tinha mensagem pendente, tenta enviar agora
-    if (has_pending_msg) {
-        // nada aqui: o envio será feito pela função pública tcp_client_send
+    if (!tcp_client_hello()) {
+        printf("tcp_client_connected: falha ao enviar HELLO\n");
     }
 
-    return ERR_OK;
+    // descarrega a fila acumulada durante a queda
+    return tcp_client_output();
 }
 
 // erro fatal da conexão: o LWIP chama isso quando o pcb é eliminado
 static void tcp_client_err(void *arg, err_t err) {
     (void) arg;
     printf("tcp_client_err: conexão encerrada com erro %d\n", err);
-    tcp_connected_flag = 0;
-    tcp_trying_connect = 0;
-    client_pcb = NULL; // pcb inválido agora
-    // marcar reconexão
+    tcp_client_lost(); // pcb inválido agora; reenvia o que estava em voo
+}
+
+// servidor mudo: SYN sem resposta ou registros sem ACK além do prazo
+static bool tcp_client_stalled(uint32_t now) {
+    if (tcp_trying_connect && now - connect_since_ms > TCP_CONNECT_TIMEOUT_MS) {
+        printf("tcp_client: servidor não respondeu à conexão em %u ms\n", (unsigned) TCP_CONNECT_TIMEOUT_MS);
+        return true;
+    }
+    if (tcp_connected_flag && pending_count > 0 && now - ack_wait_ms > TCP_ACK_TIMEOUT_MS) {
+        printf("tcp_client: %lu registros sem ACK do servidor em %u ms\n", (unsigned long) pending_count,
+               (unsigned) TCP_ACK_TIMEOUT_MS);
+        return true;
+    }
+    return false;
 }
 
-// poll callback: se passarmos NULL para tcp_poll, não entra; vamos registrar um poll manualmente na criação
+// poll callback: reconecta se preciso, retoma envios parados e derruba a
+// conexão com um servidor mudo
 static err_t tcp_client_poll(void *arg, struct tcp_pcb *tpcb) {
     (void) arg;
-    (void) tpcb;
 
-    // se desconectado ou pcb inválido, tente reconectar
+    if (tcp_client_stalled(to_ms_since_boot(get_absolute_time()))) {
+        tcp_abort(tpcb);   // tcp_client_err devolve o que estava em voo à fila
+        return ERR_ABRT;
+    }
+
+    // se desconectado ou pcb inválido, tente reconectar (quando a agenda deixar)
     if (!tcp_connected_flag && !tcp_trying_connect) {
         printf("tcp_client_poll: detectado desconexão, tentando reconectar...\n");
-        tcp_trying_connect = 1;
         tcp_client_try_reconnect();
     }
 
-    // se há mensagem pendente e estamos conectados, tente enviar
-    if (tcp_connected_flag && has_pending_msg) {
-        // nada: a lógica de envio central fará tcp_output
+    // se há registros e estamos conectados, tente enviar
+    if (tcp_connected_flag && (outbox_has_unsent(&outbox) || (use_flash_log && flash_log_has_unsent()))) {
+        return tcp_client_output();
     }
 
     return ERR_OK;
@@ -73,21 +370,72 @@ static err_t tcp_client_poll(void *arg, struct tcp_pcb *tpcb) {
 static err_t tcp_client_sent(void *arg, struct tcp_pcb *tpcb, u16_t len) {
     (void) arg;
     (void) tpcb;
-    (void) len;
-    // espaço liberado — podemos limpar a mensagem pendente se for a que estava na fila
-    if (has_pending_msg) {
-        // assumimos que a mensagem foi enviada corretamente, então marcamos como enviada
-        has_pending_msg = 0;
-        pending_msg[0] = '\0';
-        // se você quiser manter histórico ou enviar a próxima mensagem, faria aqui
+
+    net_meter_acked(&meter, len, to_ms_since_boot(get_absolute_time()));
+
+    // o TCP confirmou, mas os registros só saem da fila com o ACK do
+    // servidor; o espaço liberado no TCP recebe os próximos
+    return tcp_client_output();
+}
+
+// dados do servidor: quadros ACK
+static err_t tcp_client_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err) {
+    (void) arg;
+
+    if (p == NULL) {
+        // o servidor fechou: o que não foi confirmado vai de novo
+        printf("tcp_client_recv: conexão fechada pelo servidor\n");
+        tcp_abort(tpcb);   // tcp_client_err devolve o que estava em voo à fila
+        return ERR_ABRT;
     }
-    return ERR_OK;
+    if (err != ERR_OK) {
+        pbuf_free(p);
+        return ERR_OK;
+    }
+
+    for (struct pbuf *q = p; q != NULL; q = q->next) {
+        tcp_client_rx((const uint8_t *) q->payload, q->len);
+    }
+    tcp_recved(tpcb, p->tot_len);
+    pbuf_free(p);
+
+    // a janela de registros abriu
+    return tcp_client_output();
 }
 
 /* ------------- TCP helpers ---------------- */
 
-// cria novo pcb, registra callbacks e tenta conectar
-void tcp_client_start(void) {
+bool tcp_client_init(void) {
+    if (outbox_ready) {
+        return true;
+    }
+    outbox_init(&outbox, TCP_OUTBOX_POLICY);
+    outbox.pin_inflight = TCP_ZERO_COPY;
+    outbox_ready = true;
+
+#if TCP_USE_FLASH_LOG
+    use_flash_log = flash_log_init();
+#endif
+
+    // sem o log, a numeração recomeça a cada boot e o HELLO avisa o servidor
+    uint32_t epoch = use_flash_log ? flash_log_new_epoch() : 0;
+    seq_reset = (epoch == 0);
+    next_seq = ((uint64_t) epoch << 32) | 1;
+    acked_seq = 0;
+    telemetry_delta_reset(&delta);
+    pico_get_unique_board_id_string(station_id, sizeof(station_id));
+    printf("tcp_client: estação %s, época %lu\n", station_id, (unsigned long) epoch);
+
+    // jitter diferente em cada placa (FNV-1a do id)
+    uint32_t seed = 2166136261u;
+    for (const char *c = station_id; *c; c++) seed = (seed ^ (uint8_t) *c) * 16777619u;
+    reconnect_init(&reconnect, seed);
+
+    return endpoints_init(&servers, SERVER_ENDPOINTS, SERVER_PORT, "tcp_client");
+}
+
+// cria novo pcb, registra callbacks e tenta conectar ao servidor resolvido
+static void tcp_client_open(void) {
     if (client_pcb) {
         // se já existe um pcb, não cria outro
         return;
@@ -97,6 +445,7 @@ void tcp_client_start(void) {
     if (!client_pcb) {
         printf("tcp_client_start: erro ao criar PCB\n");
         tcp_trying_connect = 0;
+        reconnect_lost(&reconnect, to_ms_since_boot(get_absolute_time()));
         return;
     }
 
@@ -105,8 +454,16 @@ void tcp_client_start(void) {
     tcp_err(client_pcb, tcp_client_err);
     tcp_poll(client_pcb, tcp_client_poll, 4);  // poll a cada 4 * (tcp timer) - ajuste se necessário
     tcp_sent(client_pcb, tcp_client_sent);
+    tcp_recv(client_pcb, tcp_client_recv);
+
+    // servidor que sumiu sem RST: sondas na conexão ociosa
+    ip_set_option(client_pcb, SOF_KEEPALIVE);
+    client_pcb->keep_idle = TCP_KEEPALIVE_IDLE_MS;
+    client_pcb->keep_intvl = TCP_KEEPALIVE_INTVL_MS;
+    client_pcb->keep_cnt = TCP_KEEPALIVE_CNT;
 
-    err_t err = tcp_connect(client_pcb, &server_addr, SERVER_PORT, tcp_client_connected);
+    const endpoint_t *server = endpoints_current(&servers);
+    err_t err = tcp_connect(client_pcb, endpoints_addr(&servers), server->port, tcp_client_connected);
     if (err != ERR_OK) {
         printf("tcp_client_start: falha tcp_connect: %d\n", err);
         // cleanup e sinaliza tentativa futura
@@ -118,27 +475,83 @@ void tcp_client_start(void) {
     }
 
     tcp_trying_connect = 1;
-    printf("tcp_client_start: iniciando tentativa de conexão...\n");
+    connect_since_ms = to_ms_since_boot(get_absolute_time());
+    printf("tcp_client_start: conectando a %s (%s:%u)...\n", server->host,
+           ipaddr_ntoa(endpoints_addr(&servers)), (unsigned) server->port);
+}
+
+// nome resolvido (ou não) depois de uma consulta (contexto do lwIP)
+static void tcp_client_resolved(endpoints_t *e, bool ok) {
+    (void) e;
+    tcp_trying_connect = 0;
+    if (ok) {
+        tcp_client_open();
+    }
+    else {
+        reconnect_lost(&reconnect, to_ms_since_boot(get_absolute_time()));
+    }
+}
+
+// nova tentativa: resolve o servidor atual e conecta
+static void tcp_client_connect(void) {
+    if (client_pcb || tcp_trying_connect) {
+        return;
+    }
+    reconnect_attempt(&reconnect);
+
+    switch (endpoints_resolve(&servers, tcp_client_resolved)) {
+    case ENDPOINTS_READY:
+        tcp_client_open();
+        break;
+    case ENDPOINTS_PENDING:
+        tcp_trying_connect = 1;   // tcp_client_resolved continua
+        break;
+    default:
+        reconnect_lost(&reconnect, to_ms_since_boot(get_absolute_time()));
+        break;
+    }
+}
+
+// link novo: a agenda recomeça do zero, pelo primeiro servidor da lista, e
+// a tentativa sai já
+void tcp_client_start(void) {
+    reconnect_reset(&reconnect);
+    endpoints_reset(&servers);
+    tcp_client_connect();
 }
 
 // fecha e limpa pcb (uso quando quiser desconectar explicitamente)
 void tcp_client_close(void) {
     if (client_pcb) {
         tcp_arg(client_pcb, NULL);
+        tcp_err(client_pcb, NULL);
         tcp_sent(client_pcb, NULL);
-        tcp_close(client_pcb);
+        tcp_recv(client_pcb, NULL);
+        tcp_poll(client_pcb, NULL, 0);
+        // sem cópia, um pcb fechando ainda retransmitiria dos nossos buffers:
+        // com dados em voo, aborta (eles vão de novo na próxima conexão)
+        bool referenced = TCP_ZERO_COPY && (outbox_in_flight(&outbox) || (use_flash_log && flash_log_inflight_bytes()));
+        if (referenced || tcp_close(client_pcb) != ERR_OK) {
+            tcp_abort(client_pcb);
+        }
         client_pcb = NULL;
     }
-    tcp_connected_flag = 0;
-    tcp_trying_connect = 0;
+    // sem confirmação, o que estava em voo vai de novo na próxima conexão
+    tcp_client_lost();
 }
 
-// tenta reconectar recriando o PCB
+// tenta reconectar recriando o PCB, se a agenda permitir
 void tcp_client_try_reconnect(void) {
+    if (!reconnect_due(&reconnect, to_ms_since_boot(get_absolute_time()))) {
+        return;
+    }
+
     // se já existe pcb, tenta conectar usando ele (mas normalmente client_pcb == NULL aqui)
     if (client_pcb) {
         // se pcb existe mas não conectado, tente conectar novamente
-        err_t err = tcp_connect(client_pcb, &server_addr, SERVER_PORT, tcp_client_connected);
+        reconnect_attempt(&reconnect);
+        err_t err = tcp_connect(client_pcb, endpoints_addr(&servers), endpoints_current(&servers)->port,
+                                tcp_client_connected);
         if (err != ERR_OK) {
             printf("tcp_client_try_reconnect: reconnect falhou: %d\n", err);
             tcp_abort(client_pcb);
@@ -146,81 +559,293 @@ void tcp_client_try_reconnect(void) {
             tcp_trying_connect = 0;
         } else {
             tcp_trying_connect = 1;
+            connect_since_ms = to_ms_since_boot(get_absolute_time());
         }
         return;
     }
 
     // cria novo pcb
-    tcp_client_start();
+    tcp_client_connect();
+}
+
+uint32_t tcp_client_reconnect_due_ms(uint32_t now_ms) {
+    return reconnect_wait_ms(&reconnect, now_ms);
+}
+
+const reconnect_stats_t *tcp_client_reconnect_stats(void) {
+    return &reconnect.stats;
+}
+
+void tcp_client_health(net_health_t *h) {
+    net_meter_report(&meter, h);
+    h->conn_attempts = reconnect.stats.attempts;
+    h->conn_failures = reconnect.stats.failures;
+    h->backlog = tcp_client_backlog();
 }
 
-// função de envio resiliente: tenta enviar; se não puder, armazena em pending_msg
 void tcp_client_send(const char *msg) {
     if (!msg) return;
+    tcp_client_send_record(msg, strlen(msg));
+}
+
+// enfileira o registro e envia o que der; nada é sobrescrito durante quedas
+void tcp_client_send_record(const void *data, size_t len) {
+    if (!data || !outbox_ready) return;
 
-    // se já tem pending, sobrescreve (simples política). Pode ser alterado para fila real.
-    int len = strlen(msg);
-    if (len <= 0 || len >= PENDING_MSG_MAX) {
-        printf("tcp_client_send: tamanho inválido (%d bytes)\n", len);
+    if (len == 0 || len > OUTBOX_RECORD_MAX - TCP_DATA_HDR) {
+        printf("tcp_client_send: tamanho inválido (%u bytes)\n", (unsigned) len);
         return;
     }
 
-    // se não conectado, armazena e tenta reconectar
-    if (!tcp_connected_flag || client_pcb == NULL) {
-        printf("tcp_client_send: não conectado, armazenando mensagem e tentando reconectar\n");
-        strncpy(pending_msg, msg, PENDING_MSG_MAX - 1);
-        pending_msg[PENDING_MSG_MAX - 1] = '\0';
-        has_pending_msg = 1;
-        if (!tcp_trying_connect) {
-            tcp_client_try_reconnect();
+    // a fila e o log guardam o quadro pronto, com o seq, para o envio
+    // continuar sem cópia e o reenvio repetir o mesmo número
+    uint16_t body = (uint16_t) (8 + len);
+    frame_buf[0] = TCP_FRAME_MAGIC;
+    frame_buf[1] = TCP_FRAME_DATA;
+    frame_buf[2] = (uint8_t) body;
+    frame_buf[3] = (uint8_t) (body >> 8);
+    put_le64(&frame_buf[TCP_FRAME_HDR], next_seq++);
+    memcpy(&frame_buf[TCP_DATA_HDR], data, len);
+    data = frame_buf;
+    len += TCP_DATA_HDR;
+
+    bool online = tcp_connected_flag && client_pcb != NULL;
+    bool stored = false;
+
+    if (!online && use_flash_log) {
+        // queda: a fila e a mensagem nova vão para a flash, em ordem
+        tcp_client_spill();
+        stored = flash_log_append(data, (uint16_t) len);
+    }
+
+    if (!stored) {
+        if (!outbox_push(&outbox, data, (uint16_t) len) && TCP_OUTBOX_POLICY == OUTBOX_DROP_NEWEST) {
+            printf("tcp_client_send: fila cheia, mensagem descartada\n");
+        }
+        if (!online) {
+            late_mark = outbox.head;
+        }
+        if (batch_count++ == 0) {
+            batch_since_ms = to_ms_since_boot(get_absolute_time());
         }
+        batch_bytes += len;
+    }
+
+    if (online) {
+        tcp_client_flush();
         return;
     }
 
-    // tentamos escrever diretamente
-    err_t err = tcp_write(client_pcb, msg, len, TCP_WRITE_FLAG_COPY);
+    // se não conectado, a mensagem espera e tentamos reconectar
+    if (!tcp_trying_connect) {
+        tcp_client_try_reconnect();
+    }
+}
 
-    if (err == ERR_OK) {
-        // solicita envio inmediato do stack
-        err = tcp_output(client_pcb);
+// move para o log os registros da fila (nenhum está em voo sem conexão)
+static void tcp_client_spill(void) {
+    uint16_t len;
+    while ((len = outbox_next(&outbox, tx_scratch, sizeof(tx_scratch))) > 0) {
+        if (!flash_log_append(tx_scratch, len)) {
+            return;   // o resto fica na RAM
+        }
+        outbox_advance(&outbox);
+        outbox_ack(&outbox, len);
+    }
+}
+
+// entrega um registro (um ou dois trechos) ao TCP; false se não coube ou a
+// conexão caiu. Sem cópia, o lwIP guarda referências aos trechos até o ack.
+// Só o último do lote vai sem MORE, para o PSH sair no segmento final
+static bool tcp_client_write(const outbox_span_t *span, int n, bool last, bool copy) {
+    uint32_t len = span[0].len + (n > 1 ? span[1].len : 0);
+
+    // sem espaço: o tcp_client_sent chama de novo quando liberar. Cada
+    // trecho pode ocupar até dois pbufs na fila do pcb
+    if (len > tcp_sndbuf(client_pcb) || tcp_sndqueuelen(client_pcb) + 2 * n > TCP_SND_QUEUELEN) {
+        return false;
+    }
+
+    for (int i = 0; i < n; i++) {
+        u8_t flags = (TCP_ZERO_COPY && !copy) ? 0 : TCP_WRITE_FLAG_COPY;
+        if (!last || i + 1 < n) {
+            flags |= TCP_WRITE_FLAG_MORE;
+        }
+
+        err_t err = tcp_client_put(span[i].data, span[i].len, flags);
+        if (err == ERR_MEM && i == 0) {
+            return false;
+        }
         if (err != ERR_OK) {
-            printf("tcp_client_send: tcp_output retornou %d\n", err);
-            // manter a mensagem como pendente para tentar depois
-            strncpy(pending_msg, msg, PENDING_MSG_MAX - 1);
-            has_pending_msg = 1;
-        } else {
-            // tudo bem: registramos que não há pendente
-            has_pending_msg = 0;
+            // outros erros (ou registro pela metade no stream): derruba a
+            // conexão; quem chamou devolve ERR_ABRT ao lwIP e a reconexão
+            // sai da tarefa de rede (tcp_client_flush) ou do poll
+            printf("tcp_client_flush: erro ao tcp_write: %d\n", err);
+            tcp_abort(client_pcb);   // chama tcp_client_err (rewind da fila)
+            return false;
         }
-        return;
     }
+    return true;
+}
 
-    if (err == ERR_MEM) {
-        // Buffer do TCP cheio: armazena a mensagem e deixe o callback tcp_client_sent liberar
-        printf("tcp_client_send: ERR_MEM (buffer cheio). Salvando mensagem para retry\n");
-        strncpy(pending_msg, msg, PENDING_MSG_MAX - 1);
-        has_pending_msg = 1;
-        return;
+// envia um quadro da flash ou da fila e o registra na janela de ACK; o
+// que o servidor já confirmou (reenvio após queda) só é liberado
+static bool tcp_client_send_frame(const outbox_span_t *span, int n, bool last, bool from_log) {
+    uint64_t seq = frame_seq(span);
+    uint16_t len = (uint16_t) (span[0].len + (n > 1 ? span[1].len : 0));
+
+    if (seq <= acked_seq && pending_count == 0) {
+        if (from_log) {
+            flash_log_advance();
+            flash_log_ack(len);
+        }
+        else {
+            outbox_advance(&outbox);
+            outbox_ack(&outbox, len);
+        }
+        return true;
     }
 
-    // outros erros: marca desconexão e tenta reconectar
-    printf("tcp_client_send: erro ao tcp_write: %d\n", err);
-    strncpy(pending_msg, msg, PENDING_MSG_MAX - 1);
-    has_pending_msg = 1;
+    if (pending_count == TCP_APP_WINDOW) {
+        return false;
+    }
 
-    // força reconexão
-    if (client_pcb) {
-        tcp_abort(client_pcb);
-        client_pcb = NULL;
+    // registro binário: vai comprimido, e só então vira a referência
+    telemetry_delta_t next = delta;
+    uint16_t packed = TCP_DELTA ? tcp_client_compress(span, len, seq, &next) : 0;
+    if (packed > 0) {
+        outbox_span_t frame = { delta_frame, packed };
+        if (!tcp_client_write(&frame, 1, last, true)) {
+            return false;
+        }
+        delta = next;
+        delta_seq = seq;
     }
-    tcp_connected_flag = 0;
-    tcp_trying_connect = 0;
-    tcp_client_try_reconnect();
+    else if (!tcp_client_write(span, n, last, false)) {
+        return false;
+    }
+    if (from_log) {
+        flash_log_advance();
+    }
+    else {
+        outbox_advance(&outbox);
+    }
+
+    if (pending_count == 0) {
+        ack_wait_ms = to_ms_since_boot(get_absolute_time());
+    }
+    pending[(pending_head + pending_count) % TCP_APP_WINDOW] = (tcp_pending_t) { seq, len, from_log };
+    pending_count++;
+    return true;
+}
+
+// lote pronto para sair: cheio, vencido ou com atraso acumulado (flash, queda)
+static bool tcp_client_batch_ready(void) {
+    if (batch_release || batch_count >= station_config.batch_records || batch_bytes >= TCP_MSS) {
+        return true;
+    }
+    if (use_flash_log && flash_log_has_unsent()) {
+        return true;
+    }
+    return batch_count > 0 && tcp_client_batch_due_ms(to_ms_since_boot(get_absolute_time())) == 0;
+}
+
+uint32_t tcp_client_batch_due_ms(uint32_t now_ms) {
+    if (batch_count == 0 || batch_release) {
+        return UINT32_MAX;
+    }
+    uint32_t age = now_ms - batch_since_ms;
+    uint32_t delay = station_config.batch_delay_ms;
+    return age >= delay ? 0 : delay - age;
 }
 
-/* periodic check to flush pending messages (chamado no main loop) */
-void tcp_client_flush_pending_if_possible(void) {
-    if (has_pending_msg && tcp_connected_flag && client_pcb) {
-        tcp_client_send(pending_msg);
+// entrega ao TCP os registros pendentes, em ordem, enquanto couberem.
+// ERR_ABRT se a conexão foi abortada no meio: num callback do lwIP, é o
+// que ele precisa retornar (o pcb já não existe)
+static err_t tcp_client_output(void) {
+    if (!outbox_ready || !tcp_connected_flag || client_pcb == NULL) {
+        return ERR_OK;
+    }
+    if (!tcp_client_batch_ready()) {
+        return ERR_OK;
+    }
+    // daqui em diante o lote sai conforme o TCP liberar espaço
+    batch_release = true;
+
+    bool wrote = false;
+    bool full = false;
+    outbox_span_t span[2];
+    int n;
+
+    // primeiro o que ficou na flash (mais antigo), lido direto pelo XIP; a
+    // região só é apagada sem conexão, então a referência segue válida
+    while (use_flash_log && (span[0].data = flash_log_next(&span[0].len)) != NULL) {
+        bool last = flash_log_next_is_last() && !outbox_has_unsent(&outbox);
+        if (!tcp_client_send_frame(span, 1, last, true)) {
+            full = true;
+            break;
+        }
+        wrote = true;
+    }
+
+    // depois a fila, no próprio buffer circular
+    while (!full && (n = outbox_peek(&outbox, span)) > 0) {
+        if (!tcp_client_send_frame(span, n, outbox_next_is_last(&outbox), false)) {
+            break;
+        }
+        wrote = true;
     }
-}
\ No newline at end of file
+
+    if (client_pcb == NULL) {
+        return ERR_ABRT;   // conexão abortada no meio do lote
+    }
+    if (!outbox_has_unsent(&outbox)) {
+        // tudo entregue ao TCP: o próximo registro abre outro lote
+        batch_count = 0;
+        batch_bytes = 0;
+        batch_release = false;
+    }
+    if (wrote) {
+        // solicita envio imediato do stack (um tcp_output para o lote)
+        err_t err = tcp_output(client_pcb);
+        if (err != ERR_OK) {
+            // os registros seguem em voo; o stack tenta de novo sozinho
+            printf("tcp_client_flush: tcp_output retornou %d\n", err);
+        }
+    }
+    return ERR_OK;
+}
+
+// fora dos callbacks (tarefa de rede): se a conexão caiu no envio, já
+// tenta outra, conforme a agenda
+void tcp_client_flush(void) {
+    if (tcp_client_output() == ERR_ABRT) {
+        tcp_client_try_reconnect();
+    }
+}
+
+// grava na flash as confirmações recebidas, para o boot não reenviar
+void tcp_client_sync(void) {
+    if (use_flash_log) {
+        flash_log_sync();
+    }
+}
+
+uint32_t tcp_client_backlog(void) {
+    uint32_t n = outbox_ready ? outbox.stats.depth : 0;
+    if (use_flash_log) {
+        n += flash_log_stats()->entries;
+    }
+    return n;
+}
+
+bool tcp_client_late(void) {
+    if (use_flash_log && flash_log_stats()->entries > 0) {
+        return true;
+    }
+    return outbox_ready && outbox_holds(&outbox, late_mark);
+}
+
+const outbox_stats_t *tcp_client_outbox_stats(void) {
+    return &outbox.stats;
+}
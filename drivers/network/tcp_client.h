@@ -10,29 +10,158 @@
 #include "lwip/err.h"
 #include "lwip/ip_addr.h"
 
+#include "outbox.h"
+#include "reconnect.h"
+#include "net_health.h"
+#include "drivers/storage/flash_log.h"
+#include "drivers/telemetry/telemetry.h"
+
 // --- TCP ---
+#ifndef SERVER_IP
 #define SERVER_IP "192.168.1.105" // IP do servidor Python
+#endif
 #define SERVER_PORT 9999
-#define PENDING_MSG_MAX 1024
+
+// servidores em ordem de preferência, "host[:porta],..." (endpoints.h):
+// nomes vão ao DNS (ou mDNS, os .local) e, se o atual não responde, a
+// reconexão seguinte vai ao próximo. Sem a lista, só SERVER_IP
+#ifndef SERVER_ENDPOINTS
+#define SERVER_ENDPOINTS SERVER_IP
+#endif
+
+// política da fila de saída quando enche durante uma queda longa
+#ifndef TCP_OUTBOX_POLICY
+#define TCP_OUTBOX_POLICY OUTBOX_DROP_OLDEST
+#endif
+
+// 1: sem conexão, os registros vão para o log na flash (drivers/storage)
+#ifndef TCP_USE_FLASH_LOG
+#define TCP_USE_FLASH_LOG 1
+#endif
+
+// lote: registros novos esperam até juntar TCP_BATCH_RECORDS, ou um MSS de
+// dados, ou até o mais antigo completar TCP_BATCH_DELAY_MS; saem juntos com
+// TCP_WRITE_FLAG_MORE e um só tcp_output. 1 desliga o lote. São os valores
+// de boot: o servidor ajusta em tempo de execução (station_config.h)
+#ifndef TCP_BATCH_RECORDS
+#define TCP_BATCH_RECORDS 10
+#endif
+#ifndef TCP_BATCH_DELAY_MS
+#define TCP_BATCH_DELAY_MS 20000
+#endif
+
+// 1: tcp_write sem cópia, referenciando a fila e o log; cada registro só é
+// liberado quando o servidor confirma (depois do tcp_sent)
+#ifndef TCP_ZERO_COPY
+#define TCP_ZERO_COPY 1
+#endif
+
+// --- protocolo com o servidor (server/server.py) ---
+// quadro: magic, tipo, tamanho do corpo (u16 LE) e corpo. Registros sem
+// quadro (JSON ou binário puro) ainda são aceitos, mas sem confirmação
+#define TCP_FRAME_MAGIC   0xF6    // não aparece em UTF-8, como TELEMETRY_BIN_MAGIC
+#define TCP_FRAME_HDR     4
+#define TCP_FRAME_HELLO   1       // flags u8 + id da estação (texto)
+#define TCP_FRAME_DATA    2       // seq u64 + registro
+#define TCP_FRAME_ACK     3       // seq u64: tudo até ele está gravado no servidor
+#define TCP_DATA_HDR      (TCP_FRAME_HDR + 8)
+#define TCP_HELLO_RESET   0x01    // numeração recomeçou (sem log, antes do 1º ACK)
+#define TCP_FRAME_KEY     6       // seq u64 + registro comprimido (quadro-chave)
+#define TCP_FRAME_DELTA   7       // avanço do seq (varint) + registro comprimido
+#define TCP_FRAME_CMD     8       // servidor -> estação: id u16 + ajustes (station_config.h)
+#define TCP_FRAME_CMD_ACK 9       // id u16, resultado u8, par recusado u8 + todos os valores atuais
+#define TCP_CMD_MAX       128     // maior corpo de CMD aceito
+
+// 1: registros binários saem com o codec delta (telemetry_delta_*), contra
+// o anterior da mesma conexão; cada conexão começa com um quadro-chave. A
+// fila e o log seguem guardando o quadro DATA inteiro, então o envio
+// comprimido é com cópia (são poucos bytes)
+#ifndef TCP_DELTA
+#define TCP_DELTA 1
+#endif
+
+// registros enviados aguardando o ACK do servidor; a fila e o log só
+// liberam um registro quando o servidor confirma que o gravou
+#ifndef TCP_APP_WINDOW
+#define TCP_APP_WINDOW 64
+#endif
+
+// servidor mudo (caiu sem RST, ou travou): a conexão ociosa é sondada pelo
+// keepalive do lwIP, TCP_KEEPALIVE_CNT sondas a cada TCP_KEEPALIVE_INTVL_MS
+// depois de TCP_KEEPALIVE_IDLE_MS sem nada do servidor; com registros em
+// voo, o servidor tem TCP_ACK_TIMEOUT_MS para confirmar algum, e o SYN tem
+// TCP_CONNECT_TIMEOUT_MS. Vencido qualquer prazo a conexão é abortada: o
+// que estava em voo volta para a fila e a reconexão segue a agenda (e a
+// lista de servidores), em vez de esperar as retransmissões do lwIP
+#ifndef TCP_KEEPALIVE_IDLE_MS
+#define TCP_KEEPALIVE_IDLE_MS 10000
+#endif
+#ifndef TCP_KEEPALIVE_INTVL_MS
+#define TCP_KEEPALIVE_INTVL_MS 2000
+#endif
+#ifndef TCP_KEEPALIVE_CNT
+#define TCP_KEEPALIVE_CNT 3
+#endif
+#ifndef TCP_ACK_TIMEOUT_MS
+#define TCP_ACK_TIMEOUT_MS 10000
+#endif
+#ifndef TCP_CONNECT_TIMEOUT_MS
+#define TCP_CONNECT_TIMEOUT_MS 10000
+#endif
 
 // --- TCP state (declarações) ---
 extern struct tcp_pcb *client_pcb;
-extern ip_addr_t server_addr;
 extern volatile int tcp_connected_flag;
 extern volatile int tcp_trying_connect;
-extern volatile int has_pending_msg;
 
-// inicializa o cliente TCP (cria PCB e tenta conectar)
+// prepara a fila e recupera o log da flash (tarefa, antes do primeiro
+// envio); false se SERVER_ENDPOINTS é inválida
+bool tcp_client_init(void);
+
+// inicializa o cliente TCP (cria PCB e tenta conectar); é o caminho do
+// link novo: zera a agenda de reconexão e tenta na hora
 void tcp_client_start(void);
 
-// envia mensagem (ou armazena se não conectado)
+// enfileira a mensagem na fila de saída e envia o que couber; sem conexão,
+// ela vai para o log na flash (ou espera na fila, até OUTBOX_BYTES) e
+// dispara a reconexão. Grava a flash: só a partir da tarefa de rede
 void tcp_client_send(const char *msg);
 
-// tenta conectar ou reconectar ao TCP
+// idem para registros binários (ex.: telemetria em ponto fixo). Cada
+// registro recebe o próximo número de sequência da estação
+void tcp_client_send_record(const void *data, size_t len);
+
+// tenta conectar ou reconectar ao TCP, se a agenda (reconnect.h) permitir;
+// durante o backoff não faz nada
 void tcp_client_try_reconnect(void);
 
-// limpa mensagens antigas se for necessário
-void tcp_client_flush_pending_if_possible(void);
+// ms até a agenda permitir a próxima tentativa (0 = já pode, UINT32_MAX =
+// nada agendado)
+uint32_t tcp_client_reconnect_due_ms(uint32_t now_ms);
+const reconnect_stats_t *tcp_client_reconnect_stats(void);
+
+// parte do transporte no registro de saúde: RTT, pico do buffer de envio,
+// conexões e fila
+void tcp_client_health(net_health_t *h);
+
+// envia os registros enfileirados que couberem no buffer do TCP, se o lote
+// estiver completo (ou vencido)
+void tcp_client_flush(void);
+
+// ms até o lote aberto vencer (UINT32_MAX se não há lote esperando)
+uint32_t tcp_client_batch_due_ms(uint32_t now_ms);
+
+// marca na flash os registros do log já confirmados (tarefa)
+void tcp_client_sync(void);
+
+// registros aguardando envio ou confirmação
+uint32_t tcp_client_backlog(void);
+
+// há registros atrasados por uma queda (no log da flash, enfileirados sem
+// conexão ou em voo quando ela caiu); o lote em formação e a espera normal
+// pelo ACK não contam
+bool tcp_client_late(void);
+const outbox_stats_t *tcp_client_outbox_stats(void);
 
 // fecha conexão TCP (opcional)
 void tcp_client_close(void);
@@ -0,0 +1,344 @@
+#include "pico/time.h"
+#include "pico/unique_id.h"
+
+#include "udp_client.h"
+#include "station_config.h"
+#include "endpoints.h"
+
+// registros ainda não colocados em um datagrama
+static outbox_t outbox;
+static bool outbox_ready = false;
+
+static struct udp_pcb *udp_pcb = NULL;
+
+// SERVER_ENDPOINTS; `aimed` quando o pcb já aponta para o atual
+static endpoints_t servers;
+static bool aimed;
+static uint32_t silent_rtos;   // reenvios seguidos sem nenhuma resposta
+
+// numeração dos datagramas, como em tcp_client: época do boot (setor novo
+// do log) nos 32 bits altos e contador a partir de 1
+static uint64_t next_seq;
+static bool seq_reset;   // sem log: o servidor esquece a numeração antiga
+static char station_id[2 * PICO_UNIQUE_BOARD_ID_SIZE_BYTES + 1];
+
+// lote em formação
+static uint32_t batch_since_ms;
+static bool batch_release;   // lote liberado: sai conforme a janela abrir
+static uint32_t late_mark;   // fim (outbox.head) dos registros enfileirados sem servidor
+
+// datagramas enviados aguardando o servidor, em ordem de seq; ficam
+// prontos na RAM para o reenvio seletivo
+typedef struct {
+    uint64_t seq;
+    uint32_t sent_ms;
+    uint16_t len;
+    uint8_t records;
+    bool acked;
+    bool late;               // reenviado, ou com registros de antes do servidor responder
+    uint8_t data[UDP_DGRAM_MAX];
+} udp_dgram_t;
+
+static udp_dgram_t window[UDP_WINDOW];
+static uint32_t win_head, win_count;
+static uint32_t win_records;
+
+static uint64_t get_le64(const uint8_t *p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+static void put_le64(uint8_t *p, uint64_t v) {
+    for (int i = 0; i < 8; i++, v >>= 8) p[i] = (uint8_t) v;
+}
+
+static udp_dgram_t *win_at(uint32_t i) {
+    return &window[(win_head + i) % UDP_WINDOW];
+}
+
+static void udp_client_transmit(udp_dgram_t *d) {
+    d->sent_ms = to_ms_since_boot(get_absolute_time());
+    if (udp_pcb == NULL || !aimed) {
+        return;   // sem link (ou sem servidor resolvido): o RTO reenvia depois
+    }
+
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, d->len, PBUF_RAM);
+    if (p == NULL) {
+        return;
+    }
+    pbuf_take(p, d->data, d->len);
+    err_t err = udp_send(udp_pcb, p);
+    pbuf_free(p);
+    if (err != ERR_OK && err != ERR_RTE) {
+        printf("udp_client: udp_send retornou %d\n", err);
+    }
+}
+
+// resposta do servidor: libera o que chegou e reenvia o que falta
+static void udp_client_nack(uint64_t base, uint8_t n, uint32_t missing) {
+    uint32_t now = to_ms_since_boot(get_absolute_time());
+    seq_reset = false;   // a numeração deste boot já é conhecida
+    if (n > UDP_NACK_BITS) {
+        n = UDP_NACK_BITS;   // quadro malformado: o bitmap só tem 32 bits
+    }
+
+    for (uint32_t i = 0; i < win_count; i++) {
+        udp_dgram_t *d = win_at(i);
+        if (d->acked) {
+            continue;
+        }
+        if (d->seq <= base) {
+            d->acked = true;
+        }
+        else if (d->seq - base - 1 < n) {
+            if (!(missing & (1u << (d->seq - base - 1)))) {
+                d->acked = true;
+            }
+            else if (now - d->sent_ms >= UDP_RTO_MS / 4) {
+                // outros NACKs do mesmo lote citam o mesmo buraco: um reenvio só
+                d->late = true;
+                udp_client_transmit(d);
+            }
+        }
+    }
+
+    while (win_count > 0 && win_at(0)->acked) {
+        win_records -= win_at(0)->records;
+        win_head = (win_head + 1) % UDP_WINDOW;
+        win_count--;
+    }
+}
+
+static void udp_client_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port) {
+    (void) arg;
+    (void) pcb;
+    (void) addr;
+    (void) port;
+
+    uint8_t f[TCP_FRAME_HDR + 8 + 1 + 4];
+    u16_t len = pbuf_copy_partial(p, f, sizeof(f), 0);
+    pbuf_free(p);
+
+    if (len == sizeof(f) && f[0] == TCP_FRAME_MAGIC && f[1] == UDP_FRAME_NACK) {
+        silent_rtos = 0;
+        uint32_t missing = f[13] | (f[14] << 8) | (f[15] << 16) | ((uint32_t) f[16] << 24);
+        udp_client_nack(get_le64(&f[4]), f[12], missing);
+        udp_client_flush();
+    }
+}
+
+/* ------------- API ---------------- */
+
+bool udp_client_init(void) {
+    if (outbox_ready) {
+        return true;
+    }
+    outbox_init(&outbox, TCP_OUTBOX_POLICY);
+    outbox_ready = true;
+
+    // o log da flash só fornece a época; os lotes vivem na RAM
+    uint32_t epoch = 0;
+#if TCP_USE_FLASH_LOG
+    if (flash_log_init()) {
+        epoch = flash_log_new_epoch();
+    }
+#endif
+    seq_reset = (epoch == 0);
+    next_seq = ((uint64_t) epoch << 32) | 1;
+    pico_get_unique_board_id_string(station_id, sizeof(station_id));
+    printf("udp_client: estação %s, época %lu\n", station_id, (unsigned long) epoch);
+
+    return endpoints_init(&servers, SERVER_ENDPOINTS, SERVER_PORT, "udp_client");
+}
+
+// aponta o pcb para o servidor atual; o que estava na janela sai de novo já
+static void udp_client_connect(void) {
+    const endpoint_t *server = endpoints_current(&servers);
+    if (udp_connect(udp_pcb, endpoints_addr(&servers), server->port) != ERR_OK) {
+        printf("udp_client_start: falha udp_connect\n");
+        return;
+    }
+    aimed = true;
+    printf("udp_client: enviando para %s (%s:%u)\n", server->host, ipaddr_ntoa(endpoints_addr(&servers)),
+           (unsigned) server->port);
+
+    // o que esperou o servidor sai já, sem esperar o lote vencer
+    if (outbox_holds(&outbox, late_mark)) {
+        batch_release = true;
+    }
+    for (uint32_t i = 0; i < win_count; i++) {
+        if (!win_at(i)->acked) {
+            win_at(i)->late = true;
+            udp_client_transmit(win_at(i));
+        }
+    }
+}
+
+static void udp_client_resolved(endpoints_t *e, bool ok) {
+    (void) e;
+    if (ok && udp_pcb) {
+        udp_client_connect();
+    }
+}
+
+// resolve o servidor atual; sem resposta do DNS, o próximo RTO tenta de novo
+static void udp_client_aim(void) {
+    aimed = false;
+    silent_rtos = 0;
+    if (endpoints_resolve(&servers, udp_client_resolved) == ENDPOINTS_READY) {
+        udp_client_connect();
+    }
+}
+
+void udp_client_start(void) {
+    if (udp_pcb) {
+        udp_remove(udp_pcb);
+    }
+    udp_pcb = udp_new_ip_type(IPADDR_TYPE_V4);
+    if (!udp_pcb) {
+        printf("udp_client_start: erro ao criar PCB\n");
+        return;
+    }
+    udp_recv(udp_pcb, udp_client_recv, NULL);
+
+    // link de volta: do primeiro servidor da lista
+    endpoints_reset(&servers);
+    udp_client_aim();
+}
+
+void udp_client_send(const char *msg) {
+    if (!msg) return;
+    udp_client_send_record(msg, strlen(msg));
+}
+
+void udp_client_send_record(const void *data, size_t len) {
+    if (!data || !outbox_ready) return;
+
+    size_t max = UDP_DGRAM_MAX - UDP_BATCH_HDR - strlen(station_id) - 2;
+    if (len == 0 || len > max || len > OUTBOX_RECORD_MAX) {
+        printf("udp_client_send: tamanho inválido (%u bytes)\n", (unsigned) len);
+        return;
+    }
+    if (outbox.stats.depth == 0) {
+        batch_since_ms = to_ms_since_boot(get_absolute_time());
+    }
+    if (!outbox_push(&outbox, data, (uint16_t) len) && TCP_OUTBOX_POLICY == OUTBOX_DROP_NEWEST) {
+        printf("udp_client_send: fila cheia, mensagem descartada\n");
+    }
+    if (udp_pcb == NULL || !aimed) {
+        late_mark = outbox.head;
+    }
+    udp_client_flush();
+}
+
+// lote cheio (registros ou um datagrama de dados) ou vencido
+static bool udp_client_batch_ready(uint32_t now_ms) {
+    if (outbox.stats.depth == 0) {
+        return false;
+    }
+    uint32_t payload = outbox.stats.bytes;   // cabeçalho da fila = prefixo u16 do datagrama
+    return batch_release || outbox.stats.depth >= station_config.batch_records ||
+           payload >= UDP_DGRAM_MAX - UDP_BATCH_HDR - strlen(station_id) ||
+           now_ms - batch_since_ms >= station_config.batch_delay_ms;
+}
+
+// um datagrama com os registros da fila que couberem
+static void udp_client_pack(udp_dgram_t *d) {
+    uint8_t id_len = (uint8_t) strlen(station_id);
+    uint32_t pos = UDP_BATCH_HDR + id_len;
+    uint16_t len;
+
+    d->seq = next_seq++;
+    d->records = 0;
+    d->acked = false;
+    d->late = outbox_holds(&outbox, late_mark);
+    while (pos + 2 < UDP_DGRAM_MAX &&
+           (len = outbox_next(&outbox, &d->data[pos + 2], (uint16_t) (UDP_DGRAM_MAX - pos - 2))) > 0) {
+        d->data[pos] = (uint8_t) len;
+        d->data[pos + 1] = (uint8_t) (len >> 8);
+        pos += 2 + len;
+        d->records++;
+        outbox_advance(&outbox);
+        outbox_ack(&outbox, len);
+    }
+
+    uint16_t body = (uint16_t) (pos - TCP_FRAME_HDR);
+    d->data[0] = TCP_FRAME_MAGIC;
+    d->data[1] = UDP_FRAME_BATCH;
+    d->data[2] = (uint8_t) body;
+    d->data[3] = (uint8_t) (body >> 8);
+    put_le64(&d->data[4], d->seq);
+    d->data[12] = seq_reset ? TCP_HELLO_RESET : 0;
+    d->data[13] = id_len;
+    memcpy(&d->data[UDP_BATCH_HDR], station_id, id_len);
+    d->len = (uint16_t) pos;
+}
+
+void udp_client_flush(void) {
+    if (!outbox_ready || udp_pcb == NULL) {
+        return;
+    }
+    uint32_t now = to_ms_since_boot(get_absolute_time());
+
+    // sem resposta: reenvia o mais antigo; o NACK dele traz o resto. Um
+    // servidor mudo por UDP_FAILOVER_RTOS reenvios dá lugar ao próximo
+    if (win_count > 0 && !win_at(0)->acked && now - win_at(0)->sent_ms >= UDP_RTO_MS) {
+        if (!aimed && !servers.pending) {
+            udp_client_aim();
+        }
+        else if (aimed && ++silent_rtos >= UDP_FAILOVER_RTOS && servers.count > 1) {
+            endpoints_next(&servers);
+            udp_client_aim();
+        }
+        win_at(0)->late = true;
+        udp_client_transmit(win_at(0));
+    }
+
+    // lote pronto sai inteiro, em quantos datagramas a janela aceitar
+    if (!udp_client_batch_ready(now)) {
+        return;
+    }
+    batch_release = true;
+    while (outbox.stats.depth > 0 && win_count < UDP_WINDOW) {
+        udp_dgram_t *d = win_at(win_count);
+        udp_client_pack(d);
+        win_count++;
+        win_records += d->records;
+        udp_client_transmit(d);
+    }
+    if (outbox.stats.depth == 0) {
+        batch_release = false;
+    }
+}
+
+uint32_t udp_client_due_ms(uint32_t now_ms) {
+    uint32_t due = UINT32_MAX;
+    if (outbox.stats.depth > 0 && win_count < UDP_WINDOW) {
+        uint32_t age = now_ms - batch_since_ms;
+        uint32_t delay = station_config.batch_delay_ms;
+        due = (batch_release || age >= delay) ? 0 : delay - age;
+    }
+    if (win_count > 0) {
+        uint32_t age = now_ms - win_at(0)->sent_ms;
+        uint32_t rto = age >= UDP_RTO_MS ? 0 : UDP_RTO_MS - age;
+        if (rto < due) due = rto;
+    }
+    return due;
+}
+
+uint32_t udp_client_backlog(void) {
+    return (outbox_ready ? outbox.stats.depth : 0) + win_records;
+}
+
+bool udp_client_late(void) {
+    if (outbox_ready && outbox_holds(&outbox, late_mark)) {
+        return true;
+    }
+    for (uint32_t i = 0; i < win_count; i++) {
+        if (!win_at(i)->acked && win_at(i)->late) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,63 @@
+#ifndef UDP_CLIENT_H
+#define UDP_CLIENT_H
+
+#include <stdbool.h>
+
+#include "pico/cyw43_arch.h"
+
+#include "lwip/pbuf.h"
+#include "lwip/udp.h"
+#include "lwip/ip_addr.h"
+
+#include "tcp_client.h"
+
+// --- transporte UDP (alternativo à conexão TCP) ---
+// Cada datagrama leva um lote de registros e um número de sequência, sem
+// handshake: a estação manda o lote numa rajada e o servidor responde com
+// um NACK (base + mapa dos que faltam). Só os faltantes são reenviados.
+// Usa os mesmos servidores (SERVER_ENDPOINTS), com os quadros de tcp_client.h
+
+// quadros UDP (mesmo cabeçalho TCP_FRAME_*)
+#define UDP_FRAME_BATCH   4   // seq u64, flags u8, id (u8 + texto), registros (u16 + dados)
+#define UDP_FRAME_NACK    5   // base u64, n u8, faltando u32: bit i = base + 1 + i
+#define UDP_BATCH_HDR     (TCP_FRAME_HDR + 8 + 1 + 1)
+#define UDP_NACK_BITS     32
+
+#ifndef UDP_DGRAM_MAX
+#define UDP_DGRAM_MAX     1200   // abaixo do MTU do Wi-Fi: sem fragmentação IP
+#endif
+#ifndef UDP_WINDOW
+#define UDP_WINDOW        8      // datagramas aguardando o servidor
+#endif
+#ifndef UDP_RTO_MS
+#define UDP_RTO_MS        3000   // sem resposta: reenvia o mais antigo
+#endif
+#ifndef UDP_FAILOVER_RTOS
+#define UDP_FAILOVER_RTOS 3      // reenvios sem resposta antes de passar ao próximo servidor
+#endif
+
+// prepara a fila e a numeração (tarefa, antes do primeiro envio); false
+// se SERVER_ENDPOINTS é inválida
+bool udp_client_init(void);
+
+// (re)cria o pcb e aponta para o servidor; chamado quando o link sobe
+void udp_client_start(void);
+
+// enfileira um registro (JSON ou binário); sai no próximo lote
+void udp_client_send_record(const void *data, size_t len);
+void udp_client_send(const char *msg);
+
+// monta e envia os lotes prontos e reenvia os vencidos
+void udp_client_flush(void);
+
+// ms até o próximo lote ou reenvio (UINT32_MAX se nada espera)
+uint32_t udp_client_due_ms(uint32_t now_ms);
+
+// registros aguardando envio ou confirmação
+uint32_t udp_client_backlog(void);
+
+// há registros atrasados (reenviados, ou enfileirados sem servidor); o lote
+// em formação e os datagramas esperando o primeiro NACK não contam
+bool udp_client_late(void);
+
+#endif // UDP_CLIENT_H
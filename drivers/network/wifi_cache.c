@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/flash.h"
+#include "hardware/sync.h"
+
+#include "wifi_cache.h"
+
+#define WIFI_CACHE_FLASH_TIMEOUT_MS 100
+
+static wifi_cache_t cache;
+static bool cache_valid = false;
+static bool lease_this_boot = false;  // lease_at_ms vale (concessão obtida desde o boot)
+static uint32_t lease_at_ms;
+static bool lease_from_flash = false; // concessão do boot anterior, ainda não usada
+
+static uint32_t wifi_cache_crc(const wifi_cache_t *c) {
+    // FNV-1a sobre tudo menos o próprio crc
+    const uint8_t *p = (const uint8_t *) c;
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < offsetof(wifi_cache_t, crc); i++) {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h;
+}
+
+#if WIFI_CACHE_USE_FLASH
+// roda com as interrupções desligadas e o outro core parado (flash_safe_execute)
+static void wifi_cache_flash_write(void *param) {
+    static uint8_t page[FLASH_PAGE_SIZE];
+    memset(page, 0xFF, sizeof(page));
+    memcpy(page, param, sizeof(wifi_cache_t));
+
+    flash_range_erase(WIFI_CACHE_FLASH_OFFSET, FLASH_SECTOR_SIZE);
+    flash_range_program(WIFI_CACHE_FLASH_OFFSET, page, FLASH_PAGE_SIZE);
+}
+
+static void wifi_cache_save(void) {
+    int rc = flash_safe_execute(wifi_cache_flash_write, &cache, WIFI_CACHE_FLASH_TIMEOUT_MS);
+    if (rc != PICO_OK) {
+        printf("wifi_cache: falha ao gravar na flash (%d)\n", rc);
+    }
+}
+#endif
+
+bool wifi_cache_load(void) {
+#if WIFI_CACHE_USE_FLASH
+    const wifi_cache_t *stored = (const wifi_cache_t *) (XIP_BASE + WIFI_CACHE_FLASH_OFFSET);
+    if (stored->magic == WIFI_CACHE_MAGIC && stored->crc == wifi_cache_crc(stored)) {
+        cache = *stored;
+        cache_valid = true;
+        lease_from_flash = cache.has_lease;
+        printf("wifi_cache: AP salvo canal %u, ip %s\n", cache.channel,
+               cache.has_lease ? ip4addr_ntoa((const ip4_addr_t *) &cache.ip) : "-");
+    }
+#endif
+    return cache_valid;
+}
+
+const wifi_cache_t *wifi_cache_get(void) {
+    return cache_valid ? &cache : NULL;
+}
+
+void wifi_cache_update(const uint8_t bssid[6], uint8_t channel,
+                       uint32_t ip, uint32_t netmask, uint32_t gw, uint32_t lease_s,
+                       uint32_t now_ms) {
+    lease_this_boot = (ip != 0);
+    lease_at_ms = now_ms;
+    lease_from_flash = false;
+
+    wifi_cache_t next;
+    memset(&next, 0, sizeof(next));
+    next.magic = WIFI_CACHE_MAGIC;
+    memcpy(next.bssid, bssid, sizeof(next.bssid));
+    next.channel = channel;
+    next.has_lease = (ip != 0);
+    next.ip = ip;
+    next.netmask = netmask;
+    next.gw = gw;
+    next.lease_s = lease_s;
+    next.crc = wifi_cache_crc(&next);
+
+    // nada mudou (a cópia em RAM é a da flash, mesmo invalidada): evita
+    // desgastar a flash
+    if (memcmp(&next, &cache, sizeof(next)) == 0) {
+        cache_valid = true;
+        return;
+    }
+
+    cache = next;
+    cache_valid = true;
+#if WIFI_CACHE_USE_FLASH
+    wifi_cache_save();
+#endif
+}
+
+bool wifi_cache_lease_valid(uint32_t now_ms) {
+    if (!cache_valid || !cache.has_lease) {
+        return false;
+    }
+    if (!lease_this_boot) {
+        return lease_from_flash;
+    }
+    return (now_ms - lease_at_ms) / 1000 < cache.lease_s / 2;
+}
+
+void wifi_cache_lease_used(void) {
+    lease_from_flash = false;
+}
+
+void wifi_cache_invalidate(void) {
+    cache_valid = false;
+}
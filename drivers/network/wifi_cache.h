@@ -0,0 +1,57 @@
+#ifndef WIFI_CACHE_H
+#define WIFI_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "pico/cyw43_arch.h"
+#include "hardware/flash.h"
+
+// 1: a cache também é gravada no último setor da flash (sobrevive ao reboot)
+#ifndef WIFI_CACHE_USE_FLASH
+#define WIFI_CACHE_USE_FLASH     1
+#endif
+
+#define WIFI_CACHE_FLASH_OFFSET  (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE)
+#define WIFI_CACHE_MAGIC         0x57434331u  // "WCC1"
+
+// último AP e concessão DHCP que funcionaram
+typedef struct {
+    uint32_t magic;
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint8_t has_lease;     // ip/netmask/gw válidos
+    uint32_t ip;           // endereços em ordem de rede (ip4_addr_t.addr)
+    uint32_t netmask;
+    uint32_t gw;
+    uint32_t lease_s;      // duração da concessão recebida do DHCP (T1 = metade)
+    uint32_t crc;
+} wifi_cache_t;
+
+// carrega da flash (se habilitado); false se não houver cache válida
+bool wifi_cache_load(void);
+
+// cache atual (NULL se inválida)
+const wifi_cache_t *wifi_cache_get(void);
+
+// atualiza a cache com o estado do link atual (concessão confirmada pelo
+// DHCP em now_ms); grava na flash só se mudou
+void wifi_cache_update(const uint8_t bssid[6], uint8_t channel,
+                       uint32_t ip, uint32_t netmask, uint32_t gw, uint32_t lease_s,
+                       uint32_t now_ms);
+
+// true se a concessão da cache pode ser usada antes do DHCP responder:
+// obtida neste boot e antes do T1, ou a da flash, uma vez no boot. Sem
+// relógio, a idade dela é desconhecida; o DHCP segue rodando e confirma o
+// endereço ou troca por outro
+bool wifi_cache_lease_valid(uint32_t now_ms);
+
+// a concessão da flash foi aplicada: não vale de novo neste boot
+void wifi_cache_lease_used(void);
+
+// descarta a cache (ex.: o AP salvo não respondeu); a flash só é regravada
+// na próxima conexão, com o AP atual
+void wifi_cache_invalidate(void);
+
+#endif
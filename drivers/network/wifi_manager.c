@@ -0,0 +1,209 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "lwip/netif.h"
+#include "lwip/dhcp.h"
+
+#include "wifi_manager.h"
+#include "wifi_cache.h"
+
+static const char *wifi_ssid;
+static const char *wifi_pass;
+static uint32_t wifi_auth;
+
+static wifi_state_t state = WIFI_STATE_IDLE;
+static wifi_stats_t stats;
+
+static uint32_t state_since_ms;   // início da tentativa atual (CONNECTING)
+static uint32_t retry_at_ms;      // próxima tentativa (BACKOFF)
+static uint32_t backoff_ms = WIFI_BACKOFF_MIN_MS;
+
+static bool fast_path;            // tentativa atual usa BSSID/canal da cache
+static bool static_ip_applied;    // IP da cache aplicado antes do DHCP responder
+static bool cache_fresh;          // cache já atualizada nesta conexão
+
+static void wifi_start_attempt(uint32_t now_ms);
+static void wifi_fail(uint32_t now_ms, int status);
+static void wifi_apply_cached_ip(const wifi_cache_t *c);
+static void wifi_refresh_cache(uint32_t now_ms);
+
+void wifi_manager_init(const char *ssid, const char *pass, uint32_t auth) {
+    wifi_ssid = ssid;
+    wifi_pass = pass;
+    wifi_auth = auth;
+    state = WIFI_STATE_IDLE;
+    backoff_ms = WIFI_BACKOFF_MIN_MS;
+
+    wifi_cache_load();
+}
+
+wifi_state_t wifi_manager_poll(uint32_t now_ms) {
+    int status = cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA);
+
+    switch (state) {
+    case WIFI_STATE_IDLE:
+        wifi_start_attempt(now_ms);
+        break;
+
+    case WIFI_STATE_CONNECTING: {
+        const wifi_cache_t *c = wifi_cache_get();
+
+        // associado ao AP salvo: usa a concessão anterior sem esperar o DHCP,
+        // que segue rodando em segundo plano e corrige o endereço se preciso
+        // (wifi_cache_lease_valid: a do boot anterior uma vez, as deste boot
+        // só antes do T1, depois dele o servidor pode ter dado o IP a outro)
+        if (fast_path && !static_ip_applied && c && wifi_cache_lease_valid(now_ms) && status == CYW43_LINK_NOIP) {
+            wifi_apply_cached_ip(c);
+            status = cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA);
+        }
+
+        if (status == CYW43_LINK_UP) {
+            printf("wifi: conectado após %lu ms%s\n", (unsigned long) (now_ms - state_since_ms),
+                   fast_path ? " (cache)" : "");
+            state = WIFI_STATE_CONNECTED;
+            backoff_ms = WIFI_BACKOFF_MIN_MS;
+            if (fast_path) {
+                stats.fast_joins++;
+            }
+        }
+        else if (status == CYW43_LINK_FAIL || status == CYW43_LINK_NONET || status == CYW43_LINK_BADAUTH) {
+            wifi_fail(now_ms, status);
+        }
+        else if (now_ms - state_since_ms > (fast_path ? WIFI_FAST_TIMEOUT_MS : WIFI_CONNECT_TIMEOUT_MS)) {
+            wifi_fail(now_ms, status);
+        }
+        break;
+    }
+
+    case WIFI_STATE_CONNECTED:
+        if (status != CYW43_LINK_UP) {
+            // queda de link: volta a conectar na hora, sem reiniciar o chip
+            printf("wifi: link perdido (status %d)\n", status);
+            stats.link_losses++;
+            wifi_start_attempt(now_ms);
+        }
+        else if (!cache_fresh) {
+            wifi_refresh_cache(now_ms);
+        }
+        break;
+
+    case WIFI_STATE_BACKOFF:
+        if ((int32_t) (now_ms - retry_at_ms) >= 0) {
+            wifi_start_attempt(now_ms);
+        }
+        break;
+    }
+
+    return state;
+}
+
+const wifi_stats_t *wifi_manager_stats(void) {
+    return &stats;
+}
+
+// dispara o join assíncrono; o resultado é observado pelo link status
+static void wifi_start_attempt(uint32_t now_ms) {
+    const wifi_cache_t *c = wifi_cache_get();
+    int err;
+
+    stats.attempts++;
+    state_since_ms = now_ms;
+    static_ip_applied = false;
+    cache_fresh = false;
+    fast_path = (c != NULL);
+
+    if (fast_path) {
+        // rejoin direcionado: BSSID e canal conhecidos, sem varrer os canais
+        err = cyw43_wifi_join(&cyw43_state,
+                              strlen(wifi_ssid), (const uint8_t *) wifi_ssid,
+                              strlen(wifi_pass), (const uint8_t *) wifi_pass,
+                              wifi_auth, c->bssid, c->channel);
+    }
+    else {
+        err = cyw43_arch_wifi_connect_async(wifi_ssid, wifi_pass, wifi_auth);
+    }
+
+    if (err) {
+        printf("wifi: join retornou %d\n", err);
+        wifi_fail(now_ms, err);
+        return;
+    }
+    state = WIFI_STATE_CONNECTING;
+}
+
+static void wifi_fail(uint32_t now_ms, int status) {
+    stats.failures++;
+
+    // aborta o join pendente antes de esperar
+    cyw43_wifi_leave(&cyw43_state, CYW43_ITF_STA);
+
+    if (fast_path) {
+        // o AP salvo não respondeu (mudou de canal, foi trocado...): tenta
+        // de novo já com varredura completa, sem contar como backoff
+        printf("wifi: rejoin pela cache falhou (status %d), varrendo canais\n", status);
+        wifi_cache_invalidate();   // até a próxima conexão gravar o AP atual
+        if (static_ip_applied) {
+            cyw43_arch_lwip_begin();
+            netif_set_addr(&cyw43_state.netif[CYW43_ITF_STA], IP4_ADDR_ANY4, IP4_ADDR_ANY4, IP4_ADDR_ANY4);
+            cyw43_arch_lwip_end();
+        }
+        state = WIFI_STATE_BACKOFF;
+        retry_at_ms = now_ms;
+        return;
+    }
+
+    printf("wifi: falha na conexão (status %d), nova tentativa em %lu ms\n", status, (unsigned long) backoff_ms);
+
+    state = WIFI_STATE_BACKOFF;
+    retry_at_ms = now_ms + backoff_ms;
+
+    backoff_ms *= 2;
+    if (backoff_ms > WIFI_BACKOFF_MAX_MS) {
+        backoff_ms = WIFI_BACKOFF_MAX_MS;
+    }
+}
+
+static void wifi_apply_cached_ip(const wifi_cache_t *c) {
+    ip4_addr_t ip, mask, gw;
+    ip.addr = c->ip;
+    mask.addr = c->netmask;
+    gw.addr = c->gw;
+
+    cyw43_arch_lwip_begin();
+    netif_set_addr(&cyw43_state.netif[CYW43_ITF_STA], &ip, &mask, &gw);
+    cyw43_arch_lwip_end();
+
+    static_ip_applied = true;
+    wifi_cache_lease_used();
+    printf("wifi: usando IP da cache %s\n", ip4addr_ntoa(&ip));
+}
+
+// guarda BSSID, canal e concessão atuais assim que o DHCP confirmar o endereço
+static void wifi_refresh_cache(uint32_t now_ms) {
+    struct netif *n = &cyw43_state.netif[CYW43_ITF_STA];
+    uint32_t ip, mask, gw, lease_s;
+
+    cyw43_arch_lwip_begin();
+    bool bound = dhcp_supplied_address(n);
+    if (bound) {
+        ip = netif_ip4_addr(n)->addr;
+        mask = netif_ip4_netmask(n)->addr;
+        gw = netif_ip4_gw(n)->addr;
+        lease_s = netif_dhcp_data(n)->offered_t0_lease;
+    }
+    cyw43_arch_lwip_end();
+
+    if (!bound) {
+        return;
+    }
+
+    uint8_t bssid[6];
+    uint32_t chan_info[3] = {0};   // channel_info_t: hw, target, scan
+    if (cyw43_wifi_get_bssid(&cyw43_state, bssid) != 0 ||
+        cyw43_ioctl(&cyw43_state, CYW43_IOCTL_GET_CHANNEL, sizeof(chan_info), (uint8_t *) chan_info, CYW43_ITF_STA) != 0) {
+        return;
+    }
+
+    wifi_cache_update(bssid, (uint8_t) chan_info[0], ip, mask, gw, lease_s, now_ms);
+    cache_fresh = true;
+}
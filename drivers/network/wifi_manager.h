@@ -0,0 +1,39 @@
+#ifndef WIFI_MANAGER_H
+#define WIFI_MANAGER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "pico/cyw43_arch.h"
+
+// --- conexão Wi-Fi assíncrona ---
+#define WIFI_CONNECT_TIMEOUT_MS  20000  // desiste de uma tentativa (join + DHCP) após este tempo
+#define WIFI_FAST_TIMEOUT_MS     3000   // desiste do rejoin direcionado (BSSID/canal salvos)
+#define WIFI_BACKOFF_MIN_MS      1000   // primeira espera após falha
+#define WIFI_BACKOFF_MAX_MS      60000  // teto da espera (dobra a cada falha)
+#define WIFI_POLL_MS             250    // intervalo de polling enquanto não está conectado
+
+typedef enum {
+    WIFI_STATE_IDLE = 0,     // ainda não tentou
+    WIFI_STATE_CONNECTING,   // join/DHCP em andamento (cyw43_arch_wifi_connect_async)
+    WIFI_STATE_CONNECTED,    // link up com IP
+    WIFI_STATE_BACKOFF,      // tentativa falhou; aguardando a próxima
+} wifi_state_t;
+
+typedef struct {
+    uint32_t attempts;       // tentativas de conexão iniciadas
+    uint32_t failures;       // tentativas que falharam ou expiraram
+    uint32_t link_losses;    // quedas depois de conectado
+    uint32_t fast_joins;     // conexões pelo caminho rápido (cache)
+} wifi_stats_t;
+
+// guarda as credenciais e carrega a cache do último AP (wifi_cache);
+// a primeira tentativa sai no próximo poll
+void wifi_manager_init(const char *ssid, const char *pass, uint32_t auth);
+
+// avança a máquina de estados sem bloquear; chamar periodicamente
+wifi_state_t wifi_manager_poll(uint32_t now_ms);
+
+const wifi_stats_t *wifi_manager_stats(void);
+
+#endif
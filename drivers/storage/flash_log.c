@@ -0,0 +1,486 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/flash.h"
+#include "pico/time.h"
+
+#include "flash_log.h"
+
+#define LOG_MAGIC         0x31474C46u   // "FLG1"
+#define LOG_SECTORS       (FLASH_LOG_SIZE / FLASH_SECTOR_SIZE)
+#define SEC_HDR           8             // magic + seq
+#define ENT_HDR           8             // len, estado, reservado, crc
+#define ENT_DELIVERED     0x00          // estado gravado depois da confirmação (apagado = 0xFF)
+#define LEN_ERASED        0xFFFF
+#define FLASH_TIMEOUT_MS  100
+
+// até 5 páginas para o maior registro fora do alinhamento
+#define PROG_BUF_PAGES    ((ENT_HDR + FLASH_LOG_RECORD_MAX + 2 * FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE)
+
+_Static_assert(FLASH_LOG_OFFSET % FLASH_SECTOR_SIZE == 0, "FLASH_LOG_OFFSET deve ser alinhado ao setor");
+_Static_assert(ENT_HDR + FLASH_LOG_RECORD_MAX <= FLASH_SECTOR_SIZE - SEC_HDR, "registro não cabe num setor");
+
+typedef struct {
+    uint16_t len;
+    uint8_t state;
+    uint8_t rsv;
+    uint32_t crc;       // sobre len e payload; o estado fica de fora
+} entry_hdr_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;
+} sector_hdr_t;
+
+// Posições são offsets dentro da região. Um head no início exato de um
+// setor (sem o cabeçalho) indica que o setor ainda será apagado no próximo
+// append; nenhuma entrada vive nessa posição.
+static struct {
+    bool ready;
+    bool head_pending;   // setor de head ainda não preparado
+    uint32_t head_seq;   // seq do último setor preparado
+    uint32_t head;       // onde entra o próximo registro
+    uint32_t tail;       // registro mais antigo não confirmado
+    uint32_t cursor;     // próximo registro a enviar
+    uint32_t synced;     // marcas de entrega já gravadas até aqui
+    uint32_t acked;      // bytes confirmados do registro em tail
+    uint32_t inflight;   // bytes em voo ainda não confirmados
+    uint32_t ack_skip;   // confirmações de registros em voo descartados
+    flash_log_stats_t stats;
+} lg;
+
+static uint8_t prog_buf[PROG_BUF_PAGES * FLASH_PAGE_SIZE];
+
+typedef struct {
+    uint32_t offset;     // absoluto na flash
+    const uint8_t *data;
+    uint32_t len;        // múltiplo de FLASH_PAGE_SIZE
+    bool erase;          // apaga o setor antes de gravar
+} log_prog_t;
+
+/* ---------------- utilitários ---------------- */
+
+static const uint8_t *log_ptr(uint32_t pos) {
+    return (const uint8_t *) (XIP_BASE + FLASH_LOG_OFFSET + pos);
+}
+
+static uint32_t sec_of(uint32_t pos) {
+    return pos / FLASH_SECTOR_SIZE;
+}
+
+static uint32_t sec_start(uint32_t sec) {
+    return (sec % LOG_SECTORS) * FLASH_SECTOR_SIZE;
+}
+
+static uint32_t align4(uint32_t n) {
+    return (n + 3) & ~3u;
+}
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *p, uint32_t n) {
+    static const uint32_t tbl[16] = {
+        0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+        0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c,
+    };
+    while (n--) {
+        crc ^= *p++;
+        crc = (crc >> 4) ^ tbl[crc & 15];
+        crc = (crc >> 4) ^ tbl[crc & 15];
+    }
+    return crc;
+}
+
+static uint32_t entry_crc(uint16_t len, const uint8_t *data) {
+    uint8_t l[2] = { (uint8_t) len, (uint8_t) (len >> 8) };
+    uint32_t crc = crc32_update(0xffffffffu, l, 2);
+    return ~crc32_update(crc, data, len);
+}
+
+static uint16_t entry_len(uint32_t pos) {
+    entry_hdr_t h;
+    memcpy(&h, log_ptr(pos), sizeof(h));
+    return h.len;
+}
+
+// entrada íntegra em pos (cabeçalho coerente e CRC batendo)
+static bool entry_ok(uint32_t pos, uint16_t *len) {
+    uint32_t room = FLASH_SECTOR_SIZE - pos % FLASH_SECTOR_SIZE;
+    if (pos % FLASH_SECTOR_SIZE < SEC_HDR || room < ENT_HDR) return false;
+
+    entry_hdr_t h;
+    memcpy(&h, log_ptr(pos), sizeof(h));
+    if (h.len == 0 || h.len == LEN_ERASED || h.len > FLASH_LOG_RECORD_MAX || (uint32_t) ENT_HDR + h.len > room) {
+        return false;
+    }
+    if (entry_crc(h.len, log_ptr(pos) + ENT_HDR) != h.crc) {
+        return false;
+    }
+    *len = h.len;
+    return true;
+}
+
+// primeira posição do setor seguinte (ou head, se ele ainda vai ser preparado)
+static uint32_t next_sector_pos(uint32_t pos) {
+    uint32_t sec = (sec_of(pos) + 1) % LOG_SECTORS;
+    if (lg.head_pending && sec == sec_of(lg.head)) {
+        return lg.head;
+    }
+    return sec_start(sec) + SEC_HDR;
+}
+
+// avança até uma entrada válida ou até head (fim do setor, gravação interrompida)
+static uint32_t log_settle(uint32_t pos) {
+    uint16_t len;
+    for (uint32_t hops = 0; pos != lg.head && !entry_ok(pos, &len); hops++) {
+        if (hops > LOG_SECTORS) return lg.head;
+        pos = next_sector_pos(pos);
+    }
+    return pos;
+}
+
+static uint32_t log_after(uint32_t pos, uint16_t len) {
+    uint32_t next = pos + align4(ENT_HDR + len);
+    if (next % FLASH_SECTOR_SIZE == 0) {
+        next = next_sector_pos(pos);
+    }
+    return log_settle(next);
+}
+
+/* ------------------ gravação ------------------ */
+
+// roda com o outro core parado e as interrupções desligadas (flash_safe_execute)
+static void log_flash_op(void *param) {
+    const log_prog_t *p = param;
+    if (p->erase) {
+        flash_range_erase(p->offset, FLASH_SECTOR_SIZE);
+    }
+    flash_range_program(p->offset, p->data, p->len);
+}
+
+static bool log_program(uint32_t pos, const uint8_t *data, uint32_t len, bool erase) {
+    log_prog_t p = { FLASH_LOG_OFFSET + pos, data, len, erase };
+    int rc = flash_safe_execute(log_flash_op, &p, FLASH_TIMEOUT_MS);
+    if (rc != PICO_OK) {
+        printf("flash_log: falha ao gravar na flash (%d)\n", rc);
+        return false;
+    }
+    return true;
+}
+
+// descarta o que ainda está no setor que vai ser reaproveitado (o mais antigo)
+static void log_drop_sector(uint32_t sec) {
+    bool in_flight = (lg.cursor != lg.tail);
+    uint32_t pos = lg.tail;
+
+    while (pos != lg.head && sec_of(pos) == sec) {
+        uint16_t len = entry_len(pos);
+        if (pos == lg.cursor) in_flight = false;
+        if (in_flight) {
+            // a conexão ainda vai confirmar esses bytes: ignora as confirmações
+            uint32_t rest = len - (pos == lg.tail ? lg.acked : 0);
+            lg.ack_skip += rest;
+            lg.inflight -= rest;
+        }
+        lg.stats.entries--;
+        lg.stats.bytes -= len;
+        lg.stats.dropped++;
+        pos = log_after(pos, len);
+    }
+
+    lg.tail = pos;
+    lg.acked = 0;
+    if (sec_of(lg.cursor) == sec) lg.cursor = lg.tail;
+    if (sec_of(lg.synced) == sec) lg.synced = lg.tail;
+}
+
+// prepara o setor de head: apaga e grava o cabeçalho com o próximo seq
+static bool log_alloc_sector(void) {
+    uint32_t sec = sec_of(lg.head);
+    bool empty = (lg.tail == lg.head);
+
+    if (!empty && sec_of(lg.tail) == sec) {
+        log_drop_sector(sec);
+    }
+
+    sector_hdr_t h = { LOG_MAGIC, lg.head_seq + 1 };
+    memset(prog_buf, 0xFF, FLASH_PAGE_SIZE);
+    memcpy(prog_buf, &h, sizeof(h));
+    if (!log_program(sec_start(sec), prog_buf, FLASH_PAGE_SIZE, true)) {
+        return false;
+    }
+
+    lg.stats.erases++;
+    lg.head_seq = h.seq;
+    lg.head_pending = false;
+    lg.head = sec_start(sec) + SEC_HDR;
+    if (empty) {
+        lg.tail = lg.cursor = lg.synced = lg.head;
+    }
+    return true;
+}
+
+// move head para o início do próximo setor (ainda não preparado)
+static void log_move_head(uint32_t new_head) {
+    if (lg.tail == lg.head) lg.tail = new_head;
+    if (lg.cursor == lg.head) lg.cursor = new_head;
+    if (lg.synced == lg.head) lg.synced = new_head;
+    lg.head = new_head % FLASH_LOG_SIZE;
+    lg.head_pending = true;
+}
+
+/* -------------------- API --------------------- */
+
+bool flash_log_init(void) {
+    memset(&lg, 0, sizeof(lg));
+
+#if PICO_ON_DEVICE
+    // o firmware não pode invadir a região do log
+    extern char __flash_binary_end;
+    if ((uintptr_t) &__flash_binary_end - XIP_BASE > FLASH_LOG_OFFSET) {
+        printf("flash_log: firmware ocupa a região do log, log desativado\n");
+        return false;
+    }
+#endif
+
+    uint64_t t0 = to_us_since_boot(get_absolute_time());
+
+    // setores mais novo e mais antigo pelo número de sequência
+    bool any = false;
+    uint32_t newest = 0, oldest = 0, max_seq = 0, min_seq = 0;
+    for (uint32_t i = 0; i < LOG_SECTORS; i++) {
+        sector_hdr_t h;
+        memcpy(&h, log_ptr(sec_start(i)), sizeof(h));
+        if (h.magic != LOG_MAGIC) continue;
+        if (!any || (int32_t) (h.seq - max_seq) > 0) { max_seq = h.seq; newest = i; }
+        if (!any || (int32_t) (h.seq - min_seq) < 0) { min_seq = h.seq; oldest = i; }
+        any = true;
+    }
+
+    lg.ready = true;
+    lg.head_seq = max_seq;
+
+    if (!any) {
+        // região virgem: o primeiro setor é preparado no primeiro append
+        lg.head = lg.tail = lg.cursor = lg.synced = 0;
+        lg.head_pending = true;
+        return true;
+    }
+
+    // head: primeira posição livre do setor mais novo
+    uint32_t pos = sec_start(newest) + SEC_HDR;
+    uint16_t len;
+    while (pos % FLASH_SECTOR_SIZE != 0 && entry_ok(pos, &len)) {
+        pos += align4(ENT_HDR + len);
+    }
+
+    static const uint8_t erased[ENT_HDR] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+    if (pos % FLASH_SECTOR_SIZE == 0) {
+        lg.head = sec_start(newest + 1);
+        lg.head_pending = true;
+    }
+    else if (FLASH_SECTOR_SIZE - pos % FLASH_SECTOR_SIZE >= ENT_HDR && memcmp(log_ptr(pos), erased, ENT_HDR) != 0) {
+        // gravação interrompida: o resto do setor não é confiável
+        lg.stats.torn++;
+        lg.head = sec_start(newest + 1);
+        lg.head_pending = true;
+    }
+    else {
+        lg.head = pos;
+    }
+
+    // tail: primeiro registro ainda não entregue, a partir do setor mais antigo
+    pos = log_settle(sec_start(oldest) + SEC_HDR);
+    while (pos != lg.head && log_ptr(pos)[2] == ENT_DELIVERED) {
+        pos = log_after(pos, entry_len(pos));
+    }
+    lg.tail = lg.cursor = lg.synced = pos;
+
+    for (pos = lg.tail; pos != lg.head; pos = log_after(pos, len)) {
+        len = entry_len(pos);
+        lg.stats.entries++;
+        lg.stats.bytes += len;
+    }
+
+    lg.stats.scan_us = (uint32_t) (to_us_since_boot(get_absolute_time()) - t0);
+    printf("flash_log: %lu registros pendentes (%lu bytes), recuperado em %lu us\n",
+           (unsigned long) lg.stats.entries, (unsigned long) lg.stats.bytes, (unsigned long) lg.stats.scan_us);
+    return true;
+}
+
+// abre um setor novo: o seq dele cresce a cada boot e nunca se repete
+uint32_t flash_log_new_epoch(void) {
+    if (!lg.ready) {
+        return 0;
+    }
+    if (!lg.head_pending) {
+        log_move_head(sec_start(sec_of(lg.head) + 1));
+    }
+    return log_alloc_sector() ? lg.head_seq : 0;
+}
+
+bool flash_log_ready(void) {
+    return lg.ready;
+}
+
+bool flash_log_append(const void *data, uint16_t len) {
+    if (!lg.ready || len == 0 || len > FLASH_LOG_RECORD_MAX) {
+        return false;
+    }
+
+    uint32_t need = align4(ENT_HDR + len);
+    if (!lg.head_pending && FLASH_SECTOR_SIZE - lg.head % FLASH_SECTOR_SIZE < need) {
+        log_move_head(sec_start(sec_of(lg.head) + 1));
+    }
+    if (lg.head_pending && !log_alloc_sector()) {
+        return false;
+    }
+
+    // páginas afetadas, com 0xFF fora da entrada: gravar 0xFF não altera a flash
+    uint32_t first_page = lg.head & ~(FLASH_PAGE_SIZE - 1);
+    uint32_t in_page = lg.head - first_page;
+    uint32_t span = (in_page + need + FLASH_PAGE_SIZE - 1) & ~(FLASH_PAGE_SIZE - 1);
+
+    entry_hdr_t h = { len, 0xFF, 0xFF, entry_crc(len, data) };
+    memset(prog_buf, 0xFF, span);
+    memcpy(prog_buf + in_page, &h, sizeof(h));
+    memcpy(prog_buf + in_page + ENT_HDR, data, len);
+
+    if (!log_program(first_page, prog_buf, span, false)) {
+        return false;
+    }
+
+    uint16_t check;
+    if (!entry_ok(lg.head, &check)) {
+        // página não aceitou a gravação: abandona o resto do setor
+        printf("flash_log: verificação falhou em 0x%lx\n", (unsigned long) lg.head);
+        lg.stats.torn++;
+        log_move_head(sec_start(sec_of(lg.head) + 1));
+        return false;
+    }
+
+    uint32_t new_head = lg.head + need;
+    if (new_head % FLASH_SECTOR_SIZE == 0) {
+        // setor cheio: o próximo append prepara o seguinte
+        lg.head = new_head % FLASH_LOG_SIZE;
+        lg.head_pending = true;
+    }
+    else {
+        lg.head = new_head;
+    }
+
+    lg.stats.appended++;
+    lg.stats.entries++;
+    lg.stats.bytes += len;
+    return true;
+}
+
+const uint8_t *flash_log_next(uint16_t *len) {
+    if (!lg.ready || lg.cursor == lg.head) {
+        return NULL;
+    }
+    if (!entry_ok(lg.cursor, len)) {
+        return NULL;
+    }
+    return log_ptr(lg.cursor) + ENT_HDR;
+}
+
+bool flash_log_next_is_last(void) {
+    if (!lg.ready || lg.cursor == lg.head) {
+        return false;
+    }
+    return log_after(lg.cursor, entry_len(lg.cursor)) == lg.head;
+}
+
+void flash_log_advance(void) {
+    if (!lg.ready || lg.cursor == lg.head) {
+        return;
+    }
+    uint16_t len = entry_len(lg.cursor);
+    lg.inflight += len;
+    lg.cursor = log_after(lg.cursor, len);
+}
+
+uint32_t flash_log_ack(uint32_t len) {
+    uint32_t consumed = 0;
+
+    if (lg.ack_skip) {
+        uint32_t skip = len < lg.ack_skip ? len : lg.ack_skip;
+        lg.ack_skip -= skip;
+        len -= skip;
+        consumed += skip;
+    }
+
+    while (len > 0 && lg.tail != lg.cursor) {
+        uint16_t n = entry_len(lg.tail);
+        uint32_t rest = n - lg.acked;
+        if (len < rest) {
+            lg.acked += len;
+            lg.inflight -= len;
+            consumed += len;
+            break;
+        }
+        len -= rest;
+        consumed += rest;
+        lg.inflight -= rest;
+        lg.acked = 0;
+        lg.tail = log_after(lg.tail, n);
+
+        lg.stats.entries--;
+        lg.stats.bytes -= n;
+        lg.stats.delivered++;
+    }
+    return consumed;
+}
+
+void flash_log_rewind(void) {
+    lg.cursor = lg.tail;
+    lg.acked = 0;
+    lg.inflight = 0;
+    lg.ack_skip = 0;
+}
+
+bool flash_log_sync(void) {
+    if (!lg.ready) {
+        return true;
+    }
+
+    // uma gravação por página: todas as marcas de estado dela de uma vez
+    static uint8_t page[FLASH_PAGE_SIZE];
+    uint32_t cur_page = UINT32_MAX;
+    uint32_t pages = 0;
+    uint32_t pos = lg.synced;
+
+    while (pos != lg.tail) {
+        uint32_t mark = pos + offsetof(entry_hdr_t, state);
+        uint32_t pg = mark & ~(FLASH_PAGE_SIZE - 1);
+
+        if (pg != cur_page) {
+            if (cur_page != UINT32_MAX) {
+                if (!log_program(cur_page, page, FLASH_PAGE_SIZE, false)) return false;
+                lg.synced = pos;
+                if (++pages == FLASH_LOG_SYNC_PAGES) return false;
+            }
+            cur_page = pg;
+            memset(page, 0xFF, sizeof(page));
+        }
+        page[mark - pg] = ENT_DELIVERED;
+        pos = log_after(pos, entry_len(pos));
+    }
+
+    if (cur_page != UINT32_MAX) {
+        if (!log_program(cur_page, page, FLASH_PAGE_SIZE, false)) return false;
+        lg.synced = pos;
+    }
+    return true;
+}
+
+bool flash_log_has_unsent(void) {
+    return lg.ready && lg.cursor != lg.head;
+}
+
+uint32_t flash_log_inflight_bytes(void) {
+    return lg.inflight + lg.ack_skip;
+}
+
+const flash_log_stats_t *flash_log_stats(void) {
+    return &lg.stats;
+}
@@ -0,0 +1,73 @@
+#ifndef FLASH_LOG_H
+#define FLASH_LOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "hardware/flash.h"
+
+// Log persistente de registros (telemetria) numa região reservada da flash.
+//
+// A região é um anel de setores de 4 KB escritos em ordem (cada setor leva
+// um número de sequência), o que distribui os apagamentos por igual. Cada
+// entrada tem CRC; a entrega ao servidor só é marcada na flash depois da
+// confirmação, e o boot reconstrói cabeça e cauda varrendo a região: uma
+// gravação interrompida por queda de energia é descartada pelo CRC.
+//
+// Leituras (next/advance/ack/rewind) só mexem na RAM e podem rodar em
+// callbacks do lwIP; init, append e sync gravam a flash e precisam de
+// contexto de tarefa.
+
+#define FLASH_LOG_SIZE        (1024 * 1024)   // 256 setores
+// logo abaixo do setor da cache do Wi-Fi (último setor da flash)
+#define FLASH_LOG_OFFSET      (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE - FLASH_LOG_SIZE)
+#define FLASH_LOG_RECORD_MAX  1024
+#define FLASH_LOG_SYNC_PAGES  16              // páginas marcadas por chamada de sync
+
+typedef struct {
+    uint32_t entries;        // registros aguardando entrega
+    uint32_t bytes;          // payload aguardando entrega
+    uint32_t appended;
+    uint32_t delivered;
+    uint32_t dropped;        // descartados (log cheio, sobrescreve o setor mais antigo)
+    uint32_t erases;         // setores apagados desde o boot
+    uint32_t torn;           // entradas inválidas encontradas no boot
+    uint32_t scan_us;        // duração da recuperação no boot
+} flash_log_stats_t;
+
+// varre a região e recupera o estado; false se o log estiver indisponível
+bool flash_log_init(void);
+
+bool flash_log_ready(void);
+
+// época do boot para numerar registros: prepara um setor novo e retorna o
+// seq dele (sempre maior que o dos boots anteriores); 0 se falhar (tarefa)
+uint32_t flash_log_new_epoch(void);
+
+// grava um registro no fim do log (tarefa)
+bool flash_log_append(const void *data, uint16_t len);
+
+// próximo registro não enviado, direto da flash (XIP); NULL se não houver
+const uint8_t *flash_log_next(uint16_t *len);
+
+// o registro de flash_log_next é o último ainda não enviado
+bool flash_log_next_is_last(void);
+
+// marca o registro retornado por flash_log_next como em voo
+void flash_log_advance(void);
+
+// `len` bytes de payload em voo confirmados; retorna quanto foi consumido
+uint32_t flash_log_ack(uint32_t len);
+
+// conexão perdida: os registros em voo voltam a ser pendentes
+void flash_log_rewind(void);
+
+// grava na flash as marcas de entrega pendentes, até FLASH_LOG_SYNC_PAGES
+// páginas por chamada (tarefa); true quando não sobrou nenhuma
+bool flash_log_sync(void);
+
+bool flash_log_has_unsent(void);
+uint32_t flash_log_inflight_bytes(void);
+const flash_log_stats_t *flash_log_stats(void);
+
+#endif
@@ -0,0 +1,39 @@
+#include "sample_ring.h"
+
+_Static_assert((SAMPLE_RING_LEN & (SAMPLE_RING_LEN - 1)) == 0, "SAMPLE_RING_LEN deve ser potência de 2");
+
+void sample_ring_init(sample_ring_t *r) {
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+    r->dropped = 0;
+}
+
+bool sample_ring_push(sample_ring_t *r, const telemetry_sample_t *s) {
+    unsigned head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+
+    if (head - tail >= SAMPLE_RING_LEN) {
+        // o consumidor é dono do tail: aqui só dá para descartar a nova
+        r->dropped++;
+        return false;
+    }
+
+    r->slots[head & (SAMPLE_RING_LEN - 1)] = *s;
+    // release: o slot fica visível antes do novo head
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+    return true;
+}
+
+bool sample_ring_pop(sample_ring_t *r, telemetry_sample_t *s) {
+    unsigned tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&r->head, memory_order_acquire);
+
+    if (head == tail) {
+        return false;
+    }
+
+    *s = r->slots[tail & (SAMPLE_RING_LEN - 1)];
+    // release: o slot só é liberado depois de copiado
+    atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+    return true;
+}
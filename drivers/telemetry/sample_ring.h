@@ -0,0 +1,29 @@
+#ifndef SAMPLE_RING_H
+#define SAMPLE_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "telemetry.h"
+
+// fila SPSC sem trava: um único produtor (aquisição, core 1) e um único
+// consumidor (rede, core 0). Cada índice só é escrito por um dos lados.
+#define SAMPLE_RING_LEN 32   // precisa ser potência de 2
+
+typedef struct {
+    telemetry_sample_t slots[SAMPLE_RING_LEN];
+    atomic_uint head;          // escrito apenas pelo produtor
+    atomic_uint tail;          // escrito apenas pelo consumidor
+    volatile uint32_t dropped; // amostras descartadas com a fila cheia (produtor)
+} sample_ring_t;
+
+void sample_ring_init(sample_ring_t *r);
+
+// produtor: retorna false (e conta o descarte) se a fila estiver cheia
+bool sample_ring_push(sample_ring_t *r, const telemetry_sample_t *s);
+
+// consumidor: retorna false se a fila estiver vazia
+bool sample_ring_pop(sample_ring_t *r, telemetry_sample_t *s);
+
+#endif
@@ -0,0 +1,194 @@
+#include <math.h>
+#include <string.h>
+
+#include "telemetry.h"
+
+typedef enum { TM_U16, TM_I16, TM_I32 } telemetry_type_t;
+
+typedef struct {
+    const char *name;    // chave no JSON
+    uint8_t offset;      // posição do float em telemetry_sample_t
+    uint8_t type;
+    float scale;
+} telemetry_field_t;
+
+#define FIELD(name, member, type, scale) { name, offsetof(telemetry_sample_t, member), type, scale }
+
+// esquema 1, na ordem do registro (server/server.py tem a mesma tabela)
+static const telemetry_field_t schema_v1[] = {
+    FIELD("lux1", bh1750[0],  TM_I32, 100.0f),
+    FIELD("lux2", bh1750[1],  TM_I32, 100.0f),
+    FIELD("lux3", bh1750[2],  TM_I32, 100.0f),
+    FIELD("pt",   mpu6050[0], TM_I16, 100.0f),
+    FIELD("rl",   mpu6050[1], TM_I16, 100.0f),
+    FIELD("tp",   temp,       TM_I16, 100.0f),
+    FIELD("vb",   ina219[0],  TM_U16, 100.0f),
+    FIELD("vs",   ina219[1],  TM_I16, 10000.0f),
+    FIELD("i",    ina219[2],  TM_I32, 10000.0f),
+    FIELD("p",    ina219[3],  TM_I32, 10000.0f),
+};
+
+_Static_assert(sizeof(schema_v1) / sizeof(schema_v1[0]) == TELEMETRY_FIELDS, "TELEMETRY_FIELDS desatualizado");
+
+static volatile telemetry_format_t format = TELEMETRY_FORMAT;
+
+int telemetry_format_json(const telemetry_sample_t *s, bool pend, char *buf, size_t len) {
+    int n = snprintf(buf, len, "{ \"meta\": { \"pend\": %s }, \"data\": { ", pend ? "true" : "false");
+
+    // leitura inválida (sensor falhou ou desligado) vira null: NaN não é JSON
+    for (int i = 0; i < TELEMETRY_FIELDS && n >= 0 && (size_t) n < len; i++) {
+        const telemetry_field_t *f = &schema_v1[i];
+        float v;
+        memcpy(&v, (const uint8_t *) s + f->offset, sizeof(v));
+        const char *sep = i + 1 < TELEMETRY_FIELDS ? ", " : " }\n}\n";
+        if (isnan(v)) {
+            n += snprintf(buf + n, len - n, "\"%s\": null%s", f->name, sep);
+        }
+        else {
+            n += snprintf(buf + n, len - n, "\"%s\": %.*f%s", f->name, f->scale > 100.0f ? 4 : 2, v, sep);
+        }
+    }
+    return n;
+}
+
+int telemetry_format_field(const telemetry_sample_t *s, int i, const char **name, char *buf, size_t len) {
+    if (i < 0 || i >= TELEMETRY_FIELDS) {
+        return 0;
+    }
+    const telemetry_field_t *f = &schema_v1[i];
+    float v;
+    memcpy(&v, (const uint8_t *) s + f->offset, sizeof(v));
+
+    *name = f->name;
+    // leitura inválida: null, como no JSON
+    int n = isnan(v) ? snprintf(buf, len, "null") : snprintf(buf, len, "%.*f", f->scale > 100.0f ? 4 : 2, v);
+    return (n < 0 || (size_t) n >= len) ? 0 : n;
+}
+
+float telemetry_field(const telemetry_sample_t *s, int i, float *scale) {
+    const telemetry_field_t *f = &schema_v1[i];
+    float v;
+    memcpy(&v, (const uint8_t *) s + f->offset, sizeof(v));
+    *scale = f->scale;
+    return v;
+}
+
+static uint8_t *put_le(uint8_t *p, uint32_t v, int n) {
+    for (int i = 0; i < n; i++) {
+        *p++ = (uint8_t) (v >> (8 * i));
+    }
+    return p;
+}
+
+// float -> ponto fixo com arredondamento, saturando; NaN vira o sentinela
+static uint8_t *put_field(uint8_t *p, const telemetry_field_t *f, float v) {
+    bool none = isnan(v);
+    float x = v * f->scale;
+    x += (x >= 0) ? 0.5f : -0.5f;
+
+    switch (f->type) {
+    case TM_U16:
+        return put_le(p, none ? UINT16_MAX : x <= 0 ? 0 : x >= UINT16_MAX ? UINT16_MAX - 1 : (uint32_t) x, 2);
+    case TM_I16:
+        return put_le(p, (uint32_t) (none ? INT16_MIN : x <= INT16_MIN ? INT16_MIN + 1 : x >= INT16_MAX ? INT16_MAX : (int32_t) x), 2);
+    default:
+        // 2^31 é o primeiro float fora da faixa de int32
+        return put_le(p, (uint32_t) (none ? INT32_MIN : x <= -2147483648.0f ? INT32_MIN + 1 : x >= 2147483648.0f ? INT32_MAX : (int32_t) x), 4);
+    }
+}
+
+int telemetry_format_bin(const telemetry_sample_t *s, bool pend, uint8_t *buf, size_t len) {
+    if (len < TELEMETRY_BIN_MAX) {
+        return 0;
+    }
+
+    uint8_t *p = buf + TELEMETRY_BIN_HDR;
+    *p++ = pend ? 0x01 : 0x00;
+
+    for (size_t i = 0; i < sizeof(schema_v1) / sizeof(schema_v1[0]); i++) {
+        const telemetry_field_t *f = &schema_v1[i];
+        float v;
+        memcpy(&v, (const uint8_t *) s + f->offset, sizeof(v));
+        p = put_field(p, f, v);
+    }
+
+    uint16_t body = (uint16_t) (p - buf - TELEMETRY_BIN_HDR);
+    buf[0] = TELEMETRY_BIN_MAGIC;
+    buf[1] = TELEMETRY_BIN_SCHEMA;
+    put_le(buf + 2, body, 2);
+    return (int) (p - buf);
+}
+
+// campo em ponto fixo de um registro binário, com sinal quando o tipo tem
+static int32_t get_field(const uint8_t *p, const telemetry_field_t *f) {
+    switch (f->type) {
+    case TM_U16:
+        return (int32_t) (p[0] | (p[1] << 8));
+    case TM_I16:
+        return (int16_t) (p[0] | (p[1] << 8));
+    default:
+        return (int32_t) ((uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24));
+    }
+}
+
+static int field_size(const telemetry_field_t *f) {
+    return f->type == TM_I32 ? 4 : 2;
+}
+
+void telemetry_delta_reset(telemetry_delta_t *d) {
+    memset(d->prev, 0, sizeof(d->prev));
+    d->key = true;
+}
+
+int telemetry_delta_encode(telemetry_delta_t *d, const uint8_t *rec, size_t rec_len, uint8_t *buf, size_t len) {
+    size_t body = 1;
+    for (int i = 0; i < TELEMETRY_FIELDS; i++) {
+        body += field_size(&schema_v1[i]);
+    }
+    if (rec_len < TELEMETRY_BIN_HDR + body || rec[0] != TELEMETRY_BIN_MAGIC ||
+        rec[1] != TELEMETRY_BIN_SCHEMA || len < TELEMETRY_DELTA_MAX) {
+        return 0;
+    }
+
+    if (d->key) {
+        memset(d->prev, 0, sizeof(d->prev));
+        d->key = false;
+    }
+
+    const uint8_t *q = rec + TELEMETRY_BIN_HDR;
+    uint8_t *p = buf;
+    *p++ = *q++;   // flags
+
+    for (int i = 0; i < TELEMETRY_FIELDS; i++) {
+        int32_t v = get_field(q, &schema_v1[i]);
+        q += field_size(&schema_v1[i]);
+
+        // diferença em 64 bits (os extremos de int32 não estouram) e zigzag:
+        // valores pequenos, com qualquer sinal, cabem em um byte
+        int64_t delta = (int64_t) v - d->prev[i];
+        uint64_t z = ((uint64_t) delta << 1) ^ (uint64_t) (delta >> 63);
+        do {
+            uint8_t b = z & 0x7F;
+            z >>= 7;
+            *p++ = z ? (b | 0x80) : b;
+        } while (z);
+        d->prev[i] = v;
+    }
+    return (int) (p - buf);
+}
+
+int telemetry_encode(const telemetry_sample_t *s, bool pend, uint8_t *buf, size_t len) {
+    if (format == TELEMETRY_FMT_BIN) {
+        return telemetry_format_bin(s, pend, buf, len);
+    }
+    int n = telemetry_format_json(s, pend, (char *) buf, len);
+    return (n < 0 || (size_t) n >= len) ? 0 : n;
+}
+
+void telemetry_set_format(telemetry_format_t fmt) {
+    format = fmt;
+}
+
+telemetry_format_t telemetry_get_format(void) {
+    return format;
+}
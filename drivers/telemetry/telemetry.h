@@ -0,0 +1,87 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// amostra completa dos sensores, produzida pela tarefa de aquisição
+typedef struct {
+    uint32_t t_ms;       // instante da leitura (ms desde o boot)
+    float bh1750[3];     // lux dos canais 5, 6 e 7 do mux
+    float mpu6050[2];    // pitch e roll (graus)
+    float temp;          // DS18B20 (°C)
+    float ina219[4];     // vbus, vshunt, corrente e potência
+} telemetry_sample_t;
+
+// formatos do registro enviado ao servidor
+typedef enum {
+    TELEMETRY_FMT_JSON,   // texto, ~230 bytes, printf de ponto flutuante
+    TELEMETRY_FMT_BIN,    // ponto fixo empacotado, 35 bytes
+} telemetry_format_t;
+
+// formato usado no boot; telemetry_set_format troca em tempo de execução
+#ifndef TELEMETRY_FORMAT
+#define TELEMETRY_FORMAT      TELEMETRY_FMT_JSON
+#endif
+
+// Registro binário: cabeçalho de 4 bytes (magic, versão do esquema, tamanho
+// do corpo em LE) e os campos do esquema em little-endian. O magic nunca
+// aparece em UTF-8, então registros binários e JSON podem se misturar no
+// mesmo stream. Esquema 1 (escala -> casas decimais do JSON):
+//   u8  flags (bit 0: pend)
+//   i32 lux1, lux2, lux3   x100
+//   i16 pt, rl             x100
+//   i16 tp                 x100
+//   u16 vb                 x100
+//   i16 vs                 x10000
+//   i32 i, p               x10000
+// O menor valor de cada tipo com sinal (ou o maior sem sinal) indica
+// leitura inválida (NaN); fora da faixa satura.
+#define TELEMETRY_BIN_MAGIC   0xF5
+#define TELEMETRY_BIN_SCHEMA  1
+#define TELEMETRY_BIN_HDR     4
+#define TELEMETRY_BIN_MAX     64
+
+// monta o payload JSON de uma amostra; retorna o tamanho escrito (como snprintf)
+int telemetry_format_json(const telemetry_sample_t *s, bool pend, char *buf, size_t len);
+
+// campo `i` (0..TELEMETRY_FIELDS-1) sozinho: nome do JSON e valor em texto
+// com as mesmas casas decimais (null se inválido); retorna o tamanho ou 0
+// em caso de erro
+#define TELEMETRY_FIELDS      10
+int telemetry_format_field(const telemetry_sample_t *s, int i, const char **name, char *buf, size_t len);
+
+// valor do campo `i` e a escala do seu ponto fixo (ex.: limiares de envio)
+float telemetry_field(const telemetry_sample_t *s, int i, float *scale);
+
+// monta o registro binário; retorna o tamanho ou 0 se `len` não bastar
+int telemetry_format_bin(const telemetry_sample_t *s, bool pend, uint8_t *buf, size_t len);
+
+// monta o registro no formato atual; retorna o tamanho ou 0 em caso de erro
+int telemetry_encode(const telemetry_sample_t *s, bool pend, uint8_t *buf, size_t len);
+
+// Codec delta (enlaces caros, ex.: backhaul celular): o registro binário
+// vira flags u8 e, para cada campo do esquema, a diferença em ponto fixo
+// para o registro anterior do stream, como varint zigzag (7 bits por byte,
+// bit 7 = continua). O quadro-chave é a diferença para zero, ou seja, os
+// próprios valores; quem decodifica precisa de todos desde o último
+#define TELEMETRY_DELTA_MAX   (1 + 5 * TELEMETRY_FIELDS)
+
+typedef struct {
+    int32_t prev[TELEMETRY_FIELDS];   // valores do registro anterior
+    bool key;                         // o próximo sai como quadro-chave
+} telemetry_delta_t;
+
+// recomeça o stream (ex.: nova conexão): o próximo registro é quadro-chave
+void telemetry_delta_reset(telemetry_delta_t *d);
+
+// comprime o registro binário `rec` e o torna a referência; retorna o
+// tamanho ou 0 se não for um registro do esquema 1 ou `len` não bastar
+int telemetry_delta_encode(telemetry_delta_t *d, const uint8_t *rec, size_t rec_len, uint8_t *buf, size_t len);
+
+void telemetry_set_format(telemetry_format_t fmt);
+telemetry_format_t telemetry_get_format(void);
+
+#endif
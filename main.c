@@ -1,3 +1,4 @@
+#include <math.h>
 #include <stdio.h>
 #include <string.h>
 #include "pico/stdlib.h"
@@ -5,40 +6,73 @@
 #include "hardware/gpio.h"
 #include "hardware/i2c.h"
 
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
 #include "drivers/angle/mpu6050.h"
 #include "drivers/energy/ina219.h"
 #include "drivers/i2c/i2c_bus.h"
 #include "drivers/lux/bh1750.h"
 #include "drivers/network/tcp_client.h"
+#include "drivers/network/net_task.h"
+#include "drivers/network/station_config.h"
 #include "drivers/display_2.0/ssd1306_i2c.h"
 #include "drivers/temperature/ds18b20.h"
-
-// --- Wi-Fi ---
-#define WIFI_SSID     "KAUA_LQ"
-#define WIFI_PASS     "12345678"
+#include "drivers/telemetry/telemetry.h"
+#include "drivers/telemetry/sample_ring.h"
 
 #define BTN_A 5
-bool flag_btn = 0;
-bool flag_wf_state = 1;
 
-// vetores para armazenar leituras dos sensores
-float arrayBH1750[3];
-float arrayMPU6050[2];
-float arrayINA219[5];
+// espera antes de iniciar (ex.: abrir o terminal USB); 0 = boot direto
+#ifndef BOOT_WAIT_MS
+#define BOOT_WAIT_MS          0
+#endif
+
+// --- Tarefas ---
+#define DISPLAY_REFRESH_MS    500   // redesenha mesmo sem amostra nova (botão, ícones)
+#define NET_QUEUE_LEN         16    // amostras aguardando a tarefa de rede
+
+#define ACQ_TASK_PRIORITY     (tskIDLE_PRIORITY + 3)
+#define NET_TASK_PRIORITY     (tskIDLE_PRIORITY + 2)
+#define DISP_TASK_PRIORITY    (tskIDLE_PRIORITY + 1)
 
-// variável do sensor de temperatura
-float g_temp = 0.0;
+#define ACQ_TASK_STACK        1024
+#define DISP_TASK_STACK       1024
+
+// 1: aquisição fixa no core 1, rede e display no core 0, entrega via fila SPSC
+#ifndef ACQ_PIN_CORE1
+#define ACQ_PIN_CORE1         0
+#endif
+
+#define CORE0_MASK            (1 << 0)
+#define CORE1_MASK            (1 << 1)
+
+// filas entre as tarefas
+static QueueHandle_t disp_queue;  // -> display (mailbox, só a última amostra)
+#if ACQ_PIN_CORE1
+static sample_ring_t acq_ring;    // core 1 -> core 0, sem trava
+#else
+static QueueHandle_t net_queue;   // aquisição -> rede (FIFO)
+#endif
 
 // funções auxiliares
 void button_callback(uint gpio, uint32_t events);
-bool wifi_is_connected();
-bool wifi_reconnect();
-void write_oled_values(void);
+void write_oled_values(const telemetry_sample_t *s);
+
+static void acquisition_task(void *params);
+static void display_task(void *params);
+static void publish_sample(const telemetry_sample_t *s);
+static bool fetch_sample(telemetry_sample_t *s);
+static void mark_invalid(telemetry_sample_t *s);
+static void display_flush(void);
 
 /* ----------------- main -------------------- */
 int main() {
     stdio_init_all();
-    sleep_ms(3000);
+    if (BOOT_WAIT_MS > 0) {
+        sleep_ms(BOOT_WAIT_MS);
+    }
 
     gpio_init(BTN_A);
     gpio_set_dir(BTN_A, GPIO_IN);
@@ -49,116 +83,156 @@ int main() {
     i2c_oled_init();
     SSD1306_init(); // inicia o display OLED
 
-    // Wi-Fi init
-    if (cyw43_arch_init()) {
-        printf("Erro ao inicializar Wi-Fi\n");
-        return -1;
-    }
-    cyw43_arch_enable_sta_mode();
+    // Configura interrupção para o botão
+    gpio_set_irq_enabled_with_callback(BTN_A, GPIO_IRQ_EDGE_FALL, true, &button_callback);
 
-    SSD1306_clear();
-    SSD1306_draw_string(5, 32, "wifi init...");
-    SSD1306_update();
+    disp_queue = xQueueCreate(1, sizeof(telemetry_sample_t));
 
-    if (cyw43_arch_wifi_connect_timeout_ms(WIFI_SSID, WIFI_PASS, CYW43_AUTH_WPA2_AES_PSK, 30000)) {
-        SSD1306_clear();
-        SSD1306_draw_string(5, 32, "falha no wifi");
-        SSD1306_update();
-        cyw43_arch_deinit();
-        return -1;
-    }
+#if ACQ_PIN_CORE1
+    // core 1 fica só com a aquisição: lwIP, cyw43 e OLED não competem com ela
+    sample_ring_init(&acq_ring);
+    xTaskCreateAffinitySet(acquisition_task, "acq", ACQ_TASK_STACK, NULL, ACQ_TASK_PRIORITY, CORE1_MASK, NULL);
+    net_task_start(fetch_sample, NET_TASK_PRIORITY, CORE0_MASK);
+    xTaskCreateAffinitySet(display_task, "disp", DISP_TASK_STACK, NULL, DISP_TASK_PRIORITY, CORE0_MASK, NULL);
+#else
+    net_queue = xQueueCreate(NET_QUEUE_LEN, sizeof(telemetry_sample_t));
 
-    SSD1306_clear();
-    SSD1306_draw_string(5, 32, "wifi conectado");
-    SSD1306_update();
+    xTaskCreate(acquisition_task, "acq", ACQ_TASK_STACK, NULL, ACQ_TASK_PRIORITY, NULL);
+    net_task_start(fetch_sample, NET_TASK_PRIORITY, tskNO_AFFINITY);
+    xTaskCreate(display_task, "disp", DISP_TASK_STACK, NULL, DISP_TASK_PRIORITY, NULL);
+#endif
 
-    sleep_ms(1000); // espera estabilizar
+    vTaskStartScheduler();
 
-    // IP do servidor
-    if (!ip4addr_aton(SERVER_IP, &server_addr)) {
-        printf("IP inválido: %s\n", SERVER_IP);
-        SSD1306_clear();
-        SSD1306_draw_string(5, 8, "Server IP");
-        SSD1306_draw_string(5, 16, "Desconhecido");
-        SSD1306_draw_string(5, 32, SERVER_IP);
-        SSD1306_update();
-        return -1;
-    }
+    // nunca chega aqui
+    return 0;
+}
+
+/* ----------------- tarefas ----------------- */
+
+// lê todos os sensores em período fixo e distribui a amostra
+static void acquisition_task(void *params) {
+    (void) params;
 
     // Inicializa sensores I2C (mantendo seu fluxo)
+    i2c_bus_lock();
     bh1750_initialize();
     mpu6050_init();
     ina219_init();
+    i2c_bus_unlock();
 
     // Inicializa o sensor de temperatura
     ds18b20_t sensor;
     ds18b20_init(&sensor, pio0, 17);
 
-    // Configura interrupção para o botão
-    gpio_set_irq_enabled_with_callback(BTN_A, GPIO_IRQ_EDGE_FALL, true, &button_callback);
+    TickType_t last_wake = xTaskGetTickCount();
+
+    while (true) {
+        telemetry_sample_t s;
+        s.t_ms = to_ms_since_boot(get_absolute_time());
+
+        // sensores desligados pelo servidor vão como leitura inválida
+        uint32_t sensors = station_config.sensors;
+        mark_invalid(&s);
+
+        // varredura dos sensores I2C
+        i2c_bus_lock();
+        if (sensors & STATION_SENSOR_LUX) mux_sweep(s.bh1750);
+        if (sensors & STATION_SENSOR_ANGLE) mpu6050_get_values(s.mpu6050);
+        if (sensors & STATION_SENSOR_ENERGY) ina219_get_values(s.ina219);
+        i2c_bus_unlock();
+
+        // leitura do sensor de temperatura
+        if (sensors & STATION_SENSOR_TEMP) s.temp = ds18b20_read_temperature(&sensor);
 
-    // inicia tentativa de conexão TCP
-    tcp_client_start();
+        publish_sample(&s);
+
+        // o período vale a partir do próximo ciclo
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(station_config.sample_period_ms));
+    }
+}
+
+static void mark_invalid(telemetry_sample_t *s) {
+    for (int i = 0; i < 3; i++) s->bh1750[i] = NAN;
+    for (int i = 0; i < 2; i++) s->mpu6050[i] = NAN;
+    for (int i = 0; i < 4; i++) s->ina219[i] = NAN;
+    s->temp = NAN;
+}
+
+// entrega a amostra para a rede e para o display (lado da aquisição)
+static void publish_sample(const telemetry_sample_t *s) {
+    xQueueOverwrite(disp_queue, s);
+
+#if ACQ_PIN_CORE1
+    // fila SPSC cheia (rede parada): descarta a nova, ao contrário da fila do
+    // FreeRTOS abaixo, porque só o consumidor move o tail. Com a rede
+    // esvaziando a fila a cada volta isso não deveria acontecer; as perdas
+    // vão no registro de saúde (acq_drop)
+    if (!sample_ring_push(&acq_ring, s)) {
+        net_samples_dropped = acq_ring.dropped;
+    }
+#else
+    // fila cheia (rede parada): descarta a mais antiga e mantém as recentes
+    if (xQueueSend(net_queue, s, 0) != pdTRUE) {
+        telemetry_sample_t oldest;
+        xQueueReceive(net_queue, &oldest, 0);
+        xQueueSend(net_queue, s, 0);
+        net_samples_dropped++;
+    }
+#endif
+    net_task_wake();
+}
+
+// próxima amostra para a rede, sem bloquear (chamada pela tarefa de rede)
+static bool fetch_sample(telemetry_sample_t *s) {
+#if ACQ_PIN_CORE1
+    return sample_ring_pop(&acq_ring, s);
+#else
+    return xQueueReceive(net_queue, s, 0) == pdTRUE;
+#endif
+}
+
+// atualiza o OLED com a última amostra. O quadro é desenhado fora do
+// barramento e enviado por página (display_flush): a aquisição espera no
+// máximo uma página, não um quadro inteiro
+static void display_task(void *params) {
+    (void) params;
+
+    telemetry_sample_t last;
+    bool have_sample = false;
 
     SSD1306_clear();
     SSD1306_draw_image(8, 8, 100, 48, icon_embarca_100px48px);
-    SSD1306_update();
-    sleep_ms(5000);
+    display_flush();
 
     while (true) {
-        // Verifica conexão Wi-Fi
-        if (!wifi_is_connected()) {
-            flag_wf_state = 0;
-            write_oled_values(); // atualiza o display oled com símbolo de nowifi
-
-            if (!wifi_reconnect()) {
-                // Se falhar, espera um pouco e tenta novamente no próximo loop
-                sleep_ms(5000);
-                continue;
-            }
-
-            // Se reconectou, reinicia cliente TCP
-            tcp_client_close();
-            tcp_client_start();
+        if (xQueueReceive(disp_queue, &last, pdMS_TO_TICKS(DISPLAY_REFRESH_MS)) == pdTRUE) {
+            have_sample = true;
         }
 
-        // varredura dos sensores I2C
-        mux_sweep(arrayBH1750);
-        mpu6050_get_values(arrayMPU6050);
-        ina219_get_values(arrayINA219);
+        const char *status = net_status;
 
-        // leitura do sensor de temperatura
-        g_temp = ds18b20_read_temperature(&sensor);
-
-        write_oled_values();
-
-        // monta payload JSON
-        char payload[512];
-        snprintf(payload, sizeof(payload),
-            "{ \"meta\": { \"pend\": %s }, \"data\": { \"lux1\": %.2f, \"lux2\": %.2f, \"lux3\": %.2f, \"pt\": %.2f, \"rl\": %.2f, \"tp\": %.2f, \"vb\": %.2f, \"vs\": %.4f, \"i\": %.4f, \"p\": %.4f }\n}\n",
-            has_pending_msg ? "true" : "false",
-            arrayBH1750[0], arrayBH1750[1], arrayBH1750[2],
-            arrayMPU6050[0], arrayMPU6050[1],
-            g_temp,
-            arrayINA219[0], arrayINA219[1], arrayINA219[2], arrayINA219[3]
-        );
-
-        // tenta enviar (ou armazena e gere reconexão)
-        tcp_client_send(payload);
-
-        // Faz polling do Wi-Fi / lwip e tenta descarregar pending messages
-        for (int i = 0; i < 2; i++) {
-            sleep_ms(1000);        // 1 segundo × 600 = 10 minutos
-            cyw43_arch_poll();     // mantém o Wi-Fi vivo
-            // a cada loop pequeno, tentamos flush se possível
-            tcp_client_flush_pending_if_possible();
+        if (status) {
+            SSD1306_clear();
+            SSD1306_draw_string(5, 32, (char *) status);
+            display_flush();
+        }
+        else if (have_sample) {
+            write_oled_values(&last);
+            display_flush();
         }
     }
+}
 
-    // nunca chega aqui, mas boa prática
-    tcp_client_close();
-    cyw43_arch_deinit();
-    return 0;
+// uma página (128 bytes, ~3 ms a 400 kHz) por vez com o barramento; o tick
+// entre elas deixa a aquisição (no outro core) pegar a trava antes da próxima
+static void display_flush(void) {
+    for (int page = 0; page < (int) SSD1306_NUM_PAGES; page++) {
+        i2c_bus_lock();
+        SSD1306_update_page(page);
+        i2c_bus_unlock();
+        vTaskDelay(1);
+    }
 }
 
 //Callback do botão A
@@ -168,66 +242,35 @@ void button_callback(uint gpio, uint32_t events) {
 
     // Evita múltiplas detecções rápidas (debouncing)
     if (current_time - last_time > 200) {
-        flag_btn = !flag_btn;
+        station_config.display_mode = !station_config.display_mode;
     }
 }
 
-bool wifi_is_connected() {
-    return cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA) == CYW43_LINK_UP;
-}
-
-bool wifi_reconnect() {
-    cyw43_arch_deinit();
-    sleep_ms(1000);
-
-    if (cyw43_arch_init()) {
-        printf("Erro ao inicializar Wi-Fi\n");
-        return false;
-    }
-    cyw43_arch_enable_sta_mode();
-
-    int err = cyw43_arch_wifi_connect_timeout_ms(
-        WIFI_SSID,
-        WIFI_PASS,
-        CYW43_AUTH_WPA2_AES_PSK,
-        30000
-    );
-
-    if (err) {
-        return false;
-    }
-
-    flag_wf_state = 1;
-    sleep_ms(500);
-
-    return true;
-}
-
-void write_oled_values(void){
+void write_oled_values(const telemetry_sample_t *s){
     char lux1_str[16];
-    snprintf(lux1_str, sizeof(lux1_str), "l1=%.2f", arrayBH1750[0]);
+    snprintf(lux1_str, sizeof(lux1_str), "l1=%.2f", s->bh1750[0]);
     char lux2_str[16];
-    snprintf(lux2_str, sizeof(lux2_str), "l2=%.2f", arrayBH1750[1]);
+    snprintf(lux2_str, sizeof(lux2_str), "l2=%.2f", s->bh1750[1]);
     char lux3_str[16];
-    snprintf(lux3_str, sizeof(lux3_str), "l3=%.2f", arrayBH1750[2]);
+    snprintf(lux3_str, sizeof(lux3_str), "l3=%.2f", s->bh1750[2]);
 
     char pitch_str[16];
-    snprintf(pitch_str, sizeof(pitch_str), "pt=%.2f", arrayMPU6050[0]);
+    snprintf(pitch_str, sizeof(pitch_str), "pt=%.2f", s->mpu6050[0]);
     char roll_str[16];
-    snprintf(roll_str, sizeof(roll_str), "rl=%.2f", arrayMPU6050[1]);
+    snprintf(roll_str, sizeof(roll_str), "rl=%.2f", s->mpu6050[1]);
     char temp_str[16];
-    snprintf(temp_str, sizeof(temp_str), "tp=%.2f", g_temp);
+    snprintf(temp_str, sizeof(temp_str), "tp=%.2f", s->temp);
 
     char vbus_str[16];
-    snprintf(vbus_str, sizeof(vbus_str), "vb=%.2f", arrayINA219[0]);
+    snprintf(vbus_str, sizeof(vbus_str), "vb=%.2f", s->ina219[0]);
     char vshunt_str[16];
-    snprintf(vshunt_str, sizeof(vshunt_str), "vs=%.4f", arrayINA219[1]);
+    snprintf(vshunt_str, sizeof(vshunt_str), "vs=%.4f", s->ina219[1]);
     char current_str[16];
-    snprintf(current_str, sizeof(current_str), "i=%.4f", arrayINA219[2]);
+    snprintf(current_str, sizeof(current_str), "i=%.4f", s->ina219[2]);
     char power_str[16];
-    snprintf(power_str, sizeof(power_str), "p=%.4f", arrayINA219[3]);
+    snprintf(power_str, sizeof(power_str), "p=%.4f", s->ina219[3]);
 
-    if (!flag_btn) {
+    if (!station_config.display_mode) {
         SSD1306_clear();
         SSD1306_draw_string(5, 12, lux1_str);
         SSD1306_draw_string(5, 20, lux2_str);
@@ -235,7 +278,6 @@ void write_oled_values(void){
         SSD1306_draw_string(5, 36, pitch_str);
         SSD1306_draw_string(5, 44, roll_str);
         SSD1306_draw_string(5, 52, temp_str);
-        SSD1306_update();
     }
     else {
         SSD1306_clear();
@@ -243,22 +285,18 @@ void write_oled_values(void){
         SSD1306_draw_string(5, 30, vshunt_str);
         SSD1306_draw_string(5, 38, current_str);
         SSD1306_draw_string(5, 46, power_str);
-        SSD1306_update();
     }
     if (flag_wf_state) {
         SSD1306_draw_image(110, 8, 16, 16, icon_wifi_preto);
         if (tcp_connected_flag) {
             SSD1306_draw_image(110, 28, 16, 16, icon_cloud_preto);
-            SSD1306_update();
         }
         else {
             SSD1306_draw_image(110, 28, 16, 16, icon_nocloud_preto);
-            SSD1306_update();
         }
     }
     else {
         SSD1306_draw_image(110, 8, 16, 16, icon_nowifi_preto);
         SSD1306_draw_image(110, 28, 16, 16, icon_nocloud_preto);
-        SSD1306_update();
     }
 }
\ No newline at end of file
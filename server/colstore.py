@@ -0,0 +1,535 @@
+import os
+import re
+import struct
+import time
+from datetime import datetime, timezone, timedelta
+
+# ===============================
+# ARMAZENAMENTO EM COLUNAS
+# ===============================
+# Uma pasta por estação e dia (no fuso das estações), um arquivo por coluna:
+#
+#   <raiz>/<estação>/<AAAA-MM-DD>/ts.col      hora de chegada (ver spread), ms desde 1970
+#                                 seq.col     seq do registro (0 = fora de quadro)
+#                                 lux1.col ...  campos do esquema, em ponto fixo
+#
+# Cada arquivo é uma sequência de blocos de até BLOCK_ROWS valores. Só o
+# último bloco de um dia pode estar incompleto: a cada descarga ele é
+# regravado no lugar com as linhas novas, até encher. Um bloco é o corpo
+# (diferença para o valor anterior do bloco, zigzag e varint, como o codec
+# delta da estação) seguido do rodapé: tamanho do corpo, linhas, nulos, mínimo e máximo dos não nulos e
+# o magic. Lendo os rodapés de trás para frente dá para pular os blocos
+# fora de uma faixa sem decodificar nada; ler um campo de um mês só abre o
+# arquivo daquele campo em cada dia. Nulo é o sentinela do tipo do campo
+# (o mesmo do registro binário).
+#
+# Índice esparso (blocks.idx, na pasta do dia): uma entrada por bloco
+# gravado, com a faixa de ts do bloco e, por coluna, onde o bloco está no
+# arquivo e os agregados dele (não nulos, mínimo, máximo, soma e integral
+# no tempo). A consulta lê só o índice, pula os blocos fora da faixa e
+# responde sem decodificar os blocos que caem inteiros num intervalo; só
+# os blocos das pontas são lidos (com seek, só as colunas pedidas). A
+# entrada vai depois dos blocos: um índice curto nunca aponta para bytes
+# que não existem.
+#
+# Integral: cada linha vale pelo tempo desde a anterior do mesmo dia, até
+# INTEGRAL_MAX_GAP_MS (uma queda não vira energia). O registro não traz a
+# hora da amostra e ts é a de chegada, mas um lote (ou o backlog de depois
+# de uma queda) chega todo junto: quem grava espalha as linhas do lote pelo
+# intervalo desde o lote anterior da estação (spread), e cada uma vale pelo
+# seu pedaço. Com o mesmo ts em todas, a primeira levaria o intervalo
+# inteiro, cortado no limite, e as outras nada.
+
+BLOCK_ROWS = 1024
+BLOCK_FOOTER = struct.Struct("<IIIqqH")  # corpo, linhas, nulos, mínimo, máximo, magic
+BLOCK_MAGIC = 0xC01B
+
+TS, SEQ = "ts", "seq"
+
+INDEX_FILE = "blocks.idx"
+INDEX_HEAD = struct.Struct("<qqqI")     # ts mínimo, ts máximo, ts da última linha, linhas
+INDEX_COL = struct.Struct("<IIIqqqq")   # posição, tamanho, não nulos, mínimo, máximo, soma, integral (valor x ms)
+INTEGRAL_MAX_GAP_MS = 10 * 60 * 1000
+SETTLE_MS = 60 * 60 * 1000  # um dia só é dado como encerrado (cache do índice) depois disso; quem grava descarrega antes
+
+AGGREGATES = ("count", "min", "max", "avg", "sum", "integral")
+
+STATION_RE = re.compile(r"[^A-Za-z0-9_.-]")
+
+def encode_block(values, null=None):
+    """Valores inteiros -> bloco (corpo + rodapé)."""
+    body = bytearray()
+    prev = 0
+    lo = hi = None
+    nulls = 0
+    for v in values:
+        if v == null:
+            nulls += 1
+        else:
+            lo = v if lo is None or v < lo else lo
+            hi = v if hi is None or v > hi else hi
+        d = v - prev
+        prev = v
+        z = d << 1 if d >= 0 else (-d << 1) - 1
+        while True:
+            b = z & 0x7F
+            z >>= 7
+            if z:
+                body.append(b | 0x80)
+            else:
+                body.append(b)
+                break
+    footer = BLOCK_FOOTER.pack(len(body), len(values), nulls, lo or 0, hi or 0, BLOCK_MAGIC)
+    return bytes(body) + footer
+
+def decode_body(data, start, end, count):
+    """Corpo de um bloco -> lista de inteiros."""
+    out = []
+    prev = 0
+    pos = start
+    for _ in range(count):
+        z = shift = 0
+        while True:
+            b = data[pos]
+            pos += 1
+            z |= (b & 0x7F) << shift
+            shift += 7
+            if not b & 0x80:
+                break
+        prev += (z >> 1) ^ -(z & 1)
+        out.append(prev)
+    if pos != end:
+        raise ValueError(f"bloco corrompido: corpo termina em {pos}, esperado {end}")
+    return out
+
+class Block:
+    """Rodapé de um bloco e onde o corpo está no arquivo."""
+
+    __slots__ = ("start", "end", "count", "nulls", "min", "max")
+
+    def __init__(self, start, end, count, nulls, lo, hi):
+        self.start, self.end, self.count, self.nulls, self.min, self.max = start, end, count, nulls, lo, hi
+
+    def overlaps(self, lo, hi):
+        """Algum valor não nulo do bloco pode estar em [lo, hi]."""
+        return self.nulls < self.count and self.max >= lo and self.min <= hi
+
+def read_blocks(data):
+    """Rodapés de um arquivo de coluna, na ordem do arquivo."""
+    blocks = []
+    end = len(data)
+    while end > 0:
+        if end < BLOCK_FOOTER.size:
+            raise ValueError("arquivo de coluna truncado")
+        size, count, nulls, lo, hi, magic = BLOCK_FOOTER.unpack_from(data, end - BLOCK_FOOTER.size)
+        start = end - BLOCK_FOOTER.size - size
+        if magic != BLOCK_MAGIC or start < 0:
+            raise ValueError(f"rodapé inválido no byte {end - BLOCK_FOOTER.size}")
+        blocks.append(Block(start, start + size, count, nulls, lo, hi))
+        end = start
+    blocks.reverse()
+    return blocks
+
+def gaps(ts, prev):
+    """Tempo de cada linha desde a anterior (0 na primeira do dia), até o limite."""
+    out = []
+    for t in ts:
+        out.append(0 if prev is None else max(0, min(t - prev, INTEGRAL_MAX_GAP_MS)))
+        prev = t
+    return out
+
+def spread(rows, prev):
+    """Linhas (estação, ts, seq, valores) de um lote que chegou em ts, espalhadas
+    em (prev, ts]: a última fica em ts. Sem `prev` (ou fora de ordem), como vieram."""
+    if not rows or prev is None or prev >= rows[-1][1]:
+        return rows
+    ts, k = rows[-1][1], len(rows)
+    return [(station, prev + (ts - prev) * (i + 1) // k, seq, values)
+            for i, (station, _, seq, values) in enumerate(rows)]
+
+def block_stats(values, null, dts=None):
+    """(não nulos, mínimo, máximo, soma, integral) de um bloco; sem `dts`, sem soma nem integral."""
+    count = total = integral = 0
+    lo = hi = None
+    for k, v in enumerate(values):
+        if v == null:
+            continue
+        count += 1
+        lo = v if lo is None or v < lo else lo
+        hi = v if hi is None or v > hi else hi
+        if dts is not None:
+            total += v
+            integral += v * dts[k]
+    return count, lo or 0, hi or 0, total, integral
+
+class IndexEntry:
+    """Um bloco no índice: faixa de ts e, por coluna, (posição, tamanho, agregados)."""
+
+    __slots__ = ("ts_min", "ts_max", "ts_last", "rows", "cols")
+
+    def __init__(self, ts_min, ts_max, ts_last, rows, cols):
+        self.ts_min, self.ts_max, self.ts_last, self.rows, self.cols = ts_min, ts_max, ts_last, rows, cols
+
+def read_column(path, blocks=None):
+    """Todos os valores de um arquivo de coluna (ou só dos `blocks` dados)."""
+    try:
+        with open(path, "rb") as f:
+            data = f.read()
+    except FileNotFoundError:
+        return []
+    out = []
+    for b in read_blocks(data) if blocks is None else blocks(read_blocks(data)):
+        out.extend(decode_body(data, b.start, b.end, b.count))
+    return out
+
+class Partition:
+    """Linhas de uma estação num dia ainda não gravadas."""
+
+    def __init__(self, path, columns):
+        self.path = path
+        self.rows = {c: [] for c in columns}
+        self.tail = None     # IndexEntry do último bloco, se ainda não cheio (regravado no lugar)
+        self.tail_at = 0     # posição dele no índice
+        self.prev_ts = None  # ts da linha antes do bloco aberto (integral)
+
+    def __len__(self):
+        return len(self.rows[TS]) + (self.tail.rows if self.tail else 0)
+
+class ColumnStore:
+    """Grava e lê as colunas de `root`.
+
+    `fields` é a lista do esquema, como (nome, escala, nulo); os valores
+    entram e saem em ponto fixo (inteiros). Só uma instância grava (no
+    servidor, a thread de gravação); outras podem ler ao mesmo tempo.
+    """
+
+    def __init__(self, root, fields, tz=timezone(timedelta(hours=-3))):
+        self.root = root
+        self.fields = [(name, scale, null) for name, scale, null in fields]
+        self.nulls = {name: null for name, _, null in self.fields}
+        self.scales = {name: scale for name, scale, _ in self.fields}
+        self.columns = [TS, SEQ] + [name for name, _, _ in self.fields]
+        self.entry_size = INDEX_HEAD.size + INDEX_COL.size * len(self.columns)
+        self.tz = tz
+        self.tz_ms = int(tz.utcoffset(None).total_seconds() * 1000)
+        self.open = {}  # (estação, dia) -> Partition
+        self.cache = {}  # (estação, dia) -> índice de um dia já encerrado
+        self.settled_day, self.settled_at = "", 0.0
+
+    def day(self, ts_ms):
+        return datetime.fromtimestamp(ts_ms / 1000, self.tz).strftime("%Y-%m-%d")
+
+    def partition_path(self, station, day):
+        return os.path.join(self.root, STATION_RE.sub("_", station), day)
+
+    def append(self, station, ts_ms, seq, values):
+        """Uma linha: `values` na ordem de `fields`, em ponto fixo (nulo = sentinela)."""
+        key = (station, self.day(ts_ms))
+        part = self.open.get(key)
+        if part is None:
+            part = self.open[key] = self.resume(self.partition_path(*key))
+        part.rows[TS].append(ts_ms)
+        part.rows[SEQ].append(seq or 0)
+        for (name, _, _), v in zip(self.fields, values):
+            part.rows[name].append(v)
+        if len(part) >= BLOCK_ROWS:
+            self.write(part)
+
+    def resume(self, path):
+        """Partição para gravar num dia que talvez já tenha blocos.
+
+        O índice manda: uma entrada que aponta além do fim de alguma coluna
+        (queda no meio da gravação) sai, e o que sobrar nas colunas depois do
+        último bloco do índice é cortado. Um último bloco incompleto volta a
+        ser o bloco aberto.
+        """
+        part = Partition(path, self.columns)
+        entries = self.read_index(path, repair=True)
+        if entries is None and os.path.isdir(path):
+            self.rebuild_index(path)
+            entries = self.read_index(path)
+        if not entries:
+            return part
+        files = [os.path.join(path, name + ".col") for name in self.columns]
+        sizes = [os.path.getsize(f) if os.path.exists(f) else 0 for f in files]
+        while entries and any(offset + size > n for (offset, size, *_), n in zip(entries[-1].cols, sizes)):
+            entries.pop()
+        os.truncate(os.path.join(path, INDEX_FILE), len(entries) * self.entry_size)
+        for f, (offset, size, *_), n in zip(files, entries[-1].cols if entries else [(0, 0)] * len(files), sizes):
+            if n > offset + size:
+                os.truncate(f, offset + size)
+        if entries and entries[-1].rows < BLOCK_ROWS:
+            part.tail, part.tail_at = entries[-1], (len(entries) - 1) * self.entry_size
+            part.prev_ts = entries[-2].ts_last if len(entries) > 1 else None
+        elif entries:
+            part.prev_ts = entries[-1].ts_last
+        return part
+
+    def write(self, part):
+        """Grava as linhas pendentes da partição: completa o bloco aberto e fecha os que enchem.
+
+        O bloco aberto é regravado no mesmo lugar com as linhas novas no fim;
+        o corpo novo começa com os mesmos bytes do anterior, então quem leu a
+        entrada antiga do índice continua decodificando as linhas dela.
+        """
+        new = part.rows
+        if not new[TS]:
+            return
+        os.makedirs(part.path, exist_ok=True)
+        rows = {name: (self.read_block(part.path, name, part.tail) if part.tail else []) + new[name]
+                for name in self.columns}
+        for pos in range(0, len(rows[TS]), BLOCK_ROWS):
+            self.write_block(part, {name: values[pos:pos + BLOCK_ROWS] for name, values in rows.items()})
+        for values in new.values():
+            values.clear()
+
+    def write_block(self, part, rows):
+        """Um bloco por coluna e a entrada do índice: no lugar do bloco aberto ou no fim."""
+        ts = rows[TS]
+        dts = gaps(ts, part.prev_ts)
+        cols = []
+        for k, name in enumerate(self.columns):
+            block = encode_block(rows[name], self.nulls.get(name))
+            path = os.path.join(part.path, name + ".col")
+            with open(path, "r+b" if part.tail else "ab") as f:
+                if part.tail:
+                    f.seek(part.tail.cols[k][0])
+                offset = f.tell()
+                f.write(block)
+                f.truncate()
+            cols.append((offset, len(block)) + block_stats(rows[name], self.nulls.get(name),
+                                                            dts if name in self.scales else None))
+        entry = IndexEntry(min(ts), max(ts), ts[-1], len(ts), cols)
+        with open(os.path.join(part.path, INDEX_FILE), "r+b" if part.tail else "ab") as f:
+            if part.tail:
+                f.seek(part.tail_at)
+            at = f.tell()
+            f.write(INDEX_HEAD.pack(entry.ts_min, entry.ts_max, entry.ts_last, entry.rows) +
+                    b"".join(INDEX_COL.pack(*c) for c in cols))
+        if entry.rows >= BLOCK_ROWS:
+            part.tail = None
+            part.prev_ts = ts[-1]
+        else:
+            part.tail, part.tail_at = entry, at
+
+    def flush(self):
+        """Grava o que estiver pendente (no bloco aberto de cada dia) e esquece as partições."""
+        for part in self.open.values():
+            self.write(part)
+        self.open.clear()
+
+    def stations(self):
+        try:
+            return sorted(os.listdir(self.root))
+        except FileNotFoundError:
+            return []
+
+    def days(self, station, first=None, last=None):
+        """Dias gravados de uma estação, em ordem, dentro de [first, last] (AAAA-MM-DD)."""
+        try:
+            days = sorted(os.listdir(os.path.join(self.root, STATION_RE.sub("_", station))))
+        except FileNotFoundError:
+            return []
+        return [d for d in days if (first is None or d >= first) and (last is None or d <= last)]
+
+    def scan(self, station, field, first=None, last=None):
+        """Valores de um campo (float ou None) nos dias [first, last]; só lê a coluna dele."""
+        digits = len(str(self.scales.get(field, 1))) - 1
+        for day in self.days(station, first, last):
+            for v in read_column(os.path.join(self.partition_path(station, day), field + ".col")):
+                yield self.value(field, v, digits)
+
+    def value(self, field, raw, digits=None):
+        """Ponto fixo -> unidade do campo (None para o sentinela)."""
+        scale = self.scales.get(field, 1)
+        if raw == self.nulls.get(field):
+            return None
+        if scale == 1:
+            return raw
+        return round(raw / scale, len(str(scale)) - 1 if digits is None else digits)
+
+    # ===============================
+    # ÍNDICE
+    # ===============================
+    def read_index(self, path, repair=False):
+        """Entradas do índice de uma partição; None sem índice.
+
+        Uma entrada pela metade (queda durante a gravação) fica de fora; com
+        `repair` (quem vai gravar) ela é cortada do arquivo.
+        """
+        name = os.path.join(path, INDEX_FILE)
+        try:
+            with open(name, "rb") as f:
+                data = f.read()
+        except FileNotFoundError:
+            return None
+        whole = len(data) - len(data) % self.entry_size
+        if repair and whole != len(data):
+            os.truncate(name, whole)
+        entries = []
+        for pos in range(0, whole, self.entry_size):
+            ts_min, ts_max, ts_last, rows = INDEX_HEAD.unpack_from(data, pos)
+            cols = [INDEX_COL.unpack_from(data, pos + INDEX_HEAD.size + k * INDEX_COL.size)
+                    for k in range(len(self.columns))]
+            entries.append(IndexEntry(ts_min, ts_max, ts_last, rows, cols))
+        return entries
+
+    def rebuild_index(self, path):
+        """Refaz o índice de uma partição a partir das colunas (gravadas sem índice)."""
+        files = {}
+        for name in self.columns:
+            try:
+                with open(os.path.join(path, name + ".col"), "rb") as f:
+                    data = f.read()
+            except FileNotFoundError:
+                data = b""
+            files[name] = (data, read_blocks(data))
+        out = []
+        prev = None
+        for k in range(min(len(blocks) for _, blocks in files.values())):
+            data, blocks = files[TS]
+            ts = decode_body(data, blocks[k].start, blocks[k].end, blocks[k].count)
+            dts = gaps(ts, prev)
+            prev = ts[-1]
+            out.append(INDEX_HEAD.pack(min(ts), max(ts), ts[-1], len(ts)))
+            for name in self.columns:
+                data, blocks = files[name]
+                b = blocks[k]
+                values = decode_body(data, b.start, b.end, b.count)
+                stats = block_stats(values, self.nulls.get(name), dts if name in self.scales else None)
+                out.append(INDEX_COL.pack(b.start, b.end + BLOCK_FOOTER.size - b.start, *stats))
+        tmp = os.path.join(path, INDEX_FILE + ".tmp")
+        with open(tmp, "wb") as f:
+            f.write(b"".join(out))
+        os.replace(tmp, os.path.join(path, INDEX_FILE))
+
+    def index(self, station, day):
+        """Índice de um dia; os dias encerrados ficam em memória (não mudam mais)."""
+        key = (station, day)
+        entries = self.cache.get(key)
+        if entries is not None:
+            return entries
+        path = self.partition_path(station, day)
+        closed = day < self.settled()
+        entries = self.read_index(path)
+        if entries is None:
+            if not closed:
+                return []  # primeiro bloco do dia sendo gravado agora
+            self.rebuild_index(path)
+            entries = self.read_index(path) or []
+        if closed:
+            self.cache[key] = entries
+        return entries
+
+    def warm(self):
+        """Carrega os índices dos dias encerrados (a primeira consulta longa não paga a leitura)."""
+        for station in self.stations():
+            for day in self.days(station, last=self.settled()):
+                if day < self.settled():
+                    self.index(station, day)
+
+    def settled(self):
+        """Dias antes deste estão encerrados (recalculado a cada minuto)."""
+        now = time.time()
+        if now - self.settled_at > 60:
+            self.settled_day, self.settled_at = self.day(now * 1000 - SETTLE_MS), now
+        return self.settled_day
+
+    def read_block(self, path, name, entry):
+        """Valores de uma coluna num bloco do índice: um seek e um read."""
+        offset, size = entry.cols[self.columns.index(name)][:2]
+        with open(os.path.join(path, name + ".col"), "rb") as f:
+            f.seek(offset)
+            data = f.read(size)
+        return decode_body(data, 0, size - BLOCK_FOOTER.size, entry.rows)
+
+    # ===============================
+    # CONSULTA
+    # ===============================
+    def blocks(self, station, t0, t1):
+        """(dia, entrada, ts da linha anterior) dos blocos com alguma linha em [t0, t1] ms."""
+        for day in self.days(station, self.day(t0), self.day(t1)):
+            prev = None
+            for entry in self.index(station, day):
+                if entry.ts_max >= t0 and entry.ts_min <= t1:
+                    yield day, entry, prev
+                prev = entry.ts_last
+
+    def select(self, station, fields, t0, t1):
+        """Linhas (ts ms, [valores]) da estação em [t0, t1] ms, só com as colunas de `fields`."""
+        for day, entry, _ in self.blocks(station, t0, t1):
+            path = self.partition_path(station, day)
+            ts = self.read_block(path, TS, entry)
+            cols = [self.read_block(path, name, entry) for name in fields]
+            for k, t in enumerate(ts):
+                if t0 <= t <= t1:
+                    yield t, [self.value(name, col[k]) for name, col in zip(fields, cols)]
+
+    def bucket(self, t, t0, interval_ms):
+        """Início do intervalo de `t`; os intervalos começam na meia-noite do fuso."""
+        if not interval_ms:
+            return t0
+        return (t + self.tz_ms) // interval_ms * interval_ms - self.tz_ms
+
+    def aggregate(self, station, fields, t0, t1, interval_ms=None, aggregates=AGGREGATES):
+        """Agregados de `fields` por intervalo em [t0, t1] ms: [(início, {campo: {agregado: valor}})].
+
+        Intervalo None = um só, começando em t0. Blocos inteiros dentro de um
+        intervalo saem do índice; só os das pontas são decodificados.
+        """
+        for name in fields:
+            if name not in self.scales:
+                raise ValueError(f"campo desconhecido: {name}")
+        for a in aggregates:
+            if a not in AGGREGATES:
+                raise ValueError(f"agregado desconhecido: {a}")
+        pos = [self.columns.index(name) for name in fields]
+        acc = {}  # início -> [[não nulos, soma, mínimo, máximo, integral] por campo]
+        for day, entry, prev in self.blocks(station, t0, t1):
+            start = self.bucket(entry.ts_min, t0, interval_ms)
+            if t0 <= entry.ts_min and entry.ts_max <= t1 and start == self.bucket(entry.ts_max, t0, interval_ms):
+                slot = acc.get(start)
+                if slot is None:
+                    slot = acc[start] = [[0, 0, None, None, 0] for _ in fields]
+                for s, k in zip(slot, pos):
+                    _, _, count, lo, hi, total, integral = entry.cols[k]
+                    if count:
+                        s[0] += count
+                        s[1] += total
+                        s[2] = lo if s[2] is None or lo < s[2] else s[2]
+                        s[3] = hi if s[3] is None or hi > s[3] else s[3]
+                        s[4] += integral
+                continue
+            path = self.partition_path(station, day)
+            ts = self.read_block(path, TS, entry)
+            dts = gaps(ts, prev)
+            for f, name in enumerate(fields):
+                null = self.nulls[name]
+                for t, dt, v in zip(ts, dts, self.read_block(path, name, entry)):
+                    if v == null or not t0 <= t <= t1:
+                        continue
+                    start = self.bucket(t, t0, interval_ms)
+                    slot = acc.get(start)
+                    if slot is None:
+                        slot = acc[start] = [[0, 0, None, None, 0] for _ in fields]
+                    s = slot[f]
+                    s[0] += 1
+                    s[1] += v
+                    s[2] = v if s[2] is None or v < s[2] else s[2]
+                    s[3] = v if s[3] is None or v > s[3] else s[3]
+                    s[4] += v * dt
+
+        out = []
+        for start in sorted(acc):
+            row = {}
+            for name, (count, total, lo, hi, integral) in zip(fields, acc[start]):
+                scale = self.scales[name]
+                result = {"count": count,
+                          "min": lo / scale if count else None,
+                          "max": hi / scale if count else None,
+                          "avg": total / count / scale if count else None,
+                          "sum": total / scale,
+                          "integral": integral / scale / 3600000}  # unidade x hora (p -> Wh)
+                row[name] = {a: result[a] for a in aggregates}
+            out.append((start, row))
+        return out
@@ -0,0 +1,154 @@
+import argparse
+import random
+import struct
+import sys
+import time
+
+from server import (Reassembler, RecordError, Frame, DeltaDecoder, decode_data, FRAME_HEADER, FRAME_MAGIC,
+                    FRAME_HELLO, FRAME_DATA, FRAME_KEY, FRAME_DELTA, BIN_MAGIC, BIN_HEADER, SEQ, SCHEMAS,
+                    STATION_SCHEMA)
+
+# ===============================
+# BANCADA DA RECEPÇÃO DO STREAM TCP (server.Reassembler)
+# ===============================
+# Monta o stream que uma estação manda ao descarregar a fila depois de uma
+# queda (HELLO, quadros DATA com JSON e binário, KEY/DELTA do codec e JSON
+# sem quadro) e o de um firmware antigo (só JSON, sem quadros), entrega em
+# pedaços como o TCP entregaria e confere que todo registro saiu inteiro,
+# uma vez, na ordem. Imprime registros/s e MB/s por cenário; sai com erro
+# se alguma verificação falhar.
+#
+#   python3 framing_bench.py                  # 20000 registros
+#   python3 framing_bench.py --records 100000 --seed 7
+
+FIELDS = SCHEMAS[STATION_SCHEMA]
+STRUCT = struct.Struct("<B" + "".join(t for _, t, _ in FIELDS))
+
+# (nome, tamanho dos pedaços): segmentos juntados num recv, um MSS por vez
+# e pedaços mínimos, que cortam cabeçalhos e caracteres UTF-8 ao meio
+SCENARIOS = [
+    ("recv de 64 KiB", lambda rnd: 65536),
+    ("um MSS (1460)", lambda rnd: 1460),
+    ("recv do servidor (4096)", lambda rnd: 4096),
+    ("pedaços de 1 a 64", lambda rnd: rnd.randint(1, 64)),
+]
+
+def frame(kind, body):
+    return FRAME_HEADER.pack(FRAME_MAGIC, kind, len(body)) + body
+
+def varint(v):
+    out = bytearray()
+    while True:
+        b = v & 0x7F
+        v >>= 7
+        out.append(b | 0x80 if v else b)
+        if not v:
+            return bytes(out)
+
+def zigzag(v):
+    return v << 1 if v >= 0 else (-v << 1) - 1
+
+def sample(rnd, i):
+    """Valores brutos (ponto fixo) de um registro, variando devagar como os sensores."""
+    return [1000 + i % 500 + rnd.randint(0, 3) for _ in FIELDS]
+
+def as_json(values):
+    # mesmo formato da estação (telemetry.c), com a quebra de linha no meio
+    data = ", ".join(f'"{name}": {raw / scale:.{len(str(scale)) - 1}f}'
+                     for (name, _, scale), raw in zip(FIELDS, values))
+    return ('{ "meta": { "pend": false }, "data": { ' + data + ' }\n}\n').encode()
+
+def build_stream(count, seed):
+    """Stream de uma estação e os seqs esperados, na ordem."""
+    rnd = random.Random(seed)
+    station = b"E6605838830F5A2B"
+    out = [frame(FRAME_HELLO, b"\x00" + station)]
+    expected = []
+    prev = None
+    seq = (3 << 32) | 1
+    for i in range(count):
+        values = sample(rnd, i)
+        mode = rnd.random()
+        if mode < 0.4:
+            # quadro DELTA (ou KEY no primeiro e de vez em quando)
+            if prev is None or rnd.random() < 0.02:
+                body = SEQ.pack(seq) + bytes([0]) + b"".join(varint(zigzag(v)) for v in values)
+                out.append(frame(FRAME_KEY, body))
+            else:
+                body = varint(seq - prev[0]) + bytes([0]) + b"".join(
+                    varint(zigzag(v - r)) for v, r in zip(values, prev[1]))
+                out.append(frame(FRAME_DELTA, body))
+            prev = (seq, values)
+            expected.append(seq)
+        elif mode < 0.7:
+            record = BIN_HEADER.pack(BIN_MAGIC, STATION_SCHEMA, STRUCT.size) + STRUCT.pack(0, *values)
+            out.append(frame(FRAME_DATA, SEQ.pack(seq) + record))
+            expected.append(seq)
+        elif mode < 0.95:
+            out.append(frame(FRAME_DATA, SEQ.pack(seq) + as_json(values)))
+            expected.append(seq)
+        else:
+            # JSON sem quadro (firmware antigo): conta, mas sem seq
+            out.append(as_json(values))
+            expected.append(None)
+        seq += 1 + (rnd.random() < 0.01)  # de vez em quando um registro descartado na estação
+    return b"".join(out), expected
+
+def build_legacy(count, seed):
+    """Stream de um firmware sem quadros: só JSON, um atrás do outro."""
+    rnd = random.Random(seed)
+    return b"".join(as_json(sample(rnd, i)) for i in range(count)), [None] * count
+
+def run(stream, expected, chunk_size, rnd):
+    """Entrega o stream em pedaços; retorna (segundos, recvs) ou levanta AssertionError."""
+    reassembler = Reassembler()
+    delta = DeltaDecoder()
+    got = []
+    recvs = 0
+    t0 = time.perf_counter()
+    pos = 0
+    while pos < len(stream):
+        n = chunk_size(rnd)
+        recvs += 1
+        for item in reassembler.feed(stream[pos:pos + n]):
+            if isinstance(item, RecordError):
+                raise AssertionError(f"registro inválido: {item}")
+            if not isinstance(item, Frame):
+                got.append(None)
+            elif item.kind == FRAME_DATA:
+                seq, payload = decode_data(item.body, reassembler.decoder)
+                assert payload is not None, f"DATA {seq:#x} sem registro"
+                got.append(seq)
+            elif item.kind in (FRAME_KEY, FRAME_DELTA):
+                got.append(delta.decode(item.kind, item.body)[0])
+        pos += n
+    elapsed = time.perf_counter() - t0
+
+    assert len(reassembler) == 0, f"{len(reassembler)} bytes sobraram no buffer"
+    assert got == expected, f"{len(got)} registros recebidos, {len(expected)} esperados"
+    return elapsed, recvs
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--records", type=int, default=20000)
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+
+    ok = True
+    for title, build in (("estação atual", build_stream), ("firmware antigo, só JSON", build_legacy)):
+        stream, expected = build(args.records, args.seed)
+        print(f"{title}: {len(expected)} registros, {len(stream)} bytes "
+              f"({len(stream) / len(expected):.1f} B/registro)")
+        for name, chunk_size in SCENARIOS:
+            try:
+                elapsed, recvs = run(stream, expected, chunk_size, random.Random(args.seed))
+            except AssertionError as e:
+                print(f"  {name:<24} FALHOU: {e}")
+                ok = False
+                continue
+            print(f"  {name:<24} {recvs:>8} recvs  {len(expected) / elapsed:>10.0f} registros/s  "
+                  f"{len(stream) / elapsed / 1e6:>6.2f} MB/s")
+    sys.exit(0 if ok else 1)
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,95 @@
+import argparse
+import json
+import os
+import sys
+import time
+from datetime import datetime
+
+from colstore import ColumnStore, spread
+from server import COLUMN_DIR, COLUMN_FIELDS, OUTPUT_FILE, column_row
+
+# ===============================
+# IMPORTAÇÃO DO data.txt PARA AS COLUNAS (colstore.py)
+# ===============================
+# Lê os registros JSON gravados pelo servidor e grava a telemetria em
+# colunas, por estação e dia. A hora é o received_at do registro (resolução
+# de minuto), com os registros do mesmo minuto espalhados desde o anterior
+# da estação (colstore.spread); registros sem estação (firmware antigo,
+# antes do HELLO) vão para SEM_ESTACAO. Saúde e linhas inválidas ficam só
+# no data.txt.
+#
+#   python3 import_data.py                          # OUTPUT_FILE -> COLUMN_DIR
+#   python3 import_data.py data.txt antigo.txt --out /tmp/colunas
+#
+# Só grava num diretório vazio: importar duas vezes duplicaria as linhas.
+
+SEM_ESTACAO = "sem_estacao"
+
+def rows(path, counts):
+    with open(path, encoding="utf-8", errors="replace") as f:
+        for line in f:
+            counts["linhas"] += 1
+            try:
+                payload = json.loads(line)
+                ts = datetime.fromisoformat(payload["received_at"]).timestamp()
+            except (ValueError, KeyError, TypeError):
+                counts["inválidas"] += 1
+                continue
+            if not isinstance(payload, dict):
+                counts["inválidas"] += 1
+                continue
+            meta = payload.get("meta")
+            meta = meta if isinstance(meta, dict) else {}
+            row = column_row(str(meta.get("station", SEM_ESTACAO)), meta.get("seq"), payload, ts)
+            if row is None:
+                counts["sem telemetria"] += 1
+                continue
+            counts["importadas"] += 1
+            yield row
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("files", nargs="*", default=[OUTPUT_FILE], help="arquivos data.txt, na ordem")
+    parser.add_argument("--out", default=COLUMN_DIR, help="diretório das colunas (vazio ou inexistente)")
+    args = parser.parse_args()
+
+    if os.path.isdir(args.out) and os.listdir(args.out):
+        print(f"{args.out} não está vazio: importar de novo duplicaria as linhas")
+        sys.exit(1)
+
+    store = ColumnStore(args.out, COLUMN_FIELDS)
+    counts = {"linhas": 0, "importadas": 0, "sem telemetria": 0, "inválidas": 0}
+    size_in = 0
+    t0 = time.perf_counter()
+    batches = {}  # estação -> linhas do minuto corrente
+    last = {}     # estação -> ts da última linha gravada
+
+    def settle(station):
+        batch = spread(batches.pop(station), last.get(station))
+        last[station] = batch[-1][1]
+        for row in batch:
+            store.append(*row)
+
+    for path in args.files:
+        size_in += os.path.getsize(path)
+        for row in rows(path, counts):
+            batch = batches.get(row[0])
+            if batch and batch[-1][1] != row[1]:
+                settle(row[0])
+            batches.setdefault(row[0], []).append(row)
+    for station in list(batches):
+        settle(station)
+    store.flush()
+    elapsed = time.perf_counter() - t0
+
+    size_out = partitions = 0
+    for station in store.stations():
+        for day in store.days(station):
+            partitions += 1
+            folder = store.partition_path(station, day)
+            size_out += sum(os.path.getsize(os.path.join(folder, name)) for name in os.listdir(folder))
+    print(", ".join(f"{v} {k}" for k, v in counts.items()))
+    print(f"{partitions} partições (estação/dia) em {args.out}; {size_in} -> {size_out} bytes em {elapsed:.1f} s")
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,205 @@
+import argparse
+import json
+import socket
+import struct
+import threading
+
+from server import next_record, RecordError
+
+# ===============================
+# BROKER MQTT 3.1.1 MÍNIMO (teste local do drivers/network/mqtt_client)
+# ===============================
+# Aceita CONNECT, PUBLISH com QoS 0 e 1 (responde PUBACK), SUBSCRIBE
+# (repassa as publicações com QoS 0, filtros com + e #), PINGREQ e
+# DISCONNECT. Sem sessões persistentes nem retain: é um substituto para
+# testar a estação no host, não um broker de produção.
+#
+#   python3 mqtt_broker.py                    # escuta em 0.0.0.0:1883
+#   python3 mqtt_broker.py --drop-every 25    # fecha a conexão sem PUBACK a cada 25 PUBLISH novos
+
+TCP_IP = "0.0.0.0"
+TCP_PORT = 1883
+
+CONNECT, CONNACK, PUBLISH, PUBACK = 1, 2, 3, 4
+SUBSCRIBE, SUBACK, PINGREQ, PINGRESP, DISCONNECT = 8, 9, 12, 13, 14
+
+subscribers = []  # (conn, lock, filtro)
+subscribers_lock = threading.Lock()
+
+# publicações QoS 1 já recebidas, entre conexões: marca os reenvios
+received = set()
+received_lock = threading.Lock()
+
+def read_exact(conn, n):
+    data = b""
+    while len(data) < n:
+        chunk = conn.recv(n - len(data))
+        if not chunk:
+            raise ConnectionError("conexão fechada")
+        data += chunk
+    return data
+
+def read_packet(conn):
+    """Retorna (byte de cabeçalho, corpo)."""
+    first = read_exact(conn, 1)[0]
+    size, mult = 0, 1
+    while True:
+        b = read_exact(conn, 1)[0]
+        size += (b & 0x7F) * mult
+        mult *= 128
+        if not b & 0x80:
+            break
+        if mult > 128 ** 3:
+            raise ValueError("tamanho restante inválido")
+    return first, read_exact(conn, size)
+
+def encode_packet(first, body):
+    size = len(body)
+    out = bytearray([first])
+    while True:
+        b = size % 128
+        size //= 128
+        out.append(b | 0x80 if size else b)
+        if not size:
+            break
+    return bytes(out) + body
+
+def read_str(body, pos):
+    (n,) = struct.unpack_from(">H", body, pos)
+    return body[pos + 2:pos + 2 + n].decode("utf-8", errors="replace"), pos + 2 + n
+
+def topic_matches(pattern, topic):
+    pp, tp = pattern.split("/"), topic.split("/")
+    for i, p in enumerate(pp):
+        if p == "#":
+            return True
+        if i >= len(tp) or (p != "+" and p != tp[i]):
+            return False
+    return len(pp) == len(tp)
+
+def describe(payload):
+    """Registro da estação (JSON ou binário) em texto, se reconhecido."""
+    try:
+        record, _ = next_record(payload, json.JSONDecoder())
+    except RecordError:
+        record = None
+    if isinstance(record, dict):
+        return json.dumps(record)
+    return payload.decode("utf-8", errors="replace")
+
+def forward(topic, payload):
+    with subscribers_lock:
+        targets = [(c, l) for c, l, f in subscribers if topic_matches(f, topic)]
+    if not targets:
+        return
+    body = struct.pack(">H", len(topic.encode())) + topic.encode() + payload
+    packet = encode_packet(PUBLISH << 4, body)
+    for conn, lock in targets:
+        try:
+            with lock:
+                conn.sendall(packet)
+        except OSError:
+            pass
+
+def handle_client(conn, addr, args, stats):
+    print(f"\n[NOVA CONEXÃO] {addr}")
+    lock = threading.Lock()
+    client_id = "?"
+
+    try:
+        while True:
+            first, body = read_packet(conn)
+            kind = first >> 4
+
+            if kind == CONNECT:
+                proto, pos = read_str(body, 0)
+                level, flags, keepalive = struct.unpack_from(">BBH", body, pos)
+                client_id, _ = read_str(body, pos + 4)
+                rc = 0 if proto == "MQTT" and level == 4 else 1
+                print(f"[CONNECT] {addr}: {client_id} (keepalive {keepalive} s, rc {rc})")
+                with lock:
+                    conn.sendall(encode_packet(CONNACK << 4, bytes([0, rc])))
+                if rc:
+                    break
+
+            elif kind == PUBLISH:
+                qos = (first >> 1) & 0x03
+                dup = bool(first & 0x08)
+                topic, pos = read_str(body, 0)
+                packet_id = None
+                if qos:
+                    (packet_id,) = struct.unpack_from(">H", body, pos)
+                    pos += 2
+                payload = body[pos:]
+
+                key = (client_id, topic, payload)
+                with received_lock:
+                    repeated = bool(qos) and key in received
+                if not repeated:
+                    # só publicações novas contam, senão o reenvio cai sempre no mesmo ponto
+                    stats["publish"] += 1
+                    if args.drop_every and stats["publish"] % args.drop_every == 0:
+                        print(f"[QUEDA] {client_id}: fechando sem PUBACK (id {packet_id})")
+                        break
+                if qos:
+                    with received_lock:
+                        received.add(key)
+                tag = " DUP" if dup else ""
+                tag += " (repetido)" if repeated else ""
+                print(f"[PUBLISH] {client_id} {topic} qos{qos} id {packet_id}{tag}: {describe(payload)}")
+                if not repeated:
+                    forward(topic, payload)
+                if qos == 1:
+                    with lock:
+                        conn.sendall(encode_packet(PUBACK << 4, struct.pack(">H", packet_id)))
+
+            elif kind == SUBSCRIBE:
+                (packet_id,) = struct.unpack_from(">H", body, 0)
+                pos, granted = 2, []
+                while pos < len(body):
+                    pattern, pos = read_str(body, pos)
+                    pos += 1  # QoS pedido: entrega sempre com QoS 0
+                    with subscribers_lock:
+                        subscribers.append((conn, lock, pattern))
+                    granted.append(0)
+                    print(f"[SUBSCRIBE] {client_id}: {pattern}")
+                with lock:
+                    conn.sendall(encode_packet(SUBACK << 4, struct.pack(">H", packet_id) + bytes(granted)))
+
+            elif kind == PINGREQ:
+                with lock:
+                    conn.sendall(encode_packet(PINGRESP << 4, b""))
+
+            elif kind == DISCONNECT:
+                print(f"[DISCONNECT] {client_id}")
+                break
+
+    except (ConnectionError, OSError, ValueError, struct.error) as e:
+        print(f"[ENCERRADO] {client_id} {addr}: {e}")
+    finally:
+        with subscribers_lock:
+            subscribers[:] = [s for s in subscribers if s[0] is not conn]
+        conn.close()
+
+def start_broker():
+    parser = argparse.ArgumentParser(description="Broker MQTT mínimo para testes locais")
+    parser.add_argument("--port", type=int, default=TCP_PORT)
+    parser.add_argument("--drop-every", type=int, default=0,
+                        help="fecha a conexão sem PUBACK a cada N PUBLISH novos (testa o reenvio QoS 1)")
+    args = parser.parse_args()
+
+    server_sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    server_sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    server_sock.bind((TCP_IP, args.port))
+    server_sock.listen(5)
+    print(f"\nBroker MQTT escutando em {TCP_IP}:{args.port}")
+
+    stats = {"publish": 0}
+    while True:
+        conn, addr = server_sock.accept()
+        thread = threading.Thread(target=handle_client, args=(conn, addr, args, stats))
+        thread.daemon = True
+        thread.start()
+
+if __name__ == "__main__":
+    start_broker()
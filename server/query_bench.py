@@ -0,0 +1,107 @@
+import argparse
+import math
+import os
+import random
+import sys
+import tempfile
+import time
+
+from colstore import ColumnStore, TS, gaps, read_column
+from server import COLUMN_FIELDS
+
+# ===============================
+# BANCADA DA CONSULTA (colstore.ColumnStore.aggregate)
+# ===============================
+# Grava um ano de telemetria de várias estações nas colunas (o bloco aberto
+# é regravado até encher, então o resultado é o mesmo que o GroupWriter
+# deixa, com qualquer COLUMN_FLUSH_S) e mede "energia diária por
+# estação no último ano" (integral de p por dia): com o índice frio (lido do
+# disco), quente (dias encerrados em memória) e decodificando as colunas
+# inteiras, sem índice. Sai com erro se os resultados divergirem.
+#
+#   python3 query_bench.py                            # 20 estações, 365 dias, uma linha a cada 5 min
+#   python3 query_bench.py --stations 100 --dir /mnt/sd --keep
+
+DAY_MS = 86400 * 1000
+
+def build(root, args):
+    store = ColumnStore(root, COLUMN_FIELDS)
+    rnd = random.Random(1)
+    step = args.period * 1000
+    t0 = (int(time.time() * 1000) - args.days * DAY_MS) // DAY_MS * DAY_MS
+    for s in range(args.stations):
+        station = f"ST{s:05d}"
+        t = t0 + rnd.randint(0, step)
+        for k in range(args.days * DAY_MS // step):
+            hour = (t // 3600000 - 3) % 24
+            sun = max(0.0, math.sin((hour - 6) / 12 * math.pi))
+            values = [round(sun * 500 * scale) if name.startswith("lux") or name == "p" else
+                      rnd.randint(0, 100) * scale // 10 for name, scale, _ in COLUMN_FIELDS]
+            store.append(station, t, (1 << 32) | k + 1, values)
+            t += step
+        store.flush()
+    return t0
+
+def full_scan(store, station, t0, t1):
+    """Sem índice: decodifica ts e p de cada dia inteiro."""
+    out = {}
+    for day in store.days(station, store.day(t0), store.day(t1)):
+        path = store.partition_path(station, day)
+        ts = read_column(os.path.join(path, TS + ".col"))
+        p = read_column(os.path.join(path, "p.col"))
+        for t, dt, v in zip(ts, gaps(ts, None), p):
+            if t0 <= t <= t1 and v != store.nulls["p"]:
+                start = store.bucket(t, t0, DAY_MS)
+                out[start] = out.get(start, 0) + v * dt
+    return sorted((start, v / store.scales["p"] / 3600000) for start, v in out.items())
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--stations", type=int, default=20)
+    parser.add_argument("--days", type=int, default=365)
+    parser.add_argument("--period", type=int, default=300, help="s entre registros")
+    parser.add_argument("--dir", default=None, help="onde gravar (padrão: diretório temporário)")
+    parser.add_argument("--keep", action="store_true", help="reaproveita as colunas de --dir se já existirem")
+    args = parser.parse_args()
+
+    tmp = None
+    root = os.path.join(args.dir, "colunas") if args.dir else None
+    if root is None:
+        tmp = tempfile.TemporaryDirectory()
+        root = tmp.name
+    if not (args.keep and os.path.isdir(root) and os.listdir(root)):
+        t = time.perf_counter()
+        build(root, args)
+        print(f"gravação: {args.stations} estações x {args.days} dias, "
+              f"{args.stations * args.days * DAY_MS // (args.period * 1000)} linhas em {time.perf_counter() - t:.1f} s")
+
+    now = int(time.time() * 1000)
+    t0, t1 = now - args.days * DAY_MS, now
+    store = ColumnStore(root, COLUMN_FIELDS)
+    stations = store.stations()
+    results = {}
+    for title in ("índice frio", "índice quente"):
+        t = time.perf_counter()
+        results[title] = {s: [(start, row["p"]["integral"]) for start, row in
+                              store.aggregate(s, ["p"], t0, t1, DAY_MS, ["integral"])] for s in stations}
+        print(f"  {title:<14} {(time.perf_counter() - t) * 1000:>8.0f} ms  "
+              f"({sum(map(len, results[title].values()))} dias em {len(stations)} estações)")
+    t = time.perf_counter()
+    results["sem índice"] = {s: full_scan(store, s, t0, t1) for s in stations}
+    print(f"  {'sem índice':<14} {(time.perf_counter() - t) * 1000:>8.0f} ms")
+
+    ok = True
+    for title, result in results.items():
+        for s in stations:
+            a, b = result[s], results["sem índice"][s]
+            if len(a) != len(b) or any(x[0] != y[0] or not math.isclose(x[1], y[1], rel_tol=1e-9, abs_tol=1e-9)
+                                       for x, y in zip(a, b)):
+                print(f"  {title}: {s} diverge da leitura sem índice")
+                ok = False
+                break
+    if tmp:
+        tmp.cleanup()
+    sys.exit(0 if ok else 1)
+
+if __name__ == "__main__":
+    main()
@@ -1,8 +1,19 @@
+import argparse
+import asyncio
+import os
+import re
 import socket
 import json
+import struct
+import sys
 import threading
+import time
+from concurrent.futures import ThreadPoolExecutor
+from collections import namedtuple
 from datetime import datetime, timezone, timedelta
 
+from colstore import ColumnStore, AGGREGATES, spread
+
 # ===============================
 # CONFIGURAÇÕES
 # ===============================
@@ -10,74 +21,1001 @@ TCP_IP = "0.0.0.0"
 TCP_PORT = 9999
 OUTPUT_FILE = "..\\solar_station_v2\\server\\data.txt"
 BUFFER_SIZE = 4096
+MAX_PENDING = 64 * 1024  # descarta o acumulado se nenhum JSON fechar até aqui
+STATE_FILE = "..\\solar_station_v2\\server\\seq_state.json"  # último seq gravado por estação
 
-def handle_client(conn, addr):
-    """Função que gerencia cada conexão de cliente em uma thread separada."""
-    print(f"\n[NOVA CONEXÃO] {addr}")
-    
-    # Configura o Keep-Alive no socket da conexão específica
-    # Isso detecta se o cliente caiu sem fechar a conexão
-    conn.setsockopt(socket.SOL_SOCKET, socket.SO_KEEPALIVE, 1)
-    
-    # Configurações específicas para Linux/Windows (opcional, ajusta o tempo de detecção)
-    # No Windows, o padrão de detecção de queda pode ser longo. 
-    # Com Keep-alive, o SO gerencia isso.
-    
+# ingestão: todas as conexões num laço asyncio, numa thread só (o terminal
+# roda à parte). Depois de uma queda geral do Wi-Fi as estações voltam
+# todas juntas; cada uma custa só o buffer dela
+MAX_CONNECTIONS = 4096   # além disso a conexão nova é fechada; a estação tenta de novo pela agenda dela
+LISTEN_BACKLOG = 512     # conexões esperando o accept
+IDLE_TIMEOUT = 300       # s sem nada da estação: a conexão é encerrada (estação que sumiu sem FIN)
+MAX_BUFFER = 2 * MAX_PENDING  # acumulado por conexão: cabe um quadro inteiro (até 64 KiB) e o início do próximo
+VERBOSE = False          # um print por registro (--verbose); com muitas estações isso segura o laço
+
+# gravação em grupo (GroupWriter): os registros de todas as conexões vão
+# para uma fila e saem juntos num write só, com o arquivo sempre aberto. O
+# grupo sai quando junta WRITE_BATCH_BYTES ou quando o mais antigo espera
+# WRITE_BATCH_MS (e enquanto um grupo grava, o próximo vai juntando).
+# FSYNC_POLICY decide o que a confirmação (ACK/NACK) garante:
+#   "group"     fsync de cada grupo antes de confirmar: nada confirmado se perde
+#   "interval"  confirma depois do write; fsync a cada FSYNC_INTERVAL s. Uma
+#               queda de energia perde até FSYNC_INTERVAL s já confirmados
+#   "never"     confirma depois do write; o SO decide quando vai ao disco
+WRITE_BATCH_BYTES = 256 * 1024
+WRITE_BATCH_MS = 10
+FSYNC_POLICY = "group"
+FSYNC_INTERVAL = 1.0
+FSYNC_POLICIES = ("group", "interval", "never")
+
+# cópia em colunas da telemetria (colstore.py), por estação e dia, feita
+# pela mesma thread depois do arquivo. O data.txt continua sendo o que o ACK
+# garante; as colunas vão ao disco a cada bloco cheio e a cada
+# COLUMN_FLUSH_S, e o que faltar depois de uma queda o import_data.py refaz
+COLUMN_DIR = "..\\solar_station_v2\\server\\columns"
+COLUMN_FLUSH_S = 300
+
+# ===============================
+# REGISTRO BINÁRIO (drivers/telemetry/telemetry.h)
+# ===============================
+# cabeçalho: magic, versão do esquema, tamanho do corpo (LE). 0xF5 nunca
+# aparece em UTF-8, então o registro binário pode vir no meio dos JSONs
+BIN_MAGIC = 0xF5
+BIN_HEADER = struct.Struct("<BBH")
+
+# esquemas conhecidos: campos na ordem do registro, depois do byte de flags,
+# como (nome, tipo struct, escala); a escala define as casas decimais, iguais
+# às do JSON enviado pela Pico
+SCHEMAS = {
+    1: [
+        ("lux1", "i", 100), ("lux2", "i", 100), ("lux3", "i", 100),
+        ("pt", "h", 100), ("rl", "h", 100),
+        ("tp", "h", 100),
+        ("vb", "H", 100),
+        ("vs", "h", 10000),
+        ("i", "i", 10000), ("p", "i", 10000),
+    ],
+}
+
+# leitura inválida: menor valor com sinal ou maior sem sinal
+SENTINELS = {"h": -0x8000, "i": -0x80000000, "H": 0xFFFF}
+
+# ===============================
+# QUADROS (drivers/network/tcp_client.h)
+# ===============================
+# cabeçalho: magic, tipo, tamanho do corpo (LE). HELLO apresenta a estação,
+# DATA leva o seq (u64) e um registro JSON ou binário, ACK devolve o último
+# seq gravado. Registros fora de quadro continuam aceitos, sem ACK
+FRAME_MAGIC = 0xF6
+FRAME_HEADER = struct.Struct("<BBH")
+FRAME_HELLO, FRAME_DATA, FRAME_ACK = 1, 2, 3
+HELLO_RESET = 0x01  # a estação recomeçou a numeração (sem log na flash)
+SEQ = struct.Struct("<Q")
+
+# UDP (drivers/network/udp_client.h): cada datagrama é um quadro BATCH com
+# seq, flags, id da estação e registros (u16 + dados); a resposta é um NACK
+# com a base (tudo até ela chegou) e o mapa dos que faltam depois dela
+FRAME_UDP_BATCH, FRAME_UDP_NACK = 4, 5
+UDP_BATCH = struct.Struct("<QBB")
+UDP_NACK = struct.Struct("<QBI")
+UDP_NACK_BITS = 32
+
+# codec delta (drivers/telemetry/telemetry.h): KEY leva o seq (u64) e os
+# valores em ponto fixo do esquema 1; DELTA, quanto o seq avançou e a
+# diferença para o registro anterior da conexão. Ambos em varint zigzag,
+# depois do byte de flags
+FRAME_KEY, FRAME_DELTA = 6, 7
+STATION_SCHEMA = 1  # esquema do firmware atual (codec delta e limiares)
+
+# comandos (drivers/network/station_config.h): CMD leva um id (u16) e pares
+# (parâmetro u8, valor i32); a estação aplica tudo ou nada e responde com
+# CMD_ACK: id, resultado, índice do par recusado e os valores atuais
+FRAME_CMD, FRAME_CMD_ACK = 8, 9
+CMD_ID = struct.Struct("<H")
+CMD_ACK = struct.Struct("<HBB")
+CMD_PAIR = struct.Struct("<Bi")
+CMD_RESULTS = {0: "ok", 1: "parâmetro desconhecido", 2: "valor fora da faixa"}
+CONFIG_PARAMS = {
+    "sample_period_ms": 1, "batch_records": 2, "batch_delay_ms": 3,
+    "sensors": 4,  # máscara: 1 lux, 2 ângulo, 4 temperatura, 8 energia
+    "display_mode": 5, "report_max_ms": 6,
+    "health_period_ms": 7,  # registro { "health": ... } (0 = desligado)
+}
+DEADBAND_PARAM = 16  # + campo: deadband_<campo>, na unidade do campo (0 = não dispara)
+
+Frame = namedtuple("Frame", "kind body")
+
+# início de um registro binário ou quadro no meio do texto
+MAGIC_RE = re.compile(bytes([ord("["), BIN_MAGIC, FRAME_MAGIC, ord("]")]))
+SPACE_RE = re.compile(rb"\s*")
+JSON_WINDOW = 1024  # o JSON da estação cabe aqui: não decodifica o resto do buffer a cada registro
+
+class RecordError(ValueError):
+    """Registro inválido; `end` é onde ele termina, se conhecido."""
+
+    def __init__(self, msg, end=None):
+        super().__init__(msg)
+        self.end = end
+
+def decode_binary(version, body):
+    """Converte um registro binário no mesmo dicionário do JSON."""
+    fields = SCHEMAS.get(version)
+    if fields is None:
+        raise ValueError(f"esquema binário desconhecido: {version}")
+    fmt = "<B" + "".join(t for _, t, _ in fields)
+    if len(body) < struct.calcsize(fmt):
+        raise ValueError(f"registro curto para o esquema {version}: {len(body)} bytes")
+
+    # campos acrescentados por versões futuras vêm no fim: o que sobra é ignorado
+    flags, *values = struct.unpack_from(fmt, body)
+    return fixed_payload(fields, flags, values)
+
+def fixed_payload(fields, flags, values):
+    """Valores em ponto fixo de um esquema -> dicionário do JSON."""
+    data = {}
+    for (name, t, scale), raw in zip(fields, values):
+        data[name] = None if raw == SENTINELS[t] else round(raw / scale, len(str(scale)) - 1)
+    return {"meta": {"pend": bool(flags & 0x01)}, "data": data}
+
+def next_record(pending, decoder, pos=0):
+    """Extrai o próximo registro de `pending` (bytes ou bytearray) a partir de `pos`.
+
+    Retorna (payload, fim); payload None quando ainda falta dado (fim é
+    então o início do registro incompleto) e um Frame para quadros do
+    protocolo. As posições são absolutas em `pending`.
+    """
+    # espaços entre registros
+    start = SPACE_RE.match(pending, pos).end()
+    if start == len(pending):
+        return None, start
+
+    if pending[start] == FRAME_MAGIC:
+        if len(pending) - start < FRAME_HEADER.size:
+            return None, start
+        _, kind, size = FRAME_HEADER.unpack_from(pending, start)
+        end = start + FRAME_HEADER.size + size
+        if len(pending) < end:
+            return None, start
+        return Frame(kind, bytes(pending[start + FRAME_HEADER.size:end])), end
+
+    if pending[start] == BIN_MAGIC:
+        if len(pending) - start < BIN_HEADER.size:
+            return None, start
+        _, version, size = BIN_HEADER.unpack_from(pending, start)
+        end = start + BIN_HEADER.size + size
+        if len(pending) < end:
+            return None, start
+        try:
+            return decode_binary(version, pending[start + BIN_HEADER.size:end]), end
+        except ValueError as e:
+            raise RecordError(str(e), end)
+
+    # JSON: só até o próximo registro binário ou quadro (os magics não
+    # aparecem no texto); surrogateescape mantém a conta de bytes mesmo com
+    # UTF-8 inválido. Primeiro só uma janela: com vários JSON seguidos no
+    # buffer, decodificar o resto inteiro a cada um seria quadrático
+    window = start + JSON_WINDOW
+    m = MAGIC_RE.search(pending, start, window)
+    payload = None
+    if m is None and len(pending) > window:
+        text = pending[start:window].decode("utf-8", errors="surrogateescape")
+        try:
+            payload, end = decoder.raw_decode(text)
+            if end == len(text):
+                payload = None  # pode continuar depois da janela (um número, por exemplo)
+        except json.JSONDecodeError:
+            pass
+        if payload is None:
+            m = MAGIC_RE.search(pending, window)
+    if payload is None:
+        stop = m.start() if m else len(pending)
+        chunk = pending[start:stop]
+        text = chunk.decode("utf-8", errors="surrogateescape")
+        try:
+            payload, end = decoder.raw_decode(text)
+        except json.JSONDecodeError:
+            if m or len(chunk) > MAX_PENDING:
+                # texto inválido antes de um registro binário: descarta
+                raise RecordError(f"JSON inválido: {text[:200]!r}")
+            return None, start
+    used = len(text[:end].encode("utf-8", errors="surrogateescape"))
+    return payload, start + used
+
+class Reassembler:
+    """Buffer de recepção de uma conexão: junta os pedaços do stream TCP e
+    separa os registros completos.
+
+    O TCP junta vários registros num recv (a fila inteira depois de uma
+    queda) ou parte um registro entre vários; o que sobra incompleto espera
+    o próximo pedaço.
+    """
+
+    def __init__(self):
+        self.buf = bytearray()
+        self.decoder = json.JSONDecoder()
+
+    def __len__(self):
+        return len(self.buf)
+
+    def feed(self, data):
+        """Acrescenta `data` e retorna, em ordem, os registros completos
+        (dict, Frame ou outro valor JSON) e um RecordError por trecho
+        inválido descartado. Uma passada só pelo buffer por chamada.
+        """
+        buf = self.buf
+        buf += data
+        out = []
+        pos = 0
+        while True:
+            try:
+                payload, end = next_record(buf, self.decoder, pos)
+            except RecordError as e:
+                out.append(e)
+                # pula o registro, ou vai até o próximo binário/quadro
+                m = MAGIC_RE.search(buf, pos + 1)
+                pos = e.end if e.end is not None else (m.start() if m else len(buf))
+                continue
+            pos = end
+            if payload is None:
+                break
+            out.append(payload)
+        del buf[:pos]
+        return out
+
+def decode_data(body, decoder):
+    """Quadro DATA: retorna (seq, payload); payload None se o registro for inválido."""
+    if len(body) < SEQ.size:
+        raise RecordError(f"quadro DATA curto: {len(body)} bytes")
+    (seq,) = SEQ.unpack_from(body)
+    try:
+        payload, _ = next_record(body[SEQ.size:], decoder)
+    except RecordError:
+        payload = None
+    if not isinstance(payload, dict):
+        payload = None
+    return seq, payload
+
+def read_varint(body, pos):
+    """Varint LEB128 (7 bits por byte); retorna (valor, próxima posição)."""
+    value = shift = 0
+    while True:
+        if pos >= len(body) or shift > 63:
+            raise RecordError("varint truncado")
+        b = body[pos]
+        pos += 1
+        value |= (b & 0x7F) << shift
+        shift += 7
+        if not b & 0x80:
+            return value, pos
+
+class DeltaDecoder:
+    """Estado do codec delta de uma conexão: o último seq e os últimos valores."""
+
+    def __init__(self):
+        self.seq = None
+        self.prev = None
+
+    def decode(self, kind, body):
+        """Quadro KEY ou DELTA: retorna (seq, payload)."""
+        fields = SCHEMAS[STATION_SCHEMA]
+        if kind == FRAME_KEY:
+            if len(body) < SEQ.size:
+                raise RecordError(f"quadro KEY curto: {len(body)} bytes")
+            (seq,) = SEQ.unpack_from(body)
+            pos, prev = SEQ.size, [0] * len(fields)
+        elif self.prev is None:
+            raise RecordError("quadro DELTA sem quadro-chave antes")
+        else:
+            gap, pos = read_varint(body, 0)
+            seq, prev = self.seq + gap, self.prev
+
+        if pos >= len(body):
+            raise RecordError("registro comprimido sem flags")
+        flags = body[pos]
+        pos += 1
+        values = []
+        for ref in prev:
+            z, pos = read_varint(body, pos)
+            values.append(ref + ((z >> 1) ^ -(z & 1)))
+
+        self.seq, self.prev = seq, values
+        return seq, fixed_payload(fields, flags, values)
+
+def ack_frame(seq):
+    return FRAME_HEADER.pack(FRAME_MAGIC, FRAME_ACK, SEQ.size) + SEQ.pack(seq)
+
+class SeqState:
+    """Último seq gravado de cada estação, persistido junto com os dados.
+
+    Só o laço de ingestão lê e muda `last`; quem muda marca `dirty` e o
+    GroupWriter grava uma cópia depois dos dados do mesmo grupo.
+    """
+
+    def __init__(self, path):
+        self.path = path
+        self.dirty = False
+        try:
+            with open(path, encoding="utf-8") as f:
+                self.last = json.load(f)
+        except (OSError, ValueError):
+            self.last = {}
+
+    def snapshot(self):
+        """Cópia para gravar fora do laço (None se nada mudou)."""
+        if not self.dirty:
+            return None
+        self.dirty = False
+        return dict(self.last)
+
+    def save(self, last=None, sync=True):
+        # grava em outro arquivo e troca: uma queda não deixa o estado pela metade
+        tmp = self.path + ".tmp"
+        with open(tmp, "w", encoding="utf-8") as f:
+            json.dump(self.last if last is None else last, f)
+            f.flush()
+            if sync:
+                os.fsync(f.fileno())
+        os.replace(tmp, self.path)
+
+seq_state = SeqState(STATE_FILE)
+
+def encode_setting(name, value):
+    """Um ajuste por nome -> par do quadro CMD."""
+    if name in CONFIG_PARAMS:
+        return CMD_PAIR.pack(CONFIG_PARAMS[name], int(value))
+    for i, (field, _, scale) in enumerate(SCHEMAS[STATION_SCHEMA]):
+        if name == "deadband_" + field:
+            return CMD_PAIR.pack(DEADBAND_PARAM + i, round(float(value) * scale))
+    raise ValueError(f"parâmetro desconhecido: {name}")
+
+def decode_config(body):
+    """Pares de um CMD_ACK -> {nome: valor}."""
+    names = {v: k for k, v in CONFIG_PARAMS.items()}
+    fields = SCHEMAS[STATION_SCHEMA]
+    config = {}
+    for param, value in CMD_PAIR.iter_unpack(body[:len(body) - len(body) % CMD_PAIR.size]):
+        if param in names:
+            config[names[param]] = value
+        elif 0 <= param - DEADBAND_PARAM < len(fields):
+            field, _, scale = fields[param - DEADBAND_PARAM]
+            config["deadband_" + field] = value / scale
+    return config
+
+class Link:
+    """Conexão ativa de uma estação: envios e comandos aguardando resposta."""
+
+    def __init__(self, writer):
+        self.writer = writer
+        self.next_id = 0
+        self.waiting = {}  # id do comando -> Future da resposta
+
+    def send(self, data):
+        self.writer.write(data)
+
+    def reply(self, body):
+        """Quadro CMD_ACK: entrega a resposta a quem espera o comando."""
+        if len(body) < CMD_ACK.size:
+            return
+        cmd_id, result, bad = CMD_ACK.unpack_from(body)
+        reply = {"result": CMD_RESULTS.get(result, result), "config": decode_config(body[CMD_ACK.size:])}
+        if result:
+            reply["bad"] = bad
+        waiter = self.waiting.get(cmd_id)
+        if waiter and not waiter.done():
+            waiter.set_result(reply)
+
+links = {}  # estação -> Link da conexão atual
+ingest_loop = None  # laço das conexões (start_server)
+
+async def command(station, timeout=5.0, **settings):
+    """Ajusta uma estação conectada em tempo de execução; sem ajustes, só consulta.
+
+    Ex.: await command("E6605838830F5A2B", sample_period_ms=500, deadband_tp=0.25)
+    Retorna {"result", "config"[, "bad"]}; KeyError se a estação não estiver
+    conectada, TimeoutError se ela não responder.
+    """
+    body = b"".join(encode_setting(k, v) for k, v in settings.items())
+    link = links.get(station)
+    if link is None:
+        raise KeyError(f"estação {station} não conectada")
+    link.next_id = (link.next_id + 1) & 0xFFFF
+    cmd_id = link.next_id
+    waiter = asyncio.get_running_loop().create_future()
+    link.waiting[cmd_id] = waiter
+
+    payload = CMD_ID.pack(cmd_id) + body
     try:
+        link.send(FRAME_HEADER.pack(FRAME_MAGIC, FRAME_CMD, len(payload)) + payload)
+        return await asyncio.wait_for(waiter, timeout)
+    except asyncio.TimeoutError:
+        raise TimeoutError(f"estação {station} não respondeu ao comando {cmd_id}") from None
+    finally:
+        link.waiting.pop(cmd_id, None)
+
+def on_loop(coro):
+    """Roda `coro` no laço de ingestão a partir de outra thread e espera o resultado."""
+    return asyncio.run_coroutine_threadsafe(coro, ingest_loop).result()
+
+def send_command(station, timeout=5.0, **settings):
+    """`command` chamado de fora do laço (terminal, outras threads)."""
+    return on_loop(command(station, timeout, **settings))
+
+async def connected_stations():
+    return list(links)
+
+def kind(payload):
+    """Rótulo do registro no log: telemetria ou saúde da estação."""
+    return "SAÚDE" if "health" in payload else "DADOS"
+
+def stamp(payload, station, seq, rec=None):
+    """Marca o registro com a estação, o seq (e a posição no lote UDP) e a hora de chegada."""
+    if seq is not None:
+        meta = payload.setdefault("meta", {})
+        if isinstance(meta, dict):
+            meta["station"] = station
+            meta["seq"] = seq
+            if rec is not None:
+                meta["rec"] = rec
+    if "received_at" not in payload:
+        payload["received_at"] = datetime.now(timezone(timedelta(hours=-3))).isoformat(timespec='minutes')
+    return json.dumps(payload)
+
+COLUMN_FIELDS = [(name, scale, SENTINELS[t]) for name, t, scale in SCHEMAS[STATION_SCHEMA]]
+
+def column_row(station, seq, payload, ts=None):
+    """Linha do ColumnStore para um registro de telemetria (None para saúde e afins)."""
+    data = payload.get("data")
+    if not isinstance(data, dict):
+        return None
+    values = []
+    for name, scale, null in COLUMN_FIELDS:
+        v = data.get(name)
+        values.append(round(v * scale) if isinstance(v, (int, float)) and not isinstance(v, bool) else null)
+    return station, round((time.time() if ts is None else ts) * 1000), seq, values
+
+column_last = {}  # estação -> ts da última linha nas colunas (spread)
+
+def column_batch(station, rows):
+    """Linhas de um lote recebido agora, espalhadas desde o lote anterior da estação."""
+    rows = spread(rows, column_last.get(station))
+    if rows:
+        column_last[station] = rows[-1][1]
+    return rows
+
+class GroupWriter:
+    """Única etapa que grava OUTPUT_FILE (e o estado dos seqs).
+
+    As conexões entregam linhas com `submit` e esperam o futuro antes de
+    confirmar; a gravação roda numa thread própria, uma de cada vez, então
+    as linhas de um lote nunca se misturam com as de outro. Os dados vão
+    antes do estado: com fsync, depois de uma queda o estado nunca está à
+    frente do arquivo. Com `store` (ColumnStore), as linhas de telemetria
+    vão também para as colunas, depois do arquivo.
+    """
+
+    def __init__(self, path, state=None, policy=FSYNC_POLICY, batch_bytes=WRITE_BATCH_BYTES,
+                 batch_ms=WRITE_BATCH_MS, fsync_interval=FSYNC_INTERVAL, store=None):
+        if policy not in FSYNC_POLICIES:
+            raise ValueError(f"política de fsync desconhecida: {policy}")
+        self.path = path
+        self.state = state
+        self.policy = policy
+        self.batch_bytes = batch_bytes
+        self.batch_ms = batch_ms
+        self.fsync_interval = fsync_interval
+        self.store = store
+        self.stored_at = time.monotonic()
+        self.file = None
+        self.thread = ThreadPoolExecutor(max_workers=1, thread_name_prefix="writer")
+        self.wake = asyncio.Event()
+        self.lines = []
+        self.rows = []
+        self.size = 0
+        self.waiters = []
+        self.since = 0.0       # chegada do mais antigo do grupo aberto
+        self.unsynced = False  # gravado sem fsync ("interval")
+        self.synced_at = time.monotonic()
+        self.stats = {"groups": 0, "lines": 0, "bytes": 0, "fsyncs": 0}
+
+    def submit(self, lines, rows=()):
+        """Enfileira as linhas (e as linhas de coluna, ver column_row); o futuro
+        conclui quando elas estão gravadas segundo a política (e com elas o
+        estado marcado até aqui)."""
+        waiter = asyncio.get_running_loop().create_future()
+        if not self.waiters:
+            self.since = time.monotonic()
+        self.waiters.append(waiter)
+        for line in lines:
+            self.lines.append(line)
+            self.size += len(line) + 1
+        self.rows.extend(rows)
+        self.wake.set()
+        return waiter
+
+    async def run(self):
+        loop = asyncio.get_running_loop()
         while True:
+            # espera trabalho; com gravações sem fsync, no máximo até o prazo dele
+            timeout = None
+            if self.unsynced and self.policy == "interval":
+                timeout = max(0.0, self.synced_at + self.fsync_interval - time.monotonic())
             try:
-                data = conn.recv(BUFFER_SIZE)
-                if not data:
-                    print(f"[DESCONECTADO] Conexão encerrada de forma limpa por {addr}")
+                await asyncio.wait_for(self.wake.wait(), timeout)
+            except asyncio.TimeoutError:
+                pass
+            self.wake.clear()
+
+            # grupo aberto: junta até o tamanho ou o prazo do mais antigo
+            while self.waiters and self.size < self.batch_bytes:
+                remaining = self.since + self.batch_ms / 1000 - time.monotonic()
+                if remaining <= 0:
+                    break
+                try:
+                    await asyncio.wait_for(self.wake.wait(), remaining)
+                except asyncio.TimeoutError:
                     break
+                self.wake.clear()
 
-                raw_message = data.decode("utf-8")
+            lines, rows, waiters = self.lines, self.rows, self.waiters
+            self.lines, self.rows, self.waiters, self.size = [], [], [], 0
+            state = self.state.snapshot() if self.state else None
+            sync = self.policy == "group" or (self.policy == "interval" and
+                                              time.monotonic() - self.synced_at >= self.fsync_interval)
+            if not waiters and not (sync and self.unsynced):
+                continue
+            try:
+                await loop.run_in_executor(self.thread, self.flush, lines, state, sync, rows)
+            except Exception as e:
+                # ninguém é confirmado; quem esperava desfaz o avanço do seq
+                # (rollback_on_failure) e a estação reenvia
+                print(f"[ERRO GRAVAÇÃO] {self.path}: {e}")
+                if state is not None:
+                    self.state.dirty = True
+                for w in waiters:
+                    if not w.done():
+                        w.set_exception(e)
+                continue
+            for w in waiters:
+                if not w.done():
+                    w.set_result(None)
 
-                try:
-                    payload = json.loads(raw_message)
+    def flush(self, lines, state, sync, rows=()):
+        """Thread de gravação: um write para o grupo, fsync conforme a política."""
+        if self.file is None:
+            self.file = open(self.path, "a", encoding="utf-8")
+        if lines:
+            data = "".join(line + "\n" for line in lines)
+            self.file.write(data)
+            self.file.flush()
+            self.stats["groups"] += 1
+            self.stats["lines"] += len(lines)
+            self.stats["bytes"] += len(data)
+            self.unsynced = True
+        if sync and self.unsynced:
+            os.fsync(self.file.fileno())
+            self.stats["fsyncs"] += 1
+            self.unsynced = False
+            self.synced_at = time.monotonic()
+        if state is not None:
+            self.state.save(state, sync=sync)
+        if self.store is not None:
+            # as colunas são derivadas: um erro nelas não desfaz a confirmação
+            # (o import_data.py refaz a partir do data.txt)
+            try:
+                for row in rows:
+                    self.store.append(*row)
+                if time.monotonic() - self.stored_at >= COLUMN_FLUSH_S:
+                    self.store.flush()
+                    self.stored_at = time.monotonic()
+            except Exception as e:
+                print(f"[ERRO COLUNAS] {self.store.root}: {e}")
+                self.store.open.clear()  # reabre (e repara) as partições na próxima linha
+
+    def close(self):
+        """Na saída: grava os blocos pendentes das colunas e fecha o arquivo."""
+        def close():
+            if self.store is not None:
+                self.store.flush()
+            if self.file is not None:
+                self.file.close()
+                self.file = None
+        self.thread.submit(close).result()
+
+data_writer = None  # GroupWriter de OUTPUT_FILE (serve)
+
+def rollback_on_failure(written, key, last, prev, restore=None):
+    """Se a gravação falhar, o último seq de `key` volta de `last` para `prev`.
+
+    O seq avança antes da gravação (os lotes seguintes já descartam os
+    repetidos), mas sem gravar não há ACK: a estação reenvia, e o reenvio
+    não pode cair no [REPETIDO]. Se outro lote avançou depois, fica como está.
+    """
+    def done(f):
+        if not f.cancelled() and f.exception() is None:
+            return
+        if seq_state.last.get(key, 0) != last:
+            return
+        if prev:
+            seq_state.last[key] = prev
+        else:
+            seq_state.last.pop(key, None)
+        seq_state.dirty = True
+        if restore:
+            restore()
+    written.add_done_callback(done)
+
+def commit(station, records, addr):
+    """Grava os registros em ordem, sem repetidos.
+
+    Retorna (último seq, futuro da gravação): o ACK só sai depois do futuro.
+
+    `records` é uma lista de (seq, payload); seq None para registros fora de
+    quadro e payload None para registros inválidos (o seq conta mesmo assim,
+    para a estação não reenviá-los para sempre).
+    """
+    lines = []
+    rows = []
+    prev = last = seq_state.last.get(station, 0)
+    for seq, payload in records:
+        if seq is not None:
+            if seq <= last:
+                print(f"[REPETIDO] {station} seq {seq:#x} (último {last:#x})")
+                continue
+            # seq = época do boot (32 bits altos) + contador a partir de 1
+            expected = last + 1 if seq >> 32 == last >> 32 else (seq >> 32 << 32) | 1
+            if seq != expected:
+                print(f"[LACUNA] {station}: esperado {expected:#x}, recebido {seq:#x}")
+            last = seq
+        if payload is None:
+            continue
+
+        lines.append(stamp(payload, station, seq))
+        row = column_row(station, seq, payload)
+        if row:
+            rows.append(row)
+        if VERBOSE:
+            print(f"[{kind(payload)}] {addr}: {payload}")
 
-                    if "received_at" not in payload:
-                        payload["received_at"] = datetime.now(timezone(timedelta(hours=-3))).isoformat(timespec='minutes')
+    written = data_writer.submit(lines, column_batch(station, rows))
+    if last != prev:
+        seq_state.last[station] = last
+        seq_state.dirty = True
+        rollback_on_failure(written, station, last, prev)
+    return last, written
 
-                    with open(OUTPUT_FILE, "a", encoding="utf-8") as f:
-                        f.write(json.dumps(payload) + "\n")
+active = 0  # conexões TCP abertas
 
-                    print(f"[DADOS] {addr}: {payload}")
+async def handle_client(reader, writer):
+    """Uma conexão de estação, como tarefa do laço de ingestão."""
+    global active
+    addr = writer.get_extra_info("peername")
+    if active >= MAX_CONNECTIONS:
+        print(f"[RECUSADA] {addr}: {active} conexões abertas")
+        writer.close()
+        return
+    active += 1
+    print(f"\n[NOVA CONEXÃO] {addr}")
+
+    # Configura o Keep-Alive no socket da conexão específica
+    # Isso detecta se o cliente caiu sem fechar a conexão
+    writer.get_extra_info("socket").setsockopt(socket.SOL_SOCKET, socket.SO_KEEPALIVE, 1)
+
+    stream = Reassembler()  # bytes recebidos que ainda não formam um registro completo
+    station = addr[0]  # até o HELLO, a estação é o endereço
+    framed = False     # o cliente fala o protocolo de quadros: responde com ACK
+    link = Link(writer)  # envios (ACK e comandos) e respostas aos comandos
+    delta = DeltaDecoder()  # referência dos quadros DELTA, só nesta conexão
+    broken = False
 
-                except json.JSONDecodeError:
-                    print(f"[ERRO JSON] Dados inválidos de {addr}: {raw_message}")
-        
-            except socket.timeout:
-                continue # O timeout de leitura não fecha a conexão, apenas permite o loop rodar
+    try:
+        while True:
+            try:
+                data = await asyncio.wait_for(reader.read(BUFFER_SIZE), IDLE_TIMEOUT)
+            except asyncio.TimeoutError:
+                print(f"[OCIOSA] {addr}: nada em {IDLE_TIMEOUT} s, encerrando")
+                break
             except ConnectionResetError:
                 print(f"[ERRO] Conexão forçada a fechar (Raspberry caiu) em {addr}")
                 break
+            if not data:
+                print(f"[DESCONECTADO] Conexão encerrada de forma limpa por {addr}")
+                break
+
+            # a Pico descarrega a fila inteira de uma vez após uma queda:
+            # um recv pode trazer vários registros (JSON ou binários), ou
+            # só parte de um
+            items = stream.feed(data)
+            if len(stream) > MAX_BUFFER:
+                print(f"[ERRO] {addr}: {len(stream)} bytes sem formar registro, encerrando")
+                break
+            records = []
+            before = []  # gravações do que veio antes de um HELLO
+
+            for payload in items:
+                if isinstance(payload, RecordError):
+                    print(f"[ERRO JSON] Dados inválidos de {addr}: {payload}")
+                    continue
+
+                if isinstance(payload, Frame):
+                    framed = True
+                    if payload.kind == FRAME_HELLO and len(payload.body) >= 1:
+                        # grava o que veio antes com a identidade anterior
+                        before.append(commit(station, records, addr)[1])
+                        records = []
+                        station = payload.body[1:].decode("utf-8", errors="replace")
+                        print(f"[HELLO] {addr}: estação {station}")
+                        links[station] = link
+                        if payload.body[0] & HELLO_RESET:
+                            seq_state.last.pop(station, None)
+                            seq_state.dirty = True
+                    elif payload.kind == FRAME_DATA:
+                        try:
+                            records.append(decode_data(payload.body, stream.decoder))
+                        except RecordError as e:
+                            print(f"[ERRO JSON] Dados inválidos de {addr}: {e}")
+                    elif payload.kind == FRAME_CMD_ACK:
+                        link.reply(payload.body)
+                    elif payload.kind in (FRAME_KEY, FRAME_DELTA):
+                        try:
+                            records.append(delta.decode(payload.kind, payload.body))
+                        except RecordError as e:
+                            # sem a referência, nenhum DELTA seguinte decodifica: ao
+                            # reconectar a estação recomeça com um quadro-chave
+                            print(f"[ERRO DELTA] {addr}: {e}; encerrando a conexão")
+                            broken = True
+                            break
+                    continue
+
+                if not isinstance(payload, dict):
+                    print(f"[ERRO JSON] Dados inválidos de {addr}: {payload!r}")
+                    continue
+                records.append((None, payload))
+
+            # grava o lote e só então confirma: o ACK cobre tudo até `last`
+            last, written = commit(station, records, addr)
+            await asyncio.gather(*before, written)
+            if framed:
+                link.send(ack_frame(last))
+                # estação que não lê os ACKs: espera o buffer de envio esvaziar
+                await writer.drain()
+            if broken:
+                break
     except Exception as e:
         print(f"[ERRO DESCONHECIDO] {addr}: {e}")
     finally:
-        conn.close()
+        active -= 1
+        if links.get(station) is link:
+            del links[station]
+        writer.close()
         print(f"[ENCERRADO] Socket fechado para {addr}")
 
-def start_server():
-    server_sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
-    # SO_REUSEADDR permite reiniciar o server imediatamente sem erro de "Porta em uso"
-    server_sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
-    server_sock.bind((TCP_IP, TCP_PORT))
-    server_sock.listen(5)
+# datagramas recebidos além da base, por estação (só na memória: depois de
+# um restart do servidor a estação reenvia o que não foi confirmado)
+udp_seen = {}
 
-    print(f"\nServidor TCP escutando em {TCP_IP}:{TCP_PORT}")
-    print("Aguardando conexões...")
+async def handle_datagram(transport, data, addr, decoder):
+    """Grava um lote UDP (uma vez só) e responde com o NACK."""
+    try:
+        frame, _ = next_record(data, decoder)
+    except RecordError as e:
+        print(f"[ERRO UDP] Datagrama inválido de {addr}: {e}")
+        return
+    if not isinstance(frame, Frame) or frame.kind != FRAME_UDP_BATCH or len(frame.body) < UDP_BATCH.size:
+        print(f"[ERRO UDP] Datagrama inválido de {addr}: {data[:32]!r}")
+        return
 
-    while True:
+    seq, flags, id_len = UDP_BATCH.unpack_from(frame.body)
+    pos = UDP_BATCH.size + id_len
+    station = frame.body[UDP_BATCH.size:pos].decode("utf-8", errors="replace")
+    key = station + "/udp"  # numeração própria, separada da do TCP
+    prev = seq_state.last.get(key, 0)
+
+    if flags & HELLO_RESET and seq == 1 and seq_state.last.get(key, 0) >> 32 == 0:
+        # sem log na estação: a numeração recomeçou neste boot
+        seq_state.last.pop(key, None)
+        seq_state.dirty = True
+        udp_seen.pop(key, None)
+    base = seq_state.last.get(key, 0)
+    seen = udp_seen.setdefault(key, set())
+
+    if seq >> 32 != base >> 32 and seq > base:
+        # boot novo: o que faltava da época anterior se perdeu na RAM
+        lost = sorted(seen)
+        if lost or base & 0xFFFFFFFF:
+            print(f"[LACUNA] {station}: época {base >> 32} encerrada em {base:#x} (fora de ordem: {len(lost)})")
+        base = seq >> 32 << 32
+        seen.clear()
+
+    lines = []
+    rows = []
+    fresh = not (seq <= base or seq in seen)
+    if not fresh:
+        print(f"[REPETIDO] {station} datagrama {seq:#x} (base {base:#x})")
+    else:
+        index = 0
+        while pos + 2 <= len(frame.body):
+            size = frame.body[pos] | frame.body[pos + 1] << 8
+            record = frame.body[pos + 2:pos + 2 + size]
+            pos += 2 + size
+            try:
+                payload, _ = next_record(record, decoder)
+            except RecordError as e:
+                print(f"[ERRO UDP] Registro inválido de {station}: {e}")
+                continue
+            if not isinstance(payload, dict):
+                continue
+            lines.append(stamp(payload, station, seq, index))
+            row = column_row(station, seq, payload)
+            if row:
+                rows.append(row)
+            index += 1
+            if VERBOSE:
+                print(f"[{kind(payload)}] {addr}: {payload}")
+
+        seen.add(seq)
+        while base + 1 in seen:
+            base += 1
+            seen.discard(base)
+    if base != seq_state.last.get(key, 0):
+        seq_state.last[key] = base
+        seq_state.dirty = True
+
+    top = max(seen, default=base)
+    n = min(top - base, UDP_NACK_BITS)
+    missing = sum(1 << i for i in range(n) if base + 1 + i not in seen)
+
+    # o NACK confirma o lote: só depois de gravado
+    written = data_writer.submit(lines, column_batch(station, rows))
+    if fresh:
+        def restore():
+            # o datagrama volta a faltar; os que a base tinha engolido, não
+            seen = udp_seen.setdefault(key, set())
+            seen.update(range(max(prev, base >> 32 << 32) + 1, base + 1))
+            seen.discard(seq)
+        rollback_on_failure(written, key, base, prev, restore)
+    await written
+    nack = FRAME_HEADER.pack(FRAME_MAGIC, FRAME_UDP_NACK, UDP_NACK.size) + UDP_NACK.pack(base, n, missing)
+    transport.sendto(nack, addr)
+
+class UdpIngest(asyncio.DatagramProtocol):
+    """Lotes UDP: sem conexão, cada datagrama é tratado sozinho."""
+
+    def connection_made(self, transport):
+        self.transport = transport
+        self.decoder = json.JSONDecoder()
+
+    def datagram_received(self, data, addr):
+        asyncio.ensure_future(self.handle(data, addr))
+
+    async def handle(self, data, addr):
         try:
-            conn, addr = server_sock.accept()
-            # Cria uma thread para cada cliente. 
-            # Assim, se a Rasp antiga "travar", uma nova thread atenderá a Rasp nova.
-            thread = threading.Thread(target=handle_client, args=(conn, addr))
-            thread.daemon = True # Thread morre se o programa principal fechar
-            thread.start()
+            await handle_datagram(self.transport, data, addr, self.decoder)
         except Exception as e:
-            print(f"Erro ao aceitar conexão: {e}")
+            print(f"[ERRO UDP] {e}")
+
+# ===============================
+# CONSULTA (colstore.py)
+# ===============================
+# Lê as colunas gravadas, sem passar pelo data.txt. O dia corrente aparece
+# com até COLUMN_FLUSH_S de atraso (blocos ainda na memória do GroupWriter)
+column_reader = ColumnStore(COLUMN_DIR, COLUMN_FIELDS)
+INTERVAL_UNITS = {"s": 1, "m": 60, "h": 3600, "d": 86400}
+
+def epoch_ms(t):
+    """datetime (sem fuso = fuso das estações) -> ms desde 1970; None = agora."""
+    if t is None:
+        return round(time.time() * 1000)
+    return round((t if t.tzinfo else t.replace(tzinfo=column_reader.tz)).timestamp() * 1000)
+
+def query(stations, fields, since, until=None, interval=None, aggregates=AGGREGATES):
+    """Agregados por intervalo e estação: {estação: [(início, {campo: {agregado: valor}})]}.
+
+    `stations` é uma estação, uma lista ou "*" (todas); `since`/`until` são
+    datetime (sem fuso = fuso das estações; `until` padrão agora) e
+    `interval` um timedelta (None = o período inteiro). "integral" é o
+    campo vezes horas: para p, a energia em Wh. Início em ms desde 1970.
+    """
+    t0, t1 = epoch_ms(since), epoch_ms(until)
+    interval_ms = round(interval.total_seconds() * 1000) if interval else None
+    if stations == "*":
+        stations = column_reader.stations()
+    elif isinstance(stations, str):
+        stations = [stations]
+    return {s: column_reader.aggregate(s, fields, t0, t1, interval_ms, aggregates) for s in stations}
+
+def select(station, fields, since, until=None):
+    """Linhas (ts ms, [valores]) de uma estação, só com os campos pedidos."""
+    return list(column_reader.select(station, fields, epoch_ms(since), epoch_ms(until)))
+
+def console_query(args):
+    """query <estação|*> <campo,...> <agregado,...> <intervalo|tudo> <desde> [até]"""
+    station, fields, aggregates, interval, since = args[:5]
+    if interval == "tudo":
+        interval = None
+    elif interval[-1:] in INTERVAL_UNITS and interval[:-1].isdigit():
+        interval = timedelta(seconds=int(interval[:-1]) * INTERVAL_UNITS[interval[-1]])
+    else:
+        raise ValueError(f"intervalo inválido: {interval} (ex.: 15m, 1h, 1d, tudo)")
+    until = datetime.fromisoformat(args[5]) if len(args) > 5 else None
+    t0 = time.perf_counter()
+    result = query(station, fields.split(","), datetime.fromisoformat(since), until, interval, aggregates.split(","))
+    elapsed = time.perf_counter() - t0
+    for name, rows in result.items():
+        for start, row in rows:
+            when = datetime.fromtimestamp(start / 1000, column_reader.tz).strftime("%Y-%m-%d %H:%M:%S")
+            values = "  ".join(f"{f}: " + " ".join(f"{a}={v:.6g}" if v is not None else f"{a}=-"
+                                                    for a, v in row[f].items()) for f in row)
+            print(f"[CONSULTA] {name} {when}  {values}")
+    print(f"[CONSULTA] {len(result)} estações, {sum(map(len, result.values()))} intervalos em {elapsed * 1000:.0f} ms")
+
+def console():
+    """Comandos pelo terminal do servidor:
+
+        list                               estações conectadas
+        get <estação>                      configuração atual
+        set <estação> nome=valor ...       ex.: set E6605838830F5A2B sample_period_ms=500
+        query <estação|*> <campo,...> <agregado,...> <intervalo|tudo> <desde> [até]
+                                           agregados das colunas gravadas, ex.: energia diária no último ano
+                                           query * p integral 1d 2025-10-17
+    """
+    for line in sys.stdin:
+        parts = line.split()
+        if not parts:
+            continue
+        try:
+            if parts[0] == "list":
+                print(f"[ESTAÇÕES] {', '.join(on_loop(connected_stations())) or 'nenhuma'}")
+            elif parts[0] in ("get", "set") and len(parts) >= 2:
+                settings = dict(p.split("=", 1) for p in parts[2:]) if parts[0] == "set" else {}
+                print(f"[COMANDO] {parts[1]}: {send_command(parts[1], **settings)}")
+            elif parts[0] == "query" and len(parts) >= 6:
+                console_query(parts[1:])
+            else:
+                print(console.__doc__)
+        except (KeyError, ValueError, TimeoutError, OSError) as e:
+            print(f"[ERRO COMANDO] {e}")
+
+async def serve(fsync_policy=FSYNC_POLICY):
+    global ingest_loop, data_writer
+    ingest_loop = asyncio.get_running_loop()
+    data_writer = GroupWriter(OUTPUT_FILE, seq_state, policy=fsync_policy,
+                              store=ColumnStore(COLUMN_DIR, COLUMN_FIELDS))
+    writer_task = asyncio.create_task(data_writer.run())
+    print(f"Gravação em grupo: fsync {fsync_policy}")
+
+    # SO_REUSEADDR permite reiniciar o server imediatamente sem erro de "Porta em uso"
+    server = await asyncio.start_server(handle_client, TCP_IP, TCP_PORT,
+                                        reuse_address=True, backlog=LISTEN_BACKLOG)
+    print(f"\nServidor TCP escutando em {TCP_IP}:{TCP_PORT}")
+
+    udp_sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    udp_sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    udp_sock.bind((TCP_IP, TCP_PORT))
+    await ingest_loop.create_datagram_endpoint(UdpIngest, sock=udp_sock)
+    print(f"Servidor UDP escutando em {TCP_IP}:{TCP_PORT}")
+
+    threading.Thread(target=column_reader.warm, daemon=True).start()
+    threading.Thread(target=console, daemon=True).start()
+    print("Aguardando conexões...")
+    try:
+        async with server:
+            await server.serve_forever()
+    finally:
+        writer_task.cancel()
+        data_writer.close()
+
+def start_server():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--fsync", choices=FSYNC_POLICIES, default=FSYNC_POLICY,
+                        help="o que o ACK garante (ver FSYNC_POLICY)")
+    parser.add_argument("--verbose", action="store_true", help="mostra cada registro recebido")
+    args = parser.parse_args()
+    global VERBOSE
+    VERBOSE = VERBOSE or args.verbose
+    try:
+        asyncio.run(serve(args.fsync))
+    except KeyboardInterrupt:
+        pass
 
 if __name__ == "__main__":
-    start_server()
\ No newline at end of file
+    start_server()
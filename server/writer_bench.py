@@ -0,0 +1,97 @@
+import argparse
+import asyncio
+import os
+import sys
+import tempfile
+import time
+
+from server import GroupWriter, SeqState, FSYNC_POLICIES
+
+# ===============================
+# BANCADA DA GRAVAÇÃO (server.GroupWriter)
+# ===============================
+# Várias estações entregam lotes ao mesmo tempo e esperam a confirmação,
+# como handle_client faz antes do ACK. Compara a gravação antiga (abre,
+# grava, fsync e fecha o arquivo a cada lote) com o GroupWriter em cada
+# política de fsync: registros/s, grupos, fsyncs e a espera até o ACK
+# (mediana e p99). Sai com erro se faltar ou sobrar linha no arquivo.
+#
+#   python3 writer_bench.py                        # 200 estações, 20 lotes de 10
+#   python3 writer_bench.py --stations 2000 --batches 5 --dir /mnt/sd
+
+LINE = '{"meta": {"pend": false, "station": "%s", "seq": %d}, "data": {"lux1": 512.5, "tp": 24.81}}'
+
+def per_batch(path, lines):
+    """Gravação antiga: um open/write/fsync/close por lote."""
+    with open(path, "a", encoding="utf-8") as f:
+        f.write("".join(line + "\n" for line in lines))
+        f.flush()
+        os.fsync(f.fileno())
+
+async def station(i, batches, size, submit, latencies):
+    seq = 0
+    for _ in range(batches):
+        lines = [LINE % (f"ST{i:05d}", seq + k) for k in range(size)]
+        seq += size
+        t0 = time.perf_counter()
+        await submit(lines)
+        latencies.append(time.perf_counter() - t0)
+        await asyncio.sleep(0)  # próximo recv
+
+async def run(path, policy, args):
+    latencies = []
+    state = SeqState(path + ".state")
+    if policy == "antigo":
+        loop = asyncio.get_running_loop()
+        async def submit(lines):
+            # thread à parte, como uma thread por conexão; uma gravação por vez no arquivo
+            await loop.run_in_executor(None, per_batch, path, lines)
+        writer = None
+    else:
+        writer = GroupWriter(path, state, policy=policy)
+        task = asyncio.create_task(writer.run())
+        def submit(lines):
+            state.last["bench"] = len(latencies)
+            state.dirty = True
+            return writer.submit(lines)
+
+    t0 = time.perf_counter()
+    await asyncio.gather(*(station(i, args.batches, args.size, submit, latencies)
+                           for i in range(args.stations)))
+    elapsed = time.perf_counter() - t0
+    if writer:
+        task.cancel()
+        writer.file.close()
+    return elapsed, latencies, writer.stats if writer else None
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--stations", type=int, default=200)
+    parser.add_argument("--batches", type=int, default=20, help="lotes por estação")
+    parser.add_argument("--size", type=int, default=10, help="registros por lote")
+    parser.add_argument("--dir", default=None, help="onde gravar (padrão: diretório temporário)")
+    args = parser.parse_args()
+
+    total = args.stations * args.batches * args.size
+    print(f"{args.stations} estações x {args.batches} lotes x {args.size} registros = {total} registros")
+    ok = True
+    with tempfile.TemporaryDirectory(dir=args.dir) as tmp:
+        for policy in ("antigo",) + FSYNC_POLICIES:
+            path = os.path.join(tmp, f"data_{policy}.txt")
+            elapsed, latencies, stats = asyncio.run(run(path, policy, args))
+            with open(path, encoding="utf-8") as f:
+                written = sum(1 for _ in f)
+            latencies.sort()
+            p50 = latencies[len(latencies) // 2] * 1000
+            p99 = latencies[int(len(latencies) * 0.99)] * 1000
+            groups = stats["groups"] if stats else len(latencies)
+            fsyncs = stats["fsyncs"] if stats else len(latencies)
+            print(f"  {policy:<9} {total / elapsed:>9.0f} registros/s  {groups:>6} grupos  {fsyncs:>6} fsyncs  "
+                  f"ACK em {p50:6.2f} ms (p99 {p99:6.2f} ms)")
+            if written != total:
+                print(f"  {policy}: {written} linhas no arquivo, esperadas {total}")
+                ok = False
+    sys.exit(0 if ok else 1)
+
+if __name__ == "__main__":
+    main()
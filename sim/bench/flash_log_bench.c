@@ -0,0 +1,226 @@
+#define _GNU_SOURCE   // memmem
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "hardware/flash.h"
+
+#include "sim.h"
+#include "drivers/storage/flash_log.h"
+
+// Bancada do log na flash (drivers/storage/flash_log) sobre o emulador de
+// flash da simulação, sem subir o escalonador:
+//   - gravação de registros de 48 e 230 bytes (telemetria compacta e JSON)
+//   - entrega com next/advance/ack e marcação na flash (sync)
+//   - recuperação no boot com o log cheio
+//   - gravação interrompida no meio de um registro
+//
+// Usa flash_log_bench.bin e não espera pelos tempos da flash (o custo
+// emulado aparece nas colunas "flash"); SIM_FLASH_FILE e SIM_FLASH_TIMING
+// mudam isso.
+
+#define BENCH_RECORDS   2000
+
+static int failures;
+
+#define CHECK(cond, ...) do {                       \
+        if (!(cond)) {                              \
+            printf("  FALHOU: " __VA_ARGS__);       \
+            printf("\n");                           \
+            failures++;                             \
+        }                                           \
+    } while (0)
+
+// o kernel é linkado pelo sim_flash, mas não roda aqui
+void vApplicationIdleHook(void) {}
+void vApplicationDaemonTaskStartupHook(void) {}
+
+__attribute__((constructor(101)))
+static void bench_env(void) {
+    setenv("SIM_FLASH_FILE", "flash_log_bench.bin", 0);
+    setenv("SIM_FLASH_TIMING", "0", 0);
+}
+
+static void log_wipe(void) {
+    flash_range_erase(FLASH_LOG_OFFSET, FLASH_LOG_SIZE);
+}
+
+// payload com número de sequência no início, completado até `len`
+static uint16_t make_record(uint8_t *buf, uint32_t seq, uint16_t len) {
+    int n = snprintf((char *) buf, len + 1, "{\"seq\":%lu,\"pad\":\"", (unsigned long) seq);
+    for (int i = n; i < len; i++) buf[i] = 'a' + (i % 26);
+    buf[len - 2] = '"';
+    buf[len - 1] = '}';
+    return len;
+}
+
+static uint32_t record_seq(const uint8_t *rec) {
+    return (uint32_t) strtoul((const char *) rec + 7, NULL, 10);
+}
+
+typedef struct {
+    uint64_t host_us;
+    uint64_t flash_us;
+    uint32_t programs;
+    uint32_t erases;
+} bench_mark_t;
+
+static bench_mark_t mark(void) {
+    return (bench_mark_t) { sim_now_us(), sim_stats.flash_busy_us, sim_stats.flash_programs, sim_stats.flash_erases };
+}
+
+static void report(const char *what, uint32_t n, uint32_t bytes, bench_mark_t a, bench_mark_t b) {
+    double host_s = (b.host_us - a.host_us) / 1e6;
+    printf("  %-22s %6lu reg  %8.0f reg/s  %6.2f MB/s (host)  %5.2f pág/reg  %6.4f apag/reg  flash %7.1f ms (%.2f ms/reg)\n",
+           what, (unsigned long) n, n / host_s, bytes / host_s / 1e6,
+           (double) (b.programs - a.programs) / n, (double) (b.erases - a.erases) / n,
+           (b.flash_us - a.flash_us) / 1e3, (b.flash_us - a.flash_us) / 1e3 / n);
+}
+
+// grava e entrega BENCH_RECORDS registros de `len` bytes
+static void bench_append_deliver(uint16_t len) {
+    uint8_t buf[FLASH_LOG_RECORD_MAX];
+
+    printf("\nregistros de %u bytes\n", len);
+    log_wipe();
+    CHECK(flash_log_init(), "init");
+
+    bench_mark_t a = mark();
+    for (uint32_t i = 0; i < BENCH_RECORDS; i++) {
+        CHECK(flash_log_append(buf, make_record(buf, i, len)), "append %lu", (unsigned long) i);
+    }
+    bench_mark_t b = mark();
+    report("append", BENCH_RECORDS, BENCH_RECORDS * len, a, b);
+    CHECK(flash_log_stats()->entries == BENCH_RECORDS, "entries %lu", (unsigned long) flash_log_stats()->entries);
+
+    // entrega metade em lotes de 32, como uma janela do TCP
+    uint32_t expect = 0;
+    a = mark();
+    while (expect < BENCH_RECORDS / 2) {
+        uint32_t inflight = 0;
+        const uint8_t *rec;
+        uint16_t n;
+        for (int k = 0; k < 32 && (rec = flash_log_next(&n)) != NULL; k++) {
+            CHECK(record_seq(rec) == expect, "ordem: %lu != %lu", (unsigned long) record_seq(rec), (unsigned long) expect);
+            expect++;
+            inflight += n;
+            flash_log_advance();
+        }
+        CHECK(flash_log_ack(inflight) == inflight, "ack");
+        flash_log_sync();
+    }
+    while (!flash_log_sync());
+    b = mark();
+    report("entrega + sync", expect, expect * len, a, b);
+
+    // reboot: só o que não foi confirmado volta
+    CHECK(flash_log_init(), "reinit");
+    CHECK(flash_log_stats()->entries == BENCH_RECORDS - expect, "após reboot: %lu pendentes",
+          (unsigned long) flash_log_stats()->entries);
+    const uint8_t *rec;
+    uint16_t n;
+    rec = flash_log_next(&n);
+    CHECK(rec && record_seq(rec) == expect, "retoma em %lu", (unsigned long) expect);
+}
+
+// log cheio: o setor mais antigo é reaproveitado e o boot varre tudo
+static void bench_full_recovery(void) {
+    uint8_t buf[FLASH_LOG_RECORD_MAX];
+
+    printf("\nlog cheio (230 bytes, %u KB)\n", FLASH_LOG_SIZE / 1024);
+    log_wipe();
+    CHECK(flash_log_init(), "init");
+
+    uint32_t i = 0;
+    bench_mark_t a = mark();
+    while (flash_log_stats()->dropped == 0) {
+        flash_log_append(buf, make_record(buf, i++, 230));
+    }
+    // mais meia volta, para a cabeça ficar no meio da região
+    uint32_t wrap = i;
+    while (i < wrap * 3 / 2) {
+        flash_log_append(buf, make_record(buf, i++, 230));
+    }
+    bench_mark_t b = mark();
+    report("append (com descarte)", i, i * 230, a, b);
+
+    uint32_t entries = flash_log_stats()->entries;
+    uint32_t dropped = flash_log_stats()->dropped;
+    CHECK(entries + dropped == i, "entries %lu + dropped %lu != %lu",
+          (unsigned long) entries, (unsigned long) dropped, (unsigned long) i);
+
+    CHECK(flash_log_init(), "reinit");
+    printf("  recuperação: %lu registros em %lu us (host)\n",
+           (unsigned long) flash_log_stats()->entries, (unsigned long) flash_log_stats()->scan_us);
+    CHECK(flash_log_stats()->entries == entries, "recuperou %lu de %lu",
+          (unsigned long) flash_log_stats()->entries, (unsigned long) entries);
+
+    uint16_t n;
+    const uint8_t *rec = flash_log_next(&n);
+    CHECK(rec && record_seq(rec) == dropped, "mais antigo %lu, esperado %lu",
+          (unsigned long) (rec ? record_seq(rec) : 0), (unsigned long) dropped);
+}
+
+// queda de energia no meio de uma gravação: o registro some, o resto fica
+static void bench_torn_write(void) {
+    uint8_t buf[FLASH_LOG_RECORD_MAX];
+
+    printf("\ngravação interrompida\n");
+    log_wipe();
+    CHECK(flash_log_init(), "init");
+
+    for (uint32_t i = 0; i < 10; i++) {
+        flash_log_append(buf, make_record(buf, i, 48));
+    }
+
+    // corrompe o fim do último registro, como uma página que não terminou
+    uint16_t len = make_record(buf, 9, 48);
+    const uint8_t *region = (const uint8_t *) (XIP_BASE + FLASH_LOG_OFFSET);
+    const uint8_t *last = memmem(region, FLASH_SECTOR_SIZE, buf, len);
+    CHECK(last != NULL, "último registro não encontrado");
+    if (!last) return;
+
+    uint32_t off = FLASH_LOG_OFFSET + (uint32_t) (last - region) + len - 1;
+    static uint8_t page[FLASH_PAGE_SIZE];
+    memset(page, 0xFF, sizeof(page));
+    page[off % FLASH_PAGE_SIZE] = 0x00;
+    flash_range_program(off & ~(FLASH_PAGE_SIZE - 1), page, FLASH_PAGE_SIZE);
+
+    CHECK(flash_log_init(), "reinit");
+    const flash_log_stats_t *st = flash_log_stats();
+    printf("  após reboot: %lu registros, %lu interrompidos\n", (unsigned long) st->entries, (unsigned long) st->torn);
+    CHECK(st->entries == 9 && st->torn == 1, "esperado 9 registros e 1 interrompido");
+
+    // gravações seguintes continuam no próximo setor
+    for (uint32_t i = 10; i < 15; i++) {
+        flash_log_append(buf, make_record(buf, i, 48));
+    }
+    CHECK(flash_log_init(), "reinit 2");
+    CHECK(flash_log_stats()->entries == 14, "esperado 14, recuperou %lu", (unsigned long) flash_log_stats()->entries);
+
+    uint32_t expect = 0;
+    const uint8_t *rec;
+    while ((rec = flash_log_next(&len)) != NULL) {
+        if (expect == 9) expect++;   // o interrompido
+        CHECK(record_seq(rec) == expect, "ordem: %lu != %lu", (unsigned long) record_seq(rec), (unsigned long) expect);
+        expect++;
+        flash_log_advance();
+    }
+    CHECK(expect == 15, "leu até %lu", (unsigned long) expect);
+}
+
+int main(void) {
+    printf("flash_log: região de %u KB em 0x%x, registros até %u bytes\n",
+           FLASH_LOG_SIZE / 1024, (unsigned) FLASH_LOG_OFFSET, FLASH_LOG_RECORD_MAX);
+
+    bench_append_deliver(48);
+    bench_append_deliver(230);
+    bench_full_recovery();
+    bench_torn_write();
+
+    printf("\n%s\n", failures ? "FALHAS" : "ok");
+    return failures ? 1 : 0;
+}
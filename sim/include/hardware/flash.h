@@ -0,0 +1,20 @@
+#ifndef SIM_HARDWARE_FLASH_H
+#define SIM_HARDWARE_FLASH_H
+
+#include "pico.h"
+
+// flash emulada em arquivo (SIM_FLASH_FILE, padrão sim_flash.bin), mapeada em
+// memória: leituras via XIP_BASE funcionam como na placa
+#define PICO_FLASH_SIZE_BYTES   (2 * 1024 * 1024)
+#define FLASH_PAGE_SIZE         (1u << 8)
+#define FLASH_SECTOR_SIZE       (1u << 12)
+
+extern uint8_t *sim_flash_mem;
+#define XIP_BASE ((uintptr_t) sim_flash_mem)
+
+// mesmas restrições da placa: erase alinhado ao setor, program à página;
+// program só leva bits de 1 para 0
+void flash_range_erase(uint32_t flash_offs, size_t count);
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count);
+
+#endif
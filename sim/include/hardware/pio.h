@@ -0,0 +1,47 @@
+#ifndef SIM_HARDWARE_PIO_H
+#define SIM_HARDWARE_PIO_H
+
+#include "pico.h"
+#include "hardware/gpio.h"
+
+// PIO emulado só no nível de palavra: cada put executa os slots do
+// barramento 1-Wire no modelo de dispositivos (sim/sim_onewire.c) e gasta
+// o tempo deles em busy-wait, como a tarefa que espera o FIFO na placa
+typedef struct pio_hw pio_hw_t;
+typedef pio_hw_t *PIO;
+
+extern pio_hw_t sim_pio0_hw;
+extern pio_hw_t sim_pio1_hw;
+
+#define pio0 (&sim_pio0_hw)
+#define pio1 (&sim_pio1_hw)
+
+#define NUM_PIO_STATE_MACHINES 4
+
+typedef struct pio_program {
+    const uint16_t *instructions;
+    uint8_t length;
+    int8_t origin;
+} pio_program_t;
+
+bool pio_can_add_program(PIO pio, const pio_program_t *program);
+uint pio_add_program(PIO pio, const pio_program_t *program);
+int pio_claim_unused_sm(PIO pio, bool required);
+void pio_gpio_init(PIO pio, uint pin);
+
+void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data);
+uint32_t pio_sm_get_blocking(PIO pio, uint sm);
+void pio_sm_exec_wait_blocking(PIO pio, uint sm, uint instr);
+
+// (re)configura a máquina como o onewire_sm_init gerado pelo pioasm
+void sim_pio_onewire_sm_init(PIO pio, uint sm, uint offset, uint pin, uint bits_per_word);
+
+static inline uint pio_encode_jmp(uint addr) {
+    return addr & 0x1fu;
+}
+
+static inline uint pio_encode_sideset(uint sideset_bit_count, uint value) {
+    return (value << (5 - sideset_bit_count)) << 8;
+}
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef SIM_LWIP_DHCP_H
+#define SIM_LWIP_DHCP_H
+
+#include "lwip/netif.h"
+
+struct dhcp {
+    u8_t state;                 // 0 = desligado, 10 = BOUND (como no lwIP)
+    u32_t offered_t0_lease;     // duração da concessão (s)
+};
+
+#define DHCP_STATE_BOUND 10
+
+#define netif_dhcp_data(n)  ((n)->dhcp)
+
+static inline u8_t dhcp_supplied_address(const struct netif *netif) {
+    return netif->dhcp != NULL && netif->dhcp->state == DHCP_STATE_BOUND;
+}
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef SIM_LWIP_DNS_H
+#define SIM_LWIP_DNS_H
+
+#include "lwip/opt.h"
+#include "lwip/err.h"
+#include "lwip/ip_addr.h"
+
+// resolvedor do lwIP (sim/sim_lwip.c): IP literal e cache dentro do TTL
+// respondem na hora; o resto é consultado na tarefa de bombeamento, com o
+// callback chamado com o lock do lwIP (ipaddr NULL = não resolveu)
+typedef void (*dns_found_callback)(const char *name, const ip_addr_t *ipaddr, void *callback_arg);
+
+err_t dns_gethostbyname(const char *hostname, ip_addr_t *addr, dns_found_callback found, void *callback_arg);
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef SIM_LWIP_IP_ADDR_H
+#define SIM_LWIP_IP_ADDR_H
+
+#include "lwip/opt.h"
+
+// só IPv4, como o firmware usa
+typedef struct ip4_addr {
+    u32_t addr;   // ordem de rede
+} ip4_addr_t;
+
+typedef ip4_addr_t ip_addr_t;
+
+enum lwip_ip_addr_type {
+    IPADDR_TYPE_V4 = 0,
+    IPADDR_TYPE_V6 = 6,
+    IPADDR_TYPE_ANY = 46,
+};
+
+extern const ip4_addr_t ip4_addr_any;
+#define IP4_ADDR_ANY4   (&ip4_addr_any)
+#define IP_ADDR_ANY     (&ip4_addr_any)
+
+#define ip4_addr_get_u32(a)    ((a)->addr)
+#define ip4_addr_isany_val(a)  ((a).addr == 0)
+#define ip_addr_copy(d, s)     ((d) = (s))
+
+int ip4addr_aton(const char *cp, ip4_addr_t *addr);
+char *ip4addr_ntoa(const ip4_addr_t *addr);
+#define ipaddr_aton(cp, a)  ip4addr_aton(cp, a)
+#define ipaddr_ntoa(a)      ip4addr_ntoa(a)
+
+#endif
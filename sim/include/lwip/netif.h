@@ -0,0 +1,27 @@
+#ifndef SIM_LWIP_NETIF_H
+#define SIM_LWIP_NETIF_H
+
+#include <stdbool.h>
+
+#include "lwip/opt.h"
+#include "lwip/err.h"
+#include "lwip/ip_addr.h"
+
+struct dhcp;
+
+struct netif {
+    ip4_addr_t ip_addr;
+    ip4_addr_t netmask;
+    ip4_addr_t gw;
+    struct dhcp *dhcp;
+    u8_t flags;
+};
+
+#define netif_ip4_addr(n)     ((const ip4_addr_t *) &((n)->ip_addr))
+#define netif_ip4_netmask(n)  ((const ip4_addr_t *) &((n)->netmask))
+#define netif_ip4_gw(n)       ((const ip4_addr_t *) &((n)->gw))
+
+void netif_set_addr(struct netif *netif, const ip4_addr_t *ipaddr,
+                    const ip4_addr_t *netmask, const ip4_addr_t *gw);
+
+#endif
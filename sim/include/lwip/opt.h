@@ -0,0 +1,24 @@
+#ifndef SIM_LWIP_OPT_H
+#define SIM_LWIP_OPT_H
+
+// mesmas opções da placa; a pilha da simulação (sim_lwip.c) só usa os
+// tamanhos de buffer e as chaves de recursos
+#include "lwipopts.h"
+
+// o arch/cc.h da placa traz a libc básica junto
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint8_t  u8_t;
+typedef int8_t   s8_t;
+typedef uint16_t u16_t;
+typedef int16_t  s16_t;
+typedef uint32_t u32_t;
+typedef int32_t  s32_t;
+
+#define LWIP_UNUSED_ARG(x) (void) (x)
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef SIM_LWIP_STATS_H
+#define SIM_LWIP_STATS_H
+
+#include "lwip/opt.h"
+
+// só os contadores lidos pelo firmware (net_health), com os mesmos nomes do
+// lwIP; sim_lwip.c os mantém. No lwIP o enum vem de lwip/memp.h
+typedef enum {
+    MEMP_TCP_SEG,
+    MEMP_PBUF,          // pbufs de referência (tcp_write sem cópia)
+    MEMP_PBUF_POOL,     // pbufs de recepção
+    MEMP_MAX
+} memp_t;
+
+struct stats_mem {
+    const char *name;
+    u32_t err;
+    u32_t avail;
+    u32_t used;
+    u32_t max;
+    u32_t illegal;
+};
+
+struct stats_mib2 {
+    u32_t tcpactiveopens;
+    u32_t tcpattemptfails;
+    u32_t tcpoutsegs;
+    u32_t tcpretranssegs;
+};
+
+struct stats_ {
+    struct stats_mem mem;
+    struct stats_mem *memp[MEMP_MAX];
+    struct stats_mib2 mib2;
+};
+
+extern struct stats_ lwip_stats;
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef SIM_LWIP_TCP_H
+#define SIM_LWIP_TCP_H
+
+#include "lwip/opt.h"
+#include "lwip/err.h"
+#include "lwip/ip_addr.h"
+#include "lwip/pbuf.h"
+
+// raw API sobre sockets não bloqueantes do host (sim/sim_lwip.c); os
+// callbacks rodam na tarefa de bombeamento, com o lock do lwIP tomado
+struct tcp_pcb;
+
+typedef err_t (*tcp_connected_fn)(void *arg, struct tcp_pcb *tpcb, err_t err);
+typedef err_t (*tcp_sent_fn)(void *arg, struct tcp_pcb *tpcb, u16_t len);
+typedef err_t (*tcp_recv_fn)(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err);
+typedef err_t (*tcp_poll_fn)(void *arg, struct tcp_pcb *tpcb);
+typedef void  (*tcp_err_fn)(void *arg, err_t err);
+
+#define TCP_WRITE_FLAG_COPY 0x01
+#define TCP_WRITE_FLAG_MORE 0x02
+
+// opções de socket do pcb (lwip/ip.h na placa)
+#define SOF_REUSEADDR 0x04U
+#define SOF_KEEPALIVE 0x08U
+#define SOF_BROADCAST 0x20U
+
+#define ip_set_option(pcb, opt)   ((pcb)->so_options |= (opt))
+#define ip_reset_option(pcb, opt) ((pcb)->so_options &= ~(opt))
+#define ip_get_option(pcb, opt)   ((pcb)->so_options & (opt))
+
+typedef enum {
+    PCB_NEW,
+    PCB_CONNECTING,
+    PCB_CONNECTED,
+    PCB_CLOSED,     // par fechou; o pcb continua do app até tcp_close/abort
+    PCB_DEAD,       // liberado no fim do ciclo da tarefa de bombeamento
+} pcb_state_t;
+
+// uma chamada a tcp_write ainda não confirmada
+typedef struct {
+    uint32_t end;        // offset acumulado do último byte
+    uint64_t sent_us;    // 0 = ainda não entregue ao socket
+    uint16_t len;
+    const void *ref;     // escrita sem cópia: dados do app (NULL = copiado)
+    uint16_t ref_len;
+    uint32_t ref_sum;
+} tx_rec_t;
+
+struct tcp_pcb {
+    // campos que o firmware acessa direto, como no lwIP
+    u8_t so_options;
+    u32_t keep_idle;             // ms sem nada do par até a primeira sonda
+    u32_t keep_intvl;            // ms entre sondas
+    u32_t keep_cnt;              // sondas sem resposta até abortar
+
+    // daqui em diante, estado interno da simulação
+    struct tcp_pcb *next;
+    pcb_state_t state;
+    int fd;
+
+    void *arg;
+    tcp_connected_fn connected;
+    tcp_sent_fn sent;
+    tcp_recv_fn recv;
+    tcp_poll_fn poll;
+    tcp_err_fn errf;
+    u8_t poll_interval;
+    u8_t poll_ticks;
+
+    uint8_t tx[TCP_SND_BUF];     // escrito e ainda não entregue ao socket
+    uint32_t tx_len;
+    uint32_t written;            // total aceito por tcp_write
+    uint32_t flushed;            // total entregue ao socket
+    uint32_t acked;              // total confirmado ao app
+
+    tx_rec_t recs[TCP_SND_QUEUELEN];
+    uint32_t rec_head, rec_count;
+
+    uint64_t stalled_since_us;   // dados presos sem link
+    uint64_t rexmit_at_us;       // próxima retransmissão contada (lwip_stats)
+    uint32_t rexmit_wait_ms;
+
+    uint64_t last_rx_us;         // último segmento do par (keepalive)
+    u32_t keep_cnt_sent;         // sondas sem resposta
+    u8_t peer_lost;              // o par caiu com a conexão aberta (SIM_PEER_DOWN)
+};
+
+struct tcp_pcb *tcp_new(void);
+struct tcp_pcb *tcp_new_ip_type(u8_t type);
+
+void tcp_arg(struct tcp_pcb *pcb, void *arg);
+void tcp_err(struct tcp_pcb *pcb, tcp_err_fn err);
+void tcp_sent(struct tcp_pcb *pcb, tcp_sent_fn sent);
+void tcp_recv(struct tcp_pcb *pcb, tcp_recv_fn recv);
+void tcp_poll(struct tcp_pcb *pcb, tcp_poll_fn poll, u8_t interval);
+
+err_t tcp_connect(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port, tcp_connected_fn connected);
+err_t tcp_write(struct tcp_pcb *pcb, const void *dataptr, u16_t len, u8_t apiflags);
+err_t tcp_output(struct tcp_pcb *pcb);
+void tcp_recved(struct tcp_pcb *pcb, u16_t len);
+err_t tcp_close(struct tcp_pcb *pcb);
+void tcp_abort(struct tcp_pcb *pcb);
+
+u16_t tcp_sndbuf(const struct tcp_pcb *pcb);
+u16_t tcp_sndqueuelen(const struct tcp_pcb *pcb);
+
+void tcp_nagle_disable(struct tcp_pcb *pcb);
+void tcp_nagle_enable(struct tcp_pcb *pcb);
+
+#endif
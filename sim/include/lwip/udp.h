@@ -0,0 +1,25 @@
+#ifndef SIM_LWIP_UDP_H
+#define SIM_LWIP_UDP_H
+
+#include "lwip/opt.h"
+#include "lwip/err.h"
+#include "lwip/ip_addr.h"
+#include "lwip/pbuf.h"
+
+// raw API de UDP sobre um socket datagrama do host (sim/sim_lwip.c); o
+// callback de recepção roda na tarefa de bombeamento, com o lock do lwIP
+struct udp_pcb;
+
+typedef void (*udp_recv_fn)(void *arg, struct udp_pcb *pcb, struct pbuf *p,
+                            const ip_addr_t *addr, u16_t port);
+
+struct udp_pcb *udp_new(void);
+struct udp_pcb *udp_new_ip_type(u8_t type);
+void udp_remove(struct udp_pcb *pcb);
+
+err_t udp_connect(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port);
+void udp_disconnect(struct udp_pcb *pcb);
+void udp_recv(struct udp_pcb *pcb, udp_recv_fn recv, void *recv_arg);
+err_t udp_send(struct udp_pcb *pcb, struct pbuf *p);
+
+#endif
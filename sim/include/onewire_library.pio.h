@@ -0,0 +1,32 @@
+#ifndef SIM_ONEWIRE_LIBRARY_PIO_H
+#define SIM_ONEWIRE_LIBRARY_PIO_H
+
+// substitui o cabeçalho que o pioasm gera a partir de
+// drivers/onewire_library/onewire_library.pio: mesmos símbolos e offsets,
+// com a máquina de estados trocada pelo modelo do barramento
+
+#include "hardware/pio.h"
+#include "hardware/clocks.h"
+
+#define onewire_wrap_target 8
+#define onewire_wrap 16
+
+#define onewire_offset_reset_bus 0u
+#define onewire_offset_fetch_bit 8u
+
+static const pio_program_t onewire_program = {
+    .instructions = NULL,
+    .length = 17,
+    .origin = -1,
+};
+
+static inline void onewire_sm_init(PIO pio, uint sm, uint offset, uint pin_num, uint bits_per_word) {
+    sim_pio_onewire_sm_init(pio, sm, offset, pin_num, bits_per_word);
+}
+
+static inline uint onewire_reset_instr(uint offset) {
+    // encode a "jmp reset_bus side 0" instruction for the state machine
+    return pio_encode_jmp(offset + onewire_offset_reset_bus) | pio_encode_sideset(1, 0);
+}
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef SIM_PICO_H
+#define SIM_PICO_H
+
+// equivalente ao pico.h do SDK: tipos básicos e a configuração da placa
+// (boards/pico_w.h), incluído por todos os outros cabeçalhos
+
+#include <assert.h>
+
+#include "pico/types.h"
+
+#define PICO_DEFAULT_I2C          0
+#define PICO_DEFAULT_I2C_SDA_PIN  4
+#define PICO_DEFAULT_I2C_SCL_PIN  5
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef SIM_PICO_CYW43_ARCH_H
+#define SIM_PICO_CYW43_ARCH_H
+
+// cyw43 emulado (sim/sim_cyw43.c): um AP fixo, com tempos de join, DHCP e
+// quedas configuráveis por variáveis de ambiente (ver sim/README.md)
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pico.h"
+#include "pico/time.h"
+#include "lwip/netif.h"
+#include "lwip/dhcp.h"
+
+#define CYW43_ITF_STA 0
+#define CYW43_ITF_AP  1
+
+#define CYW43_LINK_DOWN     (0)
+#define CYW43_LINK_JOIN     (1)
+#define CYW43_LINK_NOIP     (2)
+#define CYW43_LINK_UP       (3)
+#define CYW43_LINK_FAIL     (-1)
+#define CYW43_LINK_NONET    (-2)
+#define CYW43_LINK_BADAUTH  (-3)
+
+#define CYW43_AUTH_OPEN            (0)
+#define CYW43_AUTH_WPA_TKIP_PSK    (0x00200002)
+#define CYW43_AUTH_WPA2_AES_PSK    (0x00400004)
+#define CYW43_AUTH_WPA2_MIXED_PSK  (0x00400006)
+
+#define CYW43_CHANNEL_NONE  (0xffffffff)
+
+#define CYW43_IOCTL_GET_CHANNEL  (0x3a)
+
+typedef struct _cyw43_t {
+    struct netif netif[2];
+} cyw43_t;
+
+extern cyw43_t cyw43_state;
+
+int cyw43_arch_init(void);
+void cyw43_arch_deinit(void);
+void cyw43_arch_enable_sta_mode(void);
+
+int cyw43_arch_wifi_connect_async(const char *ssid, const char *pw, uint32_t auth);
+
+// lock do lwIP: mutex recursivo compartilhado com a tarefa de bombeamento
+void cyw43_arch_lwip_begin(void);
+void cyw43_arch_lwip_end(void);
+
+int cyw43_wifi_join(cyw43_t *self, size_t ssid_len, const uint8_t *ssid, size_t key_len,
+                    const uint8_t *key, uint32_t auth_type, const uint8_t *bssid, uint32_t channel);
+int cyw43_wifi_leave(cyw43_t *self, int itf);
+int cyw43_wifi_get_bssid(cyw43_t *self, uint8_t bssid[6]);
+int cyw43_wifi_get_rssi(cyw43_t *self, int32_t *rssi);
+int cyw43_wifi_link_status(cyw43_t *self, int itf);
+int cyw43_tcpip_link_status(cyw43_t *self, int itf);
+int cyw43_ioctl(cyw43_t *self, uint32_t cmd, size_t len, uint8_t *buf, uint32_t iface);
+
+#endif
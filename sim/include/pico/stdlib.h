@@ -0,0 +1,20 @@
+#ifndef SIM_PICO_STDLIB_H
+#define SIM_PICO_STDLIB_H
+
+// pico-sdk no host: só o subconjunto usado pelo firmware
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "pico.h"
+#include "pico/time.h"
+#include "hardware/gpio.h"
+
+static inline bool stdio_init_all(void) {
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    return true;
+}
+
+#endif
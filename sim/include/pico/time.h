@@ -0,0 +1,32 @@
+#ifndef SIM_PICO_TIME_H
+#define SIM_PICO_TIME_H
+
+#include "pico.h"
+
+// relógio monotônico do host, contado a partir do início do processo
+absolute_time_t get_absolute_time(void);
+
+static inline uint32_t to_ms_since_boot(absolute_time_t t) {
+    return (uint32_t) (t / 1000);
+}
+
+static inline uint64_t to_us_since_boot(absolute_time_t t) {
+    return t;
+}
+
+static inline int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to) {
+    return (int64_t) (to - from);
+}
+
+static inline absolute_time_t make_timeout_time_ms(uint32_t ms) {
+    return get_absolute_time() + (uint64_t) ms * 1000;
+}
+
+// com o escalonador rodando, dorme com vTaskDelay (como configSUPPORT_PICO_TIME_INTEROP)
+void sleep_ms(uint32_t ms);
+void sleep_us(uint64_t us);
+
+// ocupa a CPU como os periféricos bloqueantes da placa
+void busy_wait_us(uint64_t us);
+
+#endif
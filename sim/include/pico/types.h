@@ -0,0 +1,20 @@
+#ifndef SIM_PICO_TYPES_H
+#define SIM_PICO_TYPES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef unsigned int uint;
+
+#define _u(x)          ((uint)(x))
+#define count_of(a)    (sizeof(a) / sizeof((a)[0]))
+
+#define PICO_OK                 0
+#define PICO_ERROR_GENERIC      (-1)
+#define PICO_ERROR_TIMEOUT      (-2)
+#define PICO_ERROR_NOT_PERMITTED (-4)
+
+typedef uint64_t absolute_time_t;   // µs desde o início do processo
+
+#endif
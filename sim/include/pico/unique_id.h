@@ -0,0 +1,11 @@
+#ifndef SIM_PICO_UNIQUE_ID_H
+#define SIM_PICO_UNIQUE_ID_H
+
+#include "pico.h"
+
+#define PICO_UNIQUE_BOARD_ID_SIZE_BYTES 8
+
+// id da placa em hexadecimal; na simulação vem de SIM_STATION_ID
+void pico_get_unique_board_id_string(char *id_out, uint len);
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "pico/time.h"
+
+// --- simulação no host: interfaces internas entre os shims ---
+
+// contadores dos periféricos emulados (impressos pelo relatório)
+typedef struct {
+    uint32_t i2c_xfers;        // transações i2c_*_blocking
+    uint32_t i2c_nacks;        // endereço sem dispositivo (ou mux fechado)
+    uint64_t i2c_bytes;
+    uint64_t i2c_busy_us;      // tempo gasto no barramento
+    uint32_t oled_frames;      // quadros completos enviados ao SSD1306
+
+    uint32_t ow_resets;
+    uint32_t ow_slots;         // slots de bit no 1-Wire
+    uint64_t ow_busy_us;
+
+    uint32_t flash_erases;     // setores apagados
+    uint32_t flash_programs;   // páginas gravadas
+    uint64_t flash_busy_us;
+
+    uint32_t wifi_joins;
+    uint32_t tcp_connects;
+    uint32_t tcp_writes;       // chamadas a tcp_write
+    uint32_t tcp_outputs;      // chamadas a tcp_output
+    uint32_t tcp_segments;     // send() no socket do host
+    uint64_t tcp_tx_bytes;
+    uint64_t tcp_copy_bytes;   // copiados para o stack (TCP_WRITE_FLAG_COPY)
+    uint32_t tcp_keepalives;   // sondas de keepalive enviadas
+    uint32_t udp_sends;        // datagramas entregues ao socket
+    uint32_t udp_lost;         // descartados (sem link ou SIM_UDP_LOSS)
+    uint64_t udp_tx_bytes;
+} sim_stats_t;
+
+extern sim_stats_t sim_stats;
+
+// variável de ambiente numérica (ou `def` se ausente/inválida)
+uint32_t sim_env_u32(const char *name, uint32_t def);
+
+// agora está dentro de alguma janela "início:duração[,...]" (em s) da
+// variável de ambiente
+bool sim_env_window(const char *name);
+
+// µs desde o início do processo
+uint64_t sim_now_us(void);
+
+// segundos de simulação desde o início (para o roteiro de quedas)
+static inline uint32_t sim_now_s(void) {
+    return (uint32_t) (sim_now_us() / 1000000);
+}
+
+// Wi-Fi associado e com IP: o lwIP só roteia com o link em pé
+bool sim_wifi_link_up(void);
+
+// dispara o callback de GPIO registrado (ex.: botão)
+void sim_gpio_irq(unsigned gpio, uint32_t events);
+
+// sobe a tarefa de bombeamento do lwIP (chamado por cyw43_arch_init)
+void sim_lwip_start(void);
+
+#endif
@@ -0,0 +1,207 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "pico/cyw43_arch.h"
+
+#include "sim.h"
+
+// Um único AP, com os tempos medidos na placa:
+//   SIM_WIFI_INIT_MS      carga do firmware do chip em cyw43_arch_init (300)
+//   SIM_WIFI_JOIN_MS      join com varredura de todos os canais (2500)
+//   SIM_WIFI_FASTJOIN_MS  join direcionado por BSSID/canal (80)
+//   SIM_DHCP_MS           DHCP depois de associar (500)
+//   SIM_WIFI_CHANNEL      canal do AP (6); mudar invalida a cache da flash
+//   SIM_WIFI_OUTAGE       quedas "início:duração[,início:duração...]" em s
+//   SIM_WIFI_RSSI         RSSI médio em dBm (-62), com ±3 dB de ruído
+
+cyw43_t cyw43_state;
+
+static const uint8_t ap_bssid[6] = { 0x02, 0x5a, 0x0c, 0x41, 0x50, 0x01 };
+static const ip4_addr_t ap_ip = { 0x3201a8c0 };     // 192.168.1.50
+static const ip4_addr_t ap_mask = { 0x00ffffff };
+static const ip4_addr_t ap_gw = { 0x0101a8c0 };
+
+typedef enum {
+    LINK_IDLE,
+    LINK_JOINING,      // associa em join_done_us
+    LINK_ASSOCIATED,   // DHCP conclui em dhcp_done_us
+    LINK_FAILED,
+} link_t;
+
+static link_t wifi_link = LINK_IDLE;
+static uint64_t join_done_us;
+static uint64_t dhcp_done_us;
+static bool join_will_fail;
+static struct dhcp sta_dhcp;
+
+static SemaphoreHandle_t lwip_mutex;
+
+/* ------------------ quedas ------------------ */
+
+static bool in_outage(void) {
+    return sim_env_window("SIM_WIFI_OUTAGE");
+}
+
+/* ------------------ link -------------------- */
+
+static void link_drop(void) {
+    wifi_link = LINK_IDLE;
+    sta_dhcp.state = 0;
+    cyw43_state.netif[CYW43_ITF_STA].ip_addr.addr = 0;
+}
+
+// avança join e DHCP até agora; chamado em toda consulta de estado
+static void link_update(void) {
+    uint64_t now = sim_now_us();
+
+    if (wifi_link != LINK_IDLE && wifi_link != LINK_FAILED && in_outage()) {
+        printf("[sim] wifi: AP fora do ar\n");
+        link_drop();
+        wifi_link = LINK_FAILED;
+        return;
+    }
+
+    if (wifi_link == LINK_JOINING && now >= join_done_us) {
+        if (join_will_fail || in_outage()) {
+            wifi_link = LINK_FAILED;
+            return;
+        }
+        wifi_link = LINK_ASSOCIATED;
+        dhcp_done_us = now + (uint64_t) sim_env_u32("SIM_DHCP_MS", 500) * 1000;
+    }
+
+    if (wifi_link == LINK_ASSOCIATED && sta_dhcp.state != DHCP_STATE_BOUND && now >= dhcp_done_us) {
+        struct netif *n = &cyw43_state.netif[CYW43_ITF_STA];
+        n->ip_addr = ap_ip;
+        n->netmask = ap_mask;
+        n->gw = ap_gw;
+        sta_dhcp.state = DHCP_STATE_BOUND;
+        sta_dhcp.offered_t0_lease = 86400;
+    }
+}
+
+bool sim_wifi_link_up(void) {
+    return cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA) == CYW43_LINK_UP;
+}
+
+/* --------------- cyw43_arch ----------------- */
+
+int cyw43_arch_init(void) {
+    lwip_mutex = xSemaphoreCreateRecursiveMutex();
+    cyw43_state.netif[CYW43_ITF_STA].dhcp = &sta_dhcp;
+
+    sleep_ms(sim_env_u32("SIM_WIFI_INIT_MS", 300));
+    sim_lwip_start();
+    return 0;
+}
+
+void cyw43_arch_deinit(void) {
+    link_drop();
+}
+
+void cyw43_arch_enable_sta_mode(void) {
+}
+
+void cyw43_arch_lwip_begin(void) {
+    xSemaphoreTakeRecursive(lwip_mutex, portMAX_DELAY);
+}
+
+void cyw43_arch_lwip_end(void) {
+    xSemaphoreGiveRecursive(lwip_mutex);
+}
+
+int cyw43_arch_wifi_connect_async(const char *ssid, const char *pw, uint32_t auth) {
+    return cyw43_wifi_join(&cyw43_state, strlen(ssid), (const uint8_t *) ssid,
+                           pw ? strlen(pw) : 0, (const uint8_t *) pw, auth, NULL, CYW43_CHANNEL_NONE);
+}
+
+/* ----------------- cyw43 -------------------- */
+
+int cyw43_wifi_join(cyw43_t *self, size_t ssid_len, const uint8_t *ssid, size_t key_len,
+                    const uint8_t *key, uint32_t auth_type, const uint8_t *bssid, uint32_t channel) {
+    (void) self;
+    (void) ssid_len;
+    (void) ssid;
+    (void) key_len;
+    (void) key;
+    (void) auth_type;
+
+    uint32_t ap_channel = sim_env_u32("SIM_WIFI_CHANNEL", 6);
+    uint32_t ms;
+
+    link_drop();
+    sim_stats.wifi_joins++;
+
+    if (bssid && channel != CYW43_CHANNEL_NONE) {
+        // direcionado: só funciona se o AP continuar no mesmo canal
+        ms = sim_env_u32("SIM_WIFI_FASTJOIN_MS", 80);
+        join_will_fail = memcmp(bssid, ap_bssid, 6) != 0 || channel != ap_channel;
+        if (join_will_fail) ms = 2000;   // o chip desiste depois de algumas sondas
+    }
+    else {
+        ms = sim_env_u32("SIM_WIFI_JOIN_MS", 2500);
+        join_will_fail = false;
+    }
+
+    wifi_link = LINK_JOINING;
+    join_done_us = sim_now_us() + (uint64_t) ms * 1000;
+    return 0;
+}
+
+int cyw43_wifi_leave(cyw43_t *self, int itf) {
+    (void) self;
+    (void) itf;
+    link_drop();
+    return 0;
+}
+
+int cyw43_wifi_get_bssid(cyw43_t *self, uint8_t bssid[6]) {
+    (void) self;
+    link_update();
+    if (wifi_link != LINK_ASSOCIATED) return -1;
+    memcpy(bssid, ap_bssid, 6);
+    return 0;
+}
+
+int cyw43_wifi_get_rssi(cyw43_t *self, int32_t *rssi) {
+    (void) self;
+    link_update();
+    if (wifi_link != LINK_ASSOCIATED) return -1;
+    const char *v = getenv("SIM_WIFI_RSSI");
+    *rssi = (v ? atoi(v) : -62) + rand() % 7 - 3;
+    return 0;
+}
+
+int cyw43_ioctl(cyw43_t *self, uint32_t cmd, size_t len, uint8_t *buf, uint32_t iface) {
+    (void) self;
+    (void) iface;
+    if (cmd == CYW43_IOCTL_GET_CHANNEL && len >= 4) {
+        uint32_t ch = sim_env_u32("SIM_WIFI_CHANNEL", 6);
+        memcpy(buf, &ch, 4);
+        return 0;
+    }
+    return -1;
+}
+
+int cyw43_wifi_link_status(cyw43_t *self, int itf) {
+    (void) self;
+    (void) itf;
+    link_update();
+    switch (wifi_link) {
+    case LINK_JOINING:    return CYW43_LINK_JOIN;
+    case LINK_ASSOCIATED: return CYW43_LINK_JOIN;   // associado (CYW43_LINK_JOIN no driver real)
+    case LINK_FAILED:     return CYW43_LINK_NONET;
+    default:              return CYW43_LINK_DOWN;
+    }
+}
+
+int cyw43_tcpip_link_status(cyw43_t *self, int itf) {
+    int st = cyw43_wifi_link_status(self, itf);
+    if (wifi_link != LINK_ASSOCIATED) return st;
+    return self->netif[itf].ip_addr.addr ? CYW43_LINK_UP : CYW43_LINK_NOIP;
+}
@@ -0,0 +1,107 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "pico/flash.h"
+#include "hardware/flash.h"
+
+#include "sim.h"
+
+// Flash QSPI de 2 MB num arquivo mapeado (SIM_FLASH_FILE, padrão
+// sim_flash.bin): o conteúdo sobrevive entre execuções como na placa.
+// Tempos típicos do W25Q16: 45 ms por setor apagado, 0,7 ms por página
+// (SIM_FLASH_TIMING=0 só contabiliza o tempo, sem esperar)
+
+#define FLASH_ERASE_US    45000
+#define FLASH_PROGRAM_US  700
+
+uint8_t *sim_flash_mem;
+static bool flash_timing = true;
+
+__attribute__((constructor))
+static void sim_flash_init(void) {
+    flash_timing = sim_env_u32("SIM_FLASH_TIMING", 1) != 0;
+
+    const char *path = getenv("SIM_FLASH_FILE");
+    if (!path || !*path) path = "sim_flash.bin";
+
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        perror("sim_flash: open");
+        exit(1);
+    }
+
+    off_t size = lseek(fd, 0, SEEK_END);
+    if (size != PICO_FLASH_SIZE_BYTES && ftruncate(fd, PICO_FLASH_SIZE_BYTES) < 0) {
+        perror("sim_flash: ftruncate");
+        exit(1);
+    }
+
+    sim_flash_mem = mmap(NULL, PICO_FLASH_SIZE_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (sim_flash_mem == MAP_FAILED) {
+        perror("sim_flash: mmap");
+        exit(1);
+    }
+
+    // arquivo novo (ou crescido): flash virgem é toda 0xFF
+    if (size < PICO_FLASH_SIZE_BYTES) {
+        memset(sim_flash_mem + size, 0xFF, PICO_FLASH_SIZE_BYTES - size);
+    }
+}
+
+void flash_range_erase(uint32_t flash_offs, size_t count) {
+    if (flash_offs % FLASH_SECTOR_SIZE || count % FLASH_SECTOR_SIZE || flash_offs + count > PICO_FLASH_SIZE_BYTES) {
+        fprintf(stderr, "sim_flash: erase desalinhado (0x%x, %zu)\n", flash_offs, count);
+        abort();
+    }
+    memset(sim_flash_mem + flash_offs, 0xFF, count);
+
+    uint32_t sectors = (uint32_t) (count / FLASH_SECTOR_SIZE);
+    sim_stats.flash_erases += sectors;
+    sim_stats.flash_busy_us += (uint64_t) sectors * FLASH_ERASE_US;
+    if (flash_timing) {
+        busy_wait_us((uint64_t) sectors * FLASH_ERASE_US);
+    }
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count) {
+    if (flash_offs % FLASH_PAGE_SIZE || count % FLASH_PAGE_SIZE || flash_offs + count > PICO_FLASH_SIZE_BYTES) {
+        fprintf(stderr, "sim_flash: program desalinhado (0x%x, %zu)\n", flash_offs, count);
+        abort();
+    }
+    // a gravação só zera bits: sem erase antes, o resultado é o AND
+    for (size_t i = 0; i < count; i++) {
+        sim_flash_mem[flash_offs + i] &= data[i];
+    }
+
+    uint32_t pages = (uint32_t) (count / FLASH_PAGE_SIZE);
+    sim_stats.flash_programs += pages;
+    sim_stats.flash_busy_us += (uint64_t) pages * FLASH_PROGRAM_US;
+    if (flash_timing) {
+        busy_wait_us((uint64_t) pages * FLASH_PROGRAM_US);
+    }
+}
+
+int flash_safe_execute(void (*func)(void *), void *param, uint32_t enter_exit_timeout_ms) {
+    (void) enter_exit_timeout_ms;
+
+    // fora do escalonador (ferramentas de bancada) não há com quem disputar
+    if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED) {
+        func(param);
+        return PICO_OK;
+    }
+
+    // na placa o XIP fica desligado e o outro core parado: aqui, nenhuma
+    // outra tarefa roda durante a operação
+    vTaskSuspendAll();
+    func(param);
+    xTaskResumeAll();
+    return PICO_OK;
+}
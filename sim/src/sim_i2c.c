@@ -0,0 +1,228 @@
+#include <math.h>
+#include <string.h>
+
+#include "hardware/i2c.h"
+
+#include "sim.h"
+
+// Modelos dos dispositivos do i2c0 da estação:
+//   PCA9548A (0x70) com um BH1750 (0x23) em cada canal 5..7,
+//   MPU6050 (0x68), INA219 (0x40) e o OLED SSD1306 (0x3C).
+// Cada transação gasta em busy-wait o tempo que levaria no fio (9 bits por
+// byte mais start/stop) na taxa configurada pelo último i2c_init, como na placa
+
+struct i2c_inst {
+    uint baudrate;
+};
+
+i2c_inst_t sim_i2c0_inst = { 100000 };
+i2c_inst_t sim_i2c1_inst = { 100000 };
+
+#define MUX_ADDR      0x70
+#define BH1750_ADDR   0x23
+#define MPU6050_ADDR  0x68
+#define INA219_ADDR   0x40
+#define SSD1306_ADDR  0x3C
+
+#define OLED_FRAME_BYTES (128 * 64 / 8)
+
+// grandezas físicas simuladas, variando devagar com o tempo
+static double sim_t(void) {
+    return (double) sim_now_us() / 1e6;
+}
+
+/* ----------------- PCA9548A ----------------- */
+static uint8_t mux_mask;
+
+/* ------------------ BH1750 ------------------ */
+typedef struct {
+    bool powered;
+    bool continuous;
+} bh1750_model_t;
+
+static bh1750_model_t bh1750[8];
+
+static bh1750_model_t *bh1750_selected(void) {
+    // o firmware abre um canal por vez; com mais de um, o barramento colide
+    for (int ch = 5; ch < 8; ch++) {
+        if (mux_mask == (1u << ch)) return &bh1750[ch];
+    }
+    return NULL;
+}
+
+static uint16_t bh1750_raw(void) {
+    int ch = __builtin_ctz(mux_mask);
+    double lux = 800.0 + 400.0 * sin(sim_t() / 60.0 + ch) + 10.0 * sin(sim_t() * 3.0);
+    return (uint16_t) (lux * 1.2);
+}
+
+/* ------------------ MPU6050 ----------------- */
+static uint8_t mpu_regs[128];
+static uint8_t mpu_ptr;
+
+static void mpu_put16(uint8_t reg, int16_t v) {
+    mpu_regs[reg] = (uint8_t) (v >> 8);
+    mpu_regs[reg + 1] = (uint8_t) v;
+}
+
+static void mpu_sample(void) {
+    // painel inclinando devagar (rastreador solar)
+    double pitch = 20.0 * sin(sim_t() / 120.0) * M_PI / 180.0;
+    double roll = 5.0 * sin(sim_t() / 45.0) * M_PI / 180.0;
+    mpu_put16(0x3B, (int16_t) (16384.0 * sin(pitch)));
+    mpu_put16(0x3D, (int16_t) (16384.0 * sin(roll)));
+    mpu_put16(0x3F, (int16_t) (16384.0 * cos(pitch) * cos(roll)));
+}
+
+/* ------------------ INA219 ------------------ */
+static uint16_t ina_regs[6];
+static uint8_t ina_ptr;
+
+static uint16_t ina219_reg(uint8_t reg) {
+    const double rshunt = 0.136;
+    double vbus = 12.6 + 0.3 * sin(sim_t() / 90.0);
+    double amps = 0.8 + 0.4 * sin(sim_t() / 60.0);
+    double current_lsb = 0.0001;
+    uint16_t cal = ina_regs[5];
+
+    switch (reg) {
+    case 1: return (uint16_t) (int16_t) (amps * rshunt / 0.00001);
+    case 2: return (uint16_t) (((uint16_t) (vbus / 0.004) << 3) | 0x2);   // CNVR
+    case 3: return cal ? (uint16_t) (amps * vbus / (20 * current_lsb)) : 0;
+    case 4: return cal ? (uint16_t) (int16_t) (amps / current_lsb) : 0;
+    default: return ina_regs[reg % 6];
+    }
+}
+
+/* ------------------ barramento --------------- */
+
+static void i2c_spend(i2c_inst_t *i2c, size_t len) {
+    // endereço + dados, 9 bits cada, mais start/stop
+    uint64_t us = ((uint64_t) (len + 1) * 9 + 2) * 1000000u / i2c->baudrate;
+    sim_stats.i2c_xfers++;
+    sim_stats.i2c_bytes += len;
+    sim_stats.i2c_busy_us += us;
+    busy_wait_us(us);
+}
+
+static bool i2c_present(uint8_t addr) {
+    switch (addr) {
+    case MUX_ADDR:
+    case MPU6050_ADDR:
+    case INA219_ADDR:
+    case SSD1306_ADDR:
+        return true;
+    case BH1750_ADDR:
+        return bh1750_selected() != NULL;
+    default:
+        return false;
+    }
+}
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate) {
+    i2c->baudrate = baudrate;
+    return baudrate;
+}
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop) {
+    (void) nostop;
+
+    if (!i2c_present(addr)) {
+        i2c_spend(i2c, 0);
+        sim_stats.i2c_nacks++;
+        return PICO_ERROR_GENERIC;
+    }
+    i2c_spend(i2c, len);
+    if (len == 0) return 0;
+
+    switch (addr) {
+    case MUX_ADDR:
+        mux_mask = src[len - 1];
+        break;
+
+    case BH1750_ADDR: {
+        bh1750_model_t *d = bh1750_selected();
+        if (src[0] == 0x01) d->powered = true;
+        else if (src[0] == 0x00) d->powered = false;
+        else if (src[0] == 0x10) d->continuous = true;
+        break;
+    }
+
+    case MPU6050_ADDR:
+        mpu_ptr = src[0] & 0x7f;
+        for (size_t i = 1; i < len; i++) {
+            mpu_regs[(mpu_ptr + i - 1) & 0x7f] = src[i];
+        }
+        break;
+
+    case INA219_ADDR:
+        ina_ptr = src[0];
+        if (len >= 3 && ina_ptr < 6) {
+            ina_regs[ina_ptr] = (uint16_t) ((src[1] << 8) | src[2]);
+        }
+        break;
+
+    case SSD1306_ADDR:
+        // byte de controle 0x40 seguido de dados; o quadro pode vir por página
+        if (src[0] == 0x40) {
+            static size_t oled_bytes;
+            oled_bytes += len - 1;
+            for (; oled_bytes >= OLED_FRAME_BYTES; oled_bytes -= OLED_FRAME_BYTES) {
+                sim_stats.oled_frames++;
+            }
+        }
+        break;
+    }
+    return (int) len;
+}
+
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop) {
+    (void) nostop;
+
+    if (!i2c_present(addr)) {
+        i2c_spend(i2c, 0);
+        sim_stats.i2c_nacks++;
+        return PICO_ERROR_GENERIC;
+    }
+    i2c_spend(i2c, len);
+    memset(dst, 0, len);
+
+    switch (addr) {
+    case MUX_ADDR:
+        if (len) dst[0] = mux_mask;
+        break;
+
+    case BH1750_ADDR: {
+        bh1750_model_t *d = bh1750_selected();
+        uint16_t raw = (d->powered && d->continuous) ? bh1750_raw() : 0;
+        if (len > 0) dst[0] = (uint8_t) (raw >> 8);
+        if (len > 1) dst[1] = (uint8_t) raw;
+        break;
+    }
+
+    case MPU6050_ADDR:
+        // dormindo (PWR_MGMT_1.SLEEP) os registradores de dados ficam parados
+        if ((mpu_regs[0x6B] & 0x40) == 0) {
+            mpu_sample();
+        }
+        for (size_t i = 0; i < len; i++) {
+            dst[i] = mpu_regs[(mpu_ptr + i) & 0x7f];
+        }
+        break;
+
+    case INA219_ADDR: {
+        uint16_t v = ina219_reg(ina_ptr);
+        if (len > 0) dst[0] = (uint8_t) (v >> 8);
+        if (len > 1) dst[1] = (uint8_t) v;
+        break;
+    }
+    }
+    return (int) len;
+}
+
+__attribute__((constructor))
+static void sim_i2c_init(void) {
+    mpu_regs[0x6B] = 0x40;   // MPU6050 liga em sleep
+    mpu_regs[0x75] = 0x68;   // WHO_AM_I
+    ina_regs[0] = 0x399F;    // config de reset do INA219
+}
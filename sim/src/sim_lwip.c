@@ -0,0 +1,750 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <linux/sockios.h>
+#include <netdb.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "pico/cyw43_arch.h"
+#include "lwip/tcp.h"
+#include "lwip/udp.h"
+#include "lwip/stats.h"
+#include "lwip/dns.h"
+
+#include "sim.h"
+
+// Raw API do lwIP sobre sockets TCP não bloqueantes do host.
+//
+// O que importa para o firmware é reproduzido: tcp_write só enfileira (até
+// TCP_SND_BUF bytes e TCP_SND_QUEUELEN escritas), tcp_output entrega ao
+// socket, tcp_sent avisa quando o par confirmou (fila do kernel esvaziou e
+// passou SIM_NET_RTT_MS), e os callbacks rodam numa tarefa de alta
+// prioridade com o lock do lwIP, como o contexto assíncrono do cyw43.
+// Sem link Wi-Fi não há rota; dados presos por SIM_TCP_RTO_MS abortam a
+// conexão como o lwIP faz depois das retransmissões. SIM_PEER_DOWN tira o
+// servidor da rede sem RST (o host caiu): nada sai nem chega, SYNs ficam
+// sem resposta, e o lwIP só desiste depois de SIM_TCP_MAXRTX_MS com dados
+// presos; o keepalive (SOF_KEEPALIVE, keep_idle/keep_intvl/keep_cnt) sonda
+// uma conexão ociosa e a aborta quando as sondas ficam sem resposta. Ao
+// voltar, o servidor não conhece mais a conexão e responde com RST. Escritas sem
+// TCP_WRITE_FLAG_COPY guardam a referência: se os bytes mudarem antes da
+// confirmação (o lwIP retransmitiria lixo), a simulação aborta.
+//
+// UDP: cada udp_send vira um datagrama no socket do host; sem link, ou com
+// a perda sorteada por SIM_UDP_LOSS (%), ele some sem erro, como no rádio.
+//
+// DNS: nomes de SIM_DNS_HOSTS ("nome=ip,...") e os terminados em .local
+// (mDNS) vêm só dessa tabela; os outros, do resolvedor do host. A resposta
+// chega SIM_DNS_MS depois (sem link, falha) e fica no cache por
+// SIM_DNS_TTL_S, como a tabela do lwIP.
+
+#define PUMP_PERIOD_MS   2
+#define PUMP_PRIORITY    (configMAX_PRIORITIES - 2)
+#define FAST_TIMER_MS    250
+#define SLOW_TIMER_MS    500
+#define RX_CHUNK         2048
+
+const ip4_addr_t ip4_addr_any = { 0 };
+
+static struct tcp_pcb *pcbs;
+
+// contadores que o firmware lê (net_health): cada tcp_write ocupa um
+// segmento (e, sem cópia, um pbuf de referência; com cópia, heap), cada
+// recepção um pbuf do pool
+static struct stats_mem memp_stats[MEMP_MAX];
+struct stats_ lwip_stats = {
+    .memp = { &memp_stats[MEMP_TCP_SEG], &memp_stats[MEMP_PBUF], &memp_stats[MEMP_PBUF_POOL] },
+};
+
+static void stats_use(struct stats_mem *m, int32_t n) {
+    m->used += (u32_t) n;
+    if (m->used > m->max) m->max = m->used;
+}
+
+// escrita confirmada ou descartada: devolve o que ela ocupava
+static void rec_release(const tx_rec_t *r) {
+    stats_use(lwip_stats.memp[MEMP_TCP_SEG], -1);
+    if (r->ref) stats_use(lwip_stats.memp[MEMP_PBUF], -1);
+    else stats_use(&lwip_stats.mem, -(int32_t) r->len);
+}
+
+struct udp_pcb {
+    struct udp_pcb *next;
+    int fd;
+    bool dead;
+    udp_recv_fn recv;
+    void *recv_arg;
+    ip_addr_t remote;
+    u16_t remote_port;
+};
+
+static struct udp_pcb *udp_pcbs;
+
+/* ------------------- ip -------------------- */
+
+int ip4addr_aton(const char *cp, ip4_addr_t *addr) {
+    struct in_addr a;
+    if (inet_aton(cp, &a) == 0) return 0;
+    if (addr) addr->addr = a.s_addr;
+    return 1;
+}
+
+char *ip4addr_ntoa(const ip4_addr_t *addr) {
+    static char buf[16];
+    struct in_addr a = { addr->addr };
+    inet_ntop(AF_INET, &a, buf, sizeof(buf));
+    return buf;
+}
+
+void netif_set_addr(struct netif *netif, const ip4_addr_t *ipaddr,
+                    const ip4_addr_t *netmask, const ip4_addr_t *gw) {
+    netif->ip_addr = ipaddr ? *ipaddr : ip4_addr_any;
+    netif->netmask = netmask ? *netmask : ip4_addr_any;
+    netif->gw = gw ? *gw : ip4_addr_any;
+}
+
+/* ------------------ pbuf ------------------- */
+
+static struct pbuf *pbuf_from(const void *data, u16_t len) {
+    struct pbuf *p = malloc(sizeof(*p) + len);
+    if (!p) return NULL;
+    p->next = NULL;
+    p->payload = p + 1;
+    p->len = p->tot_len = len;
+    p->type_internal = PBUF_POOL;
+    memcpy(p->payload, data, len);
+    stats_use(lwip_stats.memp[MEMP_PBUF_POOL], 1);
+    return p;
+}
+
+struct pbuf *pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type) {
+    (void) layer;
+    struct pbuf *p = malloc(sizeof(*p) + length);
+    if (!p) return NULL;
+    p->next = NULL;
+    p->payload = p + 1;
+    p->len = p->tot_len = length;
+    p->type_internal = (u8_t) type;
+    if (type == PBUF_POOL) stats_use(lwip_stats.memp[MEMP_PBUF_POOL], 1);
+    return p;
+}
+
+err_t pbuf_take(struct pbuf *buf, const void *dataptr, u16_t len) {
+    if (len > buf->tot_len) return ERR_ARG;
+    memcpy(buf->payload, dataptr, len);
+    return ERR_OK;
+}
+
+u8_t pbuf_free(struct pbuf *p) {
+    u8_t n = 0;
+    while (p) {
+        struct pbuf *next = p->next;
+        if (p->type_internal == PBUF_POOL) stats_use(lwip_stats.memp[MEMP_PBUF_POOL], -1);
+        free(p);
+        p = next;
+        n++;
+    }
+    return n;
+}
+
+u16_t pbuf_copy_partial(const struct pbuf *p, void *dataptr, u16_t len, u16_t offset) {
+    u16_t copied = 0;
+    for (; p && copied < len; p = p->next) {
+        if (offset >= p->len) {
+            offset -= p->len;
+            continue;
+        }
+        u16_t n = p->len - offset;
+        if (n > len - copied) n = len - copied;
+        memcpy((uint8_t *) dataptr + copied, (const uint8_t *) p->payload + offset, n);
+        copied += n;
+        offset = 0;
+    }
+    return copied;
+}
+
+/* ------------------- tcp ------------------- */
+
+// há rota até o servidor: link em pé e o host dele na rede
+static bool peer_reachable(void) {
+    return sim_wifi_link_up() && !sim_env_window("SIM_PEER_DOWN");
+}
+
+static void pcb_kill(struct tcp_pcb *pcb) {
+    while (pcb->rec_count) {
+        rec_release(&pcb->recs[pcb->rec_head]);
+        pcb->rec_head = (pcb->rec_head + 1) % TCP_SND_QUEUELEN;
+        pcb->rec_count--;
+    }
+    if (pcb->fd >= 0) {
+        close(pcb->fd);
+        pcb->fd = -1;
+    }
+    pcb->state = PCB_DEAD;
+}
+
+// erro fatal: como no lwIP, o pcb já não existe quando o callback roda
+static void pcb_fail(struct tcp_pcb *pcb, err_t err) {
+    tcp_err_fn errf = pcb->errf;
+    void *arg = pcb->arg;
+    pcb_kill(pcb);
+    if (errf) errf(arg, err);
+}
+
+struct tcp_pcb *tcp_new_ip_type(u8_t type) {
+    (void) type;
+    struct tcp_pcb *pcb = calloc(1, sizeof(*pcb));
+    if (!pcb) return NULL;
+    pcb->fd = -1;
+    pcb->state = PCB_NEW;
+    // padrões do lwIP (TCP_KEEPIDLE_DEFAULT etc.): 2 h ociosa até sondar
+    pcb->keep_idle = 7200000;
+    pcb->keep_intvl = 75000;
+    pcb->keep_cnt = 9;
+    pcb->next = pcbs;
+    pcbs = pcb;
+    return pcb;
+}
+
+struct tcp_pcb *tcp_new(void) {
+    return tcp_new_ip_type(IPADDR_TYPE_V4);
+}
+
+void tcp_arg(struct tcp_pcb *pcb, void *arg) { pcb->arg = arg; }
+void tcp_err(struct tcp_pcb *pcb, tcp_err_fn err) { pcb->errf = err; }
+void tcp_sent(struct tcp_pcb *pcb, tcp_sent_fn sent) { pcb->sent = sent; }
+void tcp_recv(struct tcp_pcb *pcb, tcp_recv_fn recv) { pcb->recv = recv; }
+
+void tcp_poll(struct tcp_pcb *pcb, tcp_poll_fn poll, u8_t interval) {
+    pcb->poll = poll;
+    pcb->poll_interval = interval;
+}
+
+void tcp_nagle_disable(struct tcp_pcb *pcb) { (void) pcb; }
+void tcp_nagle_enable(struct tcp_pcb *pcb) { (void) pcb; }
+
+err_t tcp_connect(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port, tcp_connected_fn connected) {
+    if (pcb->state != PCB_NEW) return ERR_ISCONN;
+    if (!sim_wifi_link_up()) return ERR_RTE;
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (fd < 0) return ERR_MEM;
+
+    struct sockaddr_in sa = { 0 };
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(port);
+    sa.sin_addr.s_addr = ipaddr->addr;
+
+    if (connect(fd, (struct sockaddr *) &sa, sizeof(sa)) < 0 && errno != EINPROGRESS) {
+        close(fd);
+        return ERR_RTE;
+    }
+
+    pcb->fd = fd;
+    pcb->connected = connected;
+    pcb->state = PCB_CONNECTING;
+    sim_stats.tcp_connects++;
+    lwip_stats.mib2.tcpactiveopens++;
+    return ERR_OK;
+}
+
+u16_t tcp_sndbuf(const struct tcp_pcb *pcb) {
+    return (u16_t) (TCP_SND_BUF - (pcb->written - pcb->acked));
+}
+
+u16_t tcp_sndqueuelen(const struct tcp_pcb *pcb) {
+    return (u16_t) pcb->rec_count;
+}
+
+static uint32_t ref_checksum(const void *data, u16_t len) {
+    const uint8_t *p = data;
+    uint32_t h = 2166136261u;   // FNV-1a
+    for (u16_t i = 0; i < len; i++) {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h;
+}
+
+// MORE só adia o envio (igual ao lwIP sem Nagle); sem COPY os dados ainda
+// são copiados aqui, mas a referência é conferida na confirmação
+err_t tcp_write(struct tcp_pcb *pcb, const void *dataptr, u16_t len, u8_t apiflags) {
+    sim_stats.tcp_writes++;
+    if (pcb->state != PCB_CONNECTED && pcb->state != PCB_CONNECTING) return ERR_CONN;
+    if (len == 0) return ERR_OK;
+    if (len > tcp_sndbuf(pcb) || pcb->rec_count == TCP_SND_QUEUELEN) return ERR_MEM;
+
+    memcpy(pcb->tx + pcb->tx_len, dataptr, len);
+    pcb->tx_len += len;
+    pcb->written += len;
+
+    tx_rec_t *r = &pcb->recs[(pcb->rec_head + pcb->rec_count++) % TCP_SND_QUEUELEN];
+    r->end = pcb->written;
+    r->sent_us = 0;
+    r->len = len;
+    r->ref = NULL;
+    stats_use(lwip_stats.memp[MEMP_TCP_SEG], 1);
+    if (apiflags & TCP_WRITE_FLAG_COPY) {
+        sim_stats.tcp_copy_bytes += len;
+        stats_use(&lwip_stats.mem, len);
+    }
+    else {
+        r->ref = dataptr;
+        r->ref_len = len;
+        r->ref_sum = ref_checksum(dataptr, len);
+        stats_use(lwip_stats.memp[MEMP_PBUF], 1);
+    }
+    return ERR_OK;
+}
+
+// entrega ao socket o que estiver enfileirado
+static void pcb_flush(struct tcp_pcb *pcb) {
+    if (pcb->state != PCB_CONNECTED || pcb->tx_len == 0 || !peer_reachable()) return;
+
+    ssize_t n = send(pcb->fd, pcb->tx, pcb->tx_len, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (n <= 0) return;   // socket cheio: tenta no próximo ciclo
+
+    memmove(pcb->tx, pcb->tx + n, pcb->tx_len - (uint32_t) n);
+    pcb->tx_len -= (uint32_t) n;
+    pcb->flushed += (uint32_t) n;
+
+    sim_stats.tcp_segments += ((uint32_t) n + TCP_MSS - 1) / TCP_MSS;
+    lwip_stats.mib2.tcpoutsegs += ((uint32_t) n + TCP_MSS - 1) / TCP_MSS;
+    sim_stats.tcp_tx_bytes += (uint64_t) n;
+
+    uint64_t now = sim_now_us();
+    for (uint32_t i = 0; i < pcb->rec_count; i++) {
+        tx_rec_t *r = &pcb->recs[(pcb->rec_head + i) % TCP_SND_QUEUELEN];
+        if (r->sent_us == 0 && (int32_t) (pcb->flushed - r->end) >= 0) r->sent_us = now;
+    }
+}
+
+err_t tcp_output(struct tcp_pcb *pcb) {
+    sim_stats.tcp_outputs++;
+    if (pcb->state != PCB_CONNECTED && pcb->state != PCB_CONNECTING) return ERR_CONN;
+    pcb_flush(pcb);
+    return ERR_OK;
+}
+
+void tcp_recved(struct tcp_pcb *pcb, u16_t len) {
+    (void) pcb;
+    (void) len;
+}
+
+err_t tcp_close(struct tcp_pcb *pcb) {
+    if (pcb->state == PCB_CONNECTED) pcb_flush(pcb);
+    pcb_kill(pcb);
+    return ERR_OK;
+}
+
+void tcp_abort(struct tcp_pcb *pcb) {
+    if (pcb->state == PCB_DEAD) return;
+    pcb_fail(pcb, ERR_ABRT);
+}
+
+/* ------------------- udp ------------------- */
+
+struct udp_pcb *udp_new_ip_type(u8_t type) {
+    (void) type;
+    struct udp_pcb *pcb = calloc(1, sizeof(*pcb));
+    if (!pcb) return NULL;
+    pcb->fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    if (pcb->fd < 0) {
+        free(pcb);
+        return NULL;
+    }
+    pcb->next = udp_pcbs;
+    udp_pcbs = pcb;
+    return pcb;
+}
+
+struct udp_pcb *udp_new(void) {
+    return udp_new_ip_type(IPADDR_TYPE_V4);
+}
+
+// liberado no fim do ciclo de bombeamento, como os pcbs TCP
+void udp_remove(struct udp_pcb *pcb) {
+    pcb->dead = true;
+    pcb->recv = NULL;
+}
+
+err_t udp_connect(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port) {
+    struct sockaddr_in sa = { 0 };
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(port);
+    sa.sin_addr.s_addr = ipaddr->addr;
+    if (connect(pcb->fd, (struct sockaddr *) &sa, sizeof(sa)) < 0) return ERR_RTE;
+
+    pcb->remote = *ipaddr;
+    pcb->remote_port = port;
+    return ERR_OK;
+}
+
+void udp_disconnect(struct udp_pcb *pcb) {
+    struct sockaddr sa = { .sa_family = AF_UNSPEC };
+    connect(pcb->fd, &sa, sizeof(sa));
+    pcb->remote_port = 0;
+}
+
+void udp_recv(struct udp_pcb *pcb, udp_recv_fn recv, void *recv_arg) {
+    pcb->recv = recv;
+    pcb->recv_arg = recv_arg;
+}
+
+err_t udp_send(struct udp_pcb *pcb, struct pbuf *p) {
+    if (pcb->remote_port == 0) return ERR_CONN;
+    if (!sim_wifi_link_up()) return ERR_RTE;
+
+    // perda no ar: para o app o envio deu certo
+    static unsigned seed = 1;
+    if ((unsigned) rand_r(&seed) % 100 < sim_env_u32("SIM_UDP_LOSS", 0)) {
+        sim_stats.udp_lost++;
+        return ERR_OK;
+    }
+
+    uint8_t buf[2048];
+    u16_t len = pbuf_copy_partial(p, buf, sizeof(buf), 0);
+    if (send(pcb->fd, buf, len, MSG_DONTWAIT | MSG_NOSIGNAL) < 0) {
+        // porta fechada do outro lado (ICMP): o lwIP não reporta nada
+        sim_stats.udp_lost++;
+        return ERR_OK;
+    }
+    sim_stats.udp_sends++;
+    sim_stats.udp_tx_bytes += len;
+    return ERR_OK;
+}
+
+static void udp_check_rx(struct udp_pcb *pcb) {
+    uint8_t buf[RX_CHUNK];
+    ssize_t n;
+    while ((n = recv(pcb->fd, buf, sizeof(buf), MSG_DONTWAIT)) >= 0) {
+        // sem link nada chega
+        if (!pcb->recv || !sim_wifi_link_up()) continue;
+        struct pbuf *p = pbuf_from(buf, (u16_t) n);
+        if (p) pcb->recv(pcb->recv_arg, pcb, p, &pcb->remote, pcb->remote_port);
+    }
+}
+
+static void udp_reap(void) {
+    struct udp_pcb **pp = &udp_pcbs;
+    while (*pp) {
+        struct udp_pcb *pcb = *pp;
+        if (pcb->dead) {
+            *pp = pcb->next;
+            close(pcb->fd);
+            free(pcb);
+        }
+        else {
+            pp = &pcb->next;
+        }
+    }
+}
+
+/* ------------------- dns ------------------- */
+
+#define DNS_TABLE   8
+
+typedef struct {
+    char name[64];
+    ip_addr_t addr;
+    uint64_t expires_us;     // cache: válido até aqui (0 = livre)
+    uint64_t due_us;         // consulta: responde em (0 = nenhuma)
+    dns_found_callback found;
+    void *arg;
+} dns_entry_t;
+
+static dns_entry_t dns_table[DNS_TABLE];
+
+// SIM_DNS_HOSTS; false se o nome não está lá
+static bool dns_hosts_lookup(const char *name, ip_addr_t *addr) {
+    const char *p = getenv("SIM_DNS_HOSTS");
+    size_t n = strlen(name);
+    while (p && *p) {
+        const char *eq = strchr(p, '=');
+        if (!eq) break;
+        const char *end = strchr(eq, ',');
+        char ip[16] = { 0 };
+        size_t ip_len = end ? (size_t) (end - eq - 1) : strlen(eq + 1);
+        if ((size_t) (eq - p) == n && strncmp(p, name, n) == 0 && ip_len < sizeof(ip)) {
+            memcpy(ip, eq + 1, ip_len);
+            return ip4addr_aton(ip, addr);
+        }
+        p = end ? end + 1 : NULL;
+    }
+    return false;
+}
+
+static bool dns_lookup(const char *name, ip_addr_t *addr) {
+    if (dns_hosts_lookup(name, addr)) return true;
+    size_t n = strlen(name);
+    if (n > 6 && strcmp(name + n - 6, ".local") == 0) return false;
+
+    struct addrinfo hints = { .ai_family = AF_INET, .ai_socktype = SOCK_STREAM };
+    struct addrinfo *res;
+    if (getaddrinfo(name, NULL, &hints, &res) != 0) return false;
+    addr->addr = ((struct sockaddr_in *) res->ai_addr)->sin_addr.s_addr;
+    freeaddrinfo(res);
+    return true;
+}
+
+err_t dns_gethostbyname(const char *hostname, ip_addr_t *addr, dns_found_callback found, void *callback_arg) {
+    if (!hostname || !*hostname || strlen(hostname) >= sizeof(dns_table[0].name)) return ERR_ARG;
+    if (ip4addr_aton(hostname, addr)) return ERR_OK;
+
+    uint64_t now = sim_now_us();
+    dns_entry_t *slot = NULL;
+    for (int i = 0; i < DNS_TABLE; i++) {
+        dns_entry_t *d = &dns_table[i];
+        if (strcmp(d->name, hostname) == 0) {
+            if (d->due_us == 0 && now < d->expires_us) {
+                *addr = d->addr;
+                return ERR_OK;
+            }
+            slot = d;
+            break;
+        }
+        if (!slot && d->due_us == 0 && now >= d->expires_us) slot = d;
+    }
+    if (!slot) return ERR_MEM;
+
+    if (slot->due_us == 0) {
+        strcpy(slot->name, hostname);
+        slot->due_us = now + (uint64_t) sim_env_u32("SIM_DNS_MS", 30) * 1000;
+    }
+    slot->found = found;
+    slot->arg = callback_arg;
+    return ERR_INPROGRESS;
+}
+
+static void dns_check(void) {
+    uint64_t now = sim_now_us();
+    for (int i = 0; i < DNS_TABLE; i++) {
+        dns_entry_t *d = &dns_table[i];
+        if (d->due_us == 0 || now < d->due_us) continue;
+
+        d->due_us = 0;
+        bool ok = sim_wifi_link_up() && dns_lookup(d->name, &d->addr);
+        d->expires_us = ok ? now + (uint64_t) sim_env_u32("SIM_DNS_TTL_S", 300) * 1000000 : 0;
+        if (d->found) d->found(d->name, ok ? &d->addr : NULL, d->arg);
+        if (!ok) d->name[0] = '\0';
+    }
+}
+
+/* -------------- bombeamento ---------------- */
+
+static void pcb_check_connect(struct tcp_pcb *pcb) {
+    struct pollfd pfd = { pcb->fd, POLLOUT, 0 };
+    if (poll(&pfd, 1, 0) <= 0) return;
+
+    int so_err = 0;
+    socklen_t sl = sizeof(so_err);
+    getsockopt(pcb->fd, SOL_SOCKET, SO_ERROR, &so_err, &sl);
+    if (so_err != 0) {
+        // RST em resposta ao SYN: o lwIP só chama o callback de erro
+        lwip_stats.mib2.tcpattemptfails++;
+        pcb_fail(pcb, ERR_RST);
+        return;
+    }
+
+    pcb->state = PCB_CONNECTED;
+    pcb->last_rx_us = sim_now_us();
+    if (pcb->connected && pcb->connected(pcb->arg, pcb, ERR_OK) == ERR_ABRT) {
+        pcb_kill(pcb);
+    }
+}
+
+// confirma as escritas que o par já recebeu
+static void pcb_check_acks(struct tcp_pcb *pcb) {
+    int outq = 0;
+    if (ioctl(pcb->fd, SIOCOUTQ, &outq) < 0) return;
+
+    uint32_t delivered = pcb->flushed - (uint32_t) outq;
+    uint64_t rtt_us = (uint64_t) sim_env_u32("SIM_NET_RTT_MS", 5) * 1000;
+    uint64_t now = sim_now_us();
+    uint32_t acked_to = pcb->acked;
+
+    while (pcb->rec_count) {
+        tx_rec_t *r = &pcb->recs[pcb->rec_head];
+        if (r->sent_us == 0 || now < r->sent_us + rtt_us || (int32_t) (delivered - r->end) < 0) break;
+        if (r->ref && ref_checksum(r->ref, r->ref_len) != r->ref_sum) {
+            fprintf(stderr, "sim_lwip: dados escritos sem cópia mudaram antes da confirmação (%p, %u bytes)\n",
+                    r->ref, r->ref_len);
+            abort();
+        }
+        acked_to = r->end;
+        rec_release(r);
+        pcb->rec_head = (pcb->rec_head + 1) % TCP_SND_QUEUELEN;
+        pcb->rec_count--;
+    }
+
+    if (acked_to != pcb->acked) {
+        pcb->last_rx_us = now;
+        pcb->keep_cnt_sent = 0;
+        u16_t len = (u16_t) (acked_to - pcb->acked);
+        pcb->acked = acked_to;
+        if (pcb->sent && pcb->sent(pcb->arg, pcb, len) == ERR_ABRT) {
+            pcb_kill(pcb);
+        }
+    }
+}
+
+static void pcb_check_rx(struct tcp_pcb *pcb) {
+    uint8_t buf[RX_CHUNK];
+    ssize_t n = recv(pcb->fd, buf, sizeof(buf), MSG_DONTWAIT);
+
+    if (n < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) pcb_fail(pcb, ERR_RST);
+        return;
+    }
+
+    if (n == 0) {
+        // FIN do par; sem callback de recepção o lwIP só fecha o lado dele
+        pcb->state = PCB_CLOSED;
+        if (pcb->recv) pcb->recv(pcb->arg, pcb, NULL, ERR_OK);
+        return;
+    }
+
+    pcb->last_rx_us = sim_now_us();
+    pcb->keep_cnt_sent = 0;
+    if (pcb->recv) {
+        struct pbuf *p = pbuf_from(buf, (u16_t) n);
+        if (p && pcb->recv(pcb->arg, pcb, p, ERR_OK) == ERR_ABRT) {
+            pcb_kill(pcb);
+        }
+    }
+}
+
+// sem rota, os dados (ou o SYN) ficam presos e o lwIP retransmite com o RTO
+// dobrando (1 s, 2 s, 4 s...) até desistir: SIM_TCP_RTO_MS sem link, ou
+// SIM_TCP_MAXRTX_MS com o link em pé e o servidor fora da rede
+static void pcb_check_stall(struct tcp_pcb *pcb, bool reachable) {
+    if (reachable || (pcb->state == PCB_CONNECTED && pcb->written == pcb->acked)) {
+        pcb->stalled_since_us = 0;
+        return;
+    }
+
+    uint64_t now = sim_now_us();
+    if (pcb->stalled_since_us == 0) {
+        pcb->stalled_since_us = now;
+        pcb->rexmit_wait_ms = 1000;
+        pcb->rexmit_at_us = now + 1000000;
+    }
+    else if (now >= pcb->rexmit_at_us) {
+        lwip_stats.mib2.tcpretranssegs++;
+        pcb->rexmit_wait_ms *= 2;
+        pcb->rexmit_at_us = now + (uint64_t) pcb->rexmit_wait_ms * 1000;
+    }
+    uint32_t limit_ms = sim_wifi_link_up() ? sim_env_u32("SIM_TCP_MAXRTX_MS", 120000)
+                                           : sim_env_u32("SIM_TCP_RTO_MS", 8000);
+    if (now - pcb->stalled_since_us > (uint64_t) limit_ms * 1000) {
+        pcb_fail(pcb, ERR_ABRT);
+    }
+}
+
+// keepalive (timer lento): sem nada do par por keep_idle, uma sonda a cada
+// keep_intvl; com keep_cnt sem resposta, aborta como o lwIP
+static void pcb_check_keepalive(struct tcp_pcb *pcb, bool reachable) {
+    if (!ip_get_option(pcb, SOF_KEEPALIVE)) return;
+
+    uint64_t now = sim_now_us();
+    uint64_t idle_ms = (now - pcb->last_rx_us) / 1000;
+    if (idle_ms >= pcb->keep_idle + (uint64_t) pcb->keep_cnt * pcb->keep_intvl) {
+        pcb_fail(pcb, ERR_ABRT);
+    }
+    else if (idle_ms >= pcb->keep_idle + (uint64_t) pcb->keep_cnt_sent * pcb->keep_intvl) {
+        sim_stats.tcp_keepalives++;
+        lwip_stats.mib2.tcpoutsegs++;
+        if (reachable) {
+            // o par responde à sonda na hora
+            pcb->last_rx_us = now;
+            pcb->keep_cnt_sent = 0;
+        }
+        else {
+            pcb->keep_cnt_sent++;
+        }
+    }
+}
+
+static void pcb_reap(void) {
+    struct tcp_pcb **pp = &pcbs;
+    while (*pp) {
+        struct tcp_pcb *pcb = *pp;
+        if (pcb->state == PCB_DEAD) {
+            *pp = pcb->next;
+            free(pcb);
+        }
+        else {
+            pp = &pcb->next;
+        }
+    }
+}
+
+static void lwip_pump_task(void *params) {
+    (void) params;
+    TickType_t last_fast = xTaskGetTickCount();
+    TickType_t last_slow = last_fast;
+
+    while (true) {
+        vTaskDelay(pdMS_TO_TICKS(PUMP_PERIOD_MS));
+
+        TickType_t now = xTaskGetTickCount();
+        bool fast = (now - last_fast) >= pdMS_TO_TICKS(FAST_TIMER_MS);
+        bool slow = (now - last_slow) >= pdMS_TO_TICKS(SLOW_TIMER_MS);
+        if (fast) last_fast = now;
+        if (slow) last_slow = now;
+
+        cyw43_arch_lwip_begin();
+        bool peer_down = sim_env_window("SIM_PEER_DOWN");
+        bool reachable = sim_wifi_link_up() && !peer_down;
+        for (struct tcp_pcb *pcb = pcbs; pcb; pcb = pcb->next) {
+            if (pcb->state == PCB_CONNECTED && peer_down) {
+                pcb->peer_lost = 1;
+            }
+            else if (pcb->state == PCB_CONNECTED && pcb->peer_lost) {
+                // o servidor voltou sem saber da conexão: RST no próximo segmento
+                pcb_fail(pcb, ERR_RST);
+            }
+
+            if (pcb->state == PCB_CONNECTING && !peer_down) pcb_check_connect(pcb);
+
+            if (pcb->state == PCB_CONNECTED && !peer_down) {
+                if (fast) pcb_flush(pcb);
+                pcb_check_acks(pcb);
+            }
+            if (pcb->state == PCB_CONNECTED && !peer_down) pcb_check_rx(pcb);
+            if (pcb->state == PCB_CONNECTED || pcb->state == PCB_CONNECTING) pcb_check_stall(pcb, reachable);
+            if (slow && pcb->state == PCB_CONNECTED) pcb_check_keepalive(pcb, reachable);
+
+            // timer lento do lwIP: poll a cada `interval` x 500 ms
+            if (slow && pcb->poll && pcb->poll_interval &&
+                (pcb->state == PCB_CONNECTING || pcb->state == PCB_CONNECTED) &&
+                ++pcb->poll_ticks >= pcb->poll_interval) {
+                pcb->poll_ticks = 0;
+                pcb->poll(pcb->arg, pcb);
+            }
+        }
+        pcb_reap();
+
+        for (struct udp_pcb *pcb = udp_pcbs; pcb; pcb = pcb->next) {
+            if (!pcb->dead) udp_check_rx(pcb);
+        }
+        udp_reap();
+        dns_check();
+        cyw43_arch_lwip_end();
+    }
+}
+
+void sim_lwip_start(void) {
+    static bool started;
+    if (started) return;
+    started = true;
+    xTaskCreate(lwip_pump_task, "lwip", configMINIMAL_STACK_SIZE * 4, NULL, PUMP_PRIORITY, NULL);
+}
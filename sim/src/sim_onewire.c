@@ -0,0 +1,285 @@
+#include <math.h>
+
+#include "hardware/pio.h"
+
+#include "sim.h"
+
+// PIO rodando o programa onewire, reduzido ao que ele faz no fio: cada bit
+// da palavra é um slot de 70 µs, o reset leva 960 µs. O barramento tem um
+// DS18B20 que responde a SEARCH/MATCH/SKIP/READ ROM, CONVERT_T (750 ms em
+// 12 bits) e READ_SCRATCHPAD com CRC
+
+#define OW_SLOT_US   70
+#define OW_RESET_US  960
+#define OW_FIFO_LEN  4
+
+typedef struct {
+    bool claimed;
+    uint pin;
+    uint bits;                    // bits por palavra (autopush/autopull)
+    uint32_t rx[OW_FIFO_LEN];
+    uint rx_count;
+} sim_sm_t;
+
+struct pio_hw {
+    uint used;                    // instruções ocupadas
+    sim_sm_t sm[NUM_PIO_STATE_MACHINES];
+};
+
+pio_hw_t sim_pio0_hw;
+pio_hw_t sim_pio1_hw;
+
+/* ------------------ DS18B20 ----------------- */
+
+typedef enum {
+    DS_IDLE,        // sem reset: ignora o barramento
+    DS_ROM_CMD,     // recebendo o comando de ROM
+    DS_MATCH,       // recebendo os 64 bits do MATCH ROM
+    DS_SEARCH,      // SEARCH ROM: bit, complemento, direção
+    DS_TX,          // transmitindo tx_buf (READ ROM, scratchpad)
+    DS_FUNC_CMD,    // recebendo o comando de função
+} ds_state_t;
+
+static struct {
+    uint64_t rom;
+    ds_state_t state;
+    uint32_t nbits;
+    uint64_t shift;
+    uint8_t search_phase;
+    uint8_t tx_buf[9];
+    uint32_t tx_bits;
+    uint64_t conv_done_us;        // 0 = nenhuma conversão pendente
+    int16_t temp_raw;
+} ds;
+
+static uint8_t ow_crc8(const uint8_t *p, int n) {
+    uint8_t crc = 0;
+    while (n--) {
+        uint8_t b = *p++;
+        for (int i = 0; i < 8; i++) {
+            uint8_t mix = (crc ^ b) & 1;
+            crc >>= 1;
+            if (mix) crc ^= 0x8C;
+            b >>= 1;
+        }
+    }
+    return crc;
+}
+
+static void ds_load_scratchpad(void) {
+    ds.tx_buf[0] = (uint8_t) ds.temp_raw;
+    ds.tx_buf[1] = (uint8_t) (ds.temp_raw >> 8);
+    ds.tx_buf[2] = 0x4B;    // TH
+    ds.tx_buf[3] = 0x46;    // TL
+    ds.tx_buf[4] = 0x7F;    // 12 bits
+    ds.tx_buf[5] = 0xFF;
+    ds.tx_buf[6] = 0x0C;
+    ds.tx_buf[7] = 0x10;
+    ds.tx_buf[8] = ow_crc8(ds.tx_buf, 8);
+    ds.tx_bits = 72;
+    ds.nbits = 0;
+    ds.state = DS_TX;
+}
+
+static void ds_function(uint8_t cmd) {
+    switch (cmd) {
+    case 0x44: {   // CONVERT_T
+        double t = 24.0 + 6.0 * sin((double) sim_now_us() / 1e6 / 300.0);
+        ds.temp_raw = (int16_t) lround(t * 16.0);
+        ds.conv_done_us = sim_now_us() + 750000;
+        ds.state = DS_IDLE;
+        break;
+    }
+    case 0xBE:     // READ_SCRATCHPAD
+        ds_load_scratchpad();
+        break;
+    default:
+        ds.state = DS_IDLE;
+        break;
+    }
+}
+
+static void ds_rom(uint8_t cmd) {
+    ds.nbits = 0;
+    ds.shift = 0;
+    switch (cmd) {
+    case 0xF0:     // SEARCH_ROM
+        ds.search_phase = 0;
+        ds.state = DS_SEARCH;
+        break;
+    case 0x55:     // MATCH_ROM
+        ds.state = DS_MATCH;
+        break;
+    case 0xCC:     // SKIP_ROM
+        ds.state = DS_FUNC_CMD;
+        break;
+    case 0x33:     // READ_ROM
+        for (int i = 0; i < 8; i++) ds.tx_buf[i] = (uint8_t) (ds.rom >> (8 * i));
+        ds.tx_bits = 64;
+        ds.state = DS_TX;
+        break;
+    default:
+        ds.state = DS_IDLE;
+        break;
+    }
+}
+
+// recebe 8 bits do mestre; devolve true com o byte completo
+static bool ds_collect(int bit, uint8_t *byte) {
+    ds.shift |= (uint64_t) (bit & 1) << ds.nbits;
+    if (++ds.nbits < 8) return false;
+    *byte = (uint8_t) ds.shift;
+    ds.nbits = 0;
+    ds.shift = 0;
+    return true;
+}
+
+// um slot: o mestre escreve `bit` (1 = também é slot de leitura) e lê o fio
+static int ds_slot(int bit) {
+    int line = bit;   // o pull-up segura 1 se ninguém puxar
+    uint8_t byte;
+
+    switch (ds.state) {
+    case DS_IDLE:
+        // leitura depois do CONVERT_T: 0 enquanto converte
+        if (ds.conv_done_us && bit && sim_now_us() < ds.conv_done_us) line = 0;
+        break;
+
+    case DS_ROM_CMD:
+        if (ds_collect(bit, &byte)) ds_rom(byte);
+        break;
+
+    case DS_MATCH:
+        ds.shift |= (uint64_t) (bit & 1) << ds.nbits;
+        if (++ds.nbits == 64) {
+            ds.state = (ds.shift == ds.rom) ? DS_FUNC_CMD : DS_IDLE;
+            ds.nbits = 0;
+            ds.shift = 0;
+        }
+        break;
+
+    case DS_FUNC_CMD:
+        if (ds_collect(bit, &byte)) ds_function(byte);
+        break;
+
+    case DS_SEARCH: {
+        int rom_bit = (int) ((ds.rom >> ds.nbits) & 1);
+        if (ds.search_phase == 0) {
+            line = bit & rom_bit;
+            ds.search_phase = 1;
+        }
+        else if (ds.search_phase == 1) {
+            line = bit & !rom_bit;
+            ds.search_phase = 2;
+        }
+        else {
+            // direção escolhida pelo mestre: quem não bate sai da busca
+            ds.search_phase = 0;
+            if (bit != rom_bit) ds.state = DS_IDLE;
+            else if (++ds.nbits == 64) ds.state = DS_IDLE;
+        }
+        break;
+    }
+
+    case DS_TX:
+        line = bit & ((ds.tx_buf[ds.nbits / 8] >> (ds.nbits % 8)) & 1);
+        if (++ds.nbits == ds.tx_bits) ds.state = DS_IDLE;
+        break;
+    }
+    return line;
+}
+
+static bool ds_reset(void) {
+    ds.state = DS_ROM_CMD;
+    ds.nbits = 0;
+    ds.shift = 0;
+    return true;   // presença
+}
+
+__attribute__((constructor))
+static void sim_ds18b20_init(void) {
+    uint8_t rom[8] = { 0x28, 0x5A, 0x1C, 0x7E, 0x0D, 0x00, 0x00 };
+    rom[7] = ow_crc8(rom, 7);
+    for (int i = 0; i < 8; i++) ds.rom |= (uint64_t) rom[i] << (8 * i);
+    ds.temp_raw = 25 * 16;
+}
+
+/* ------------------- PIO -------------------- */
+
+static void sm_push(sim_sm_t *s, uint32_t v) {
+    if (s->rx_count < OW_FIFO_LEN) s->rx[s->rx_count++] = v;
+}
+
+bool pio_can_add_program(PIO pio, const pio_program_t *program) {
+    return pio->used + program->length <= 32;
+}
+
+uint pio_add_program(PIO pio, const pio_program_t *program) {
+    uint offset = pio->used;
+    pio->used += program->length;
+    return offset;
+}
+
+int pio_claim_unused_sm(PIO pio, bool required) {
+    (void) required;
+    for (int i = 0; i < NUM_PIO_STATE_MACHINES; i++) {
+        if (!pio->sm[i].claimed) {
+            pio->sm[i].claimed = true;
+            return i;
+        }
+    }
+    return -1;
+}
+
+void pio_gpio_init(PIO pio, uint pin) {
+    (void) pio;
+    (void) pin;
+}
+
+void sim_pio_onewire_sm_init(PIO pio, uint sm, uint offset, uint pin, uint bits_per_word) {
+    (void) offset;
+    sim_sm_t *s = &pio->sm[sm];
+    s->pin = pin;
+    s->bits = bits_per_word ? bits_per_word : 32;
+    s->rx_count = 0;
+}
+
+void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data) {
+    sim_sm_t *s = &pio->sm[sm];
+    uint32_t isr = 0;
+
+    // saída e entrada deslocadas para a direita: o primeiro bit lido acaba
+    // em 32 - bits, como no autopush do programa real
+    for (uint i = 0; i < s->bits; i++) {
+        int line = ds_slot((int) ((data >> i) & 1));
+        isr |= (uint32_t) line << (32 - s->bits + i);
+    }
+    sm_push(s, isr);
+
+    uint64_t us = (uint64_t) s->bits * OW_SLOT_US;
+    sim_stats.ow_slots += s->bits;
+    sim_stats.ow_busy_us += us;
+    busy_wait_us(us);
+}
+
+uint32_t pio_sm_get_blocking(PIO pio, uint sm) {
+    sim_sm_t *s = &pio->sm[sm];
+    if (s->rx_count == 0) return 0xffffffffu;   // na placa travaria aqui
+
+    uint32_t v = s->rx[0];
+    for (uint i = 1; i < s->rx_count; i++) s->rx[i - 1] = s->rx[i];
+    s->rx_count--;
+    return v;
+}
+
+void pio_sm_exec_wait_blocking(PIO pio, uint sm, uint instr) {
+    (void) instr;   // o firmware só executa o jmp para reset_bus
+    sim_sm_t *s = &pio->sm[sm];
+
+    // mov isr, pins: bit 0 é o pino do barramento (0 = presença)
+    sm_push(s, ds_reset() ? 0xfffffffeu : 0xffffffffu);
+
+    sim_stats.ow_resets++;
+    sim_stats.ow_busy_us += OW_RESET_US;
+    busy_wait_us(OW_RESET_US);
+}
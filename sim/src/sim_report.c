@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "sim.h"
+#include "drivers/telemetry/telemetry.h"
+#include "drivers/network/net_task.h"
+#include "drivers/network/tcp_client.h"
+#include "drivers/network/mqtt_client.h"
+
+// Relatório periódico da simulação:
+//   SIM_REPORT_S     intervalo entre relatórios (10 s; 0 = só no fim)
+//   SIM_RUN_SECONDS  encerra o processo depois deste tempo (0 = não encerra)
+//   SIM_BUTTON_S     pressiona o botão A a cada N s (0 = nunca)
+//   SIM_TELEMETRY_FORMAT  0 = JSON, 1 = binário (padrão: TELEMETRY_FORMAT)
+
+#define REPORT_PRIORITY  (configMAX_PRIORITIES - 3)
+#define BTN_A            5
+
+static void sim_print_report(void) {
+    static char buf[2048];
+
+    printf("\n[sim] ---- %lu s ----\n", (unsigned long) sim_now_s());
+    vTaskGetRunTimeStats(buf);
+    printf("[sim] tarefa\t\ttempo\t\t%%\n%s", buf);
+
+    const sim_stats_t *s = &sim_stats;
+    printf("[sim] i2c: %lu transações, %llu bytes, %llu ms no barramento, %lu NACKs, %lu quadros OLED\n",
+           (unsigned long) s->i2c_xfers, (unsigned long long) s->i2c_bytes,
+           (unsigned long long) (s->i2c_busy_us / 1000), (unsigned long) s->i2c_nacks,
+           (unsigned long) s->oled_frames);
+    printf("[sim] 1-wire: %lu resets, %lu slots, %llu ms\n",
+           (unsigned long) s->ow_resets, (unsigned long) s->ow_slots,
+           (unsigned long long) (s->ow_busy_us / 1000));
+    printf("[sim] flash: %lu setores apagados, %lu páginas gravadas, %llu ms\n",
+           (unsigned long) s->flash_erases, (unsigned long) s->flash_programs,
+           (unsigned long long) (s->flash_busy_us / 1000));
+    printf("[sim] rede: %lu joins, %lu conexões, %lu tcp_write, %lu tcp_output, %lu segmentos, %llu bytes (%llu copiados), %lu keepalives\n",
+           (unsigned long) s->wifi_joins, (unsigned long) s->tcp_connects,
+           (unsigned long) s->tcp_writes, (unsigned long) s->tcp_outputs,
+           (unsigned long) s->tcp_segments, (unsigned long long) s->tcp_tx_bytes,
+           (unsigned long long) s->tcp_copy_bytes, (unsigned long) s->tcp_keepalives);
+    if (s->udp_sends || s->udp_lost) {
+        printf("[sim] udp: %lu datagramas, %lu perdidos, %llu bytes\n",
+               (unsigned long) s->udp_sends, (unsigned long) s->udp_lost,
+               (unsigned long long) s->udp_tx_bytes);
+    }
+#if NET_TRANSPORT != NET_TRANSPORT_UDP
+#if NET_TRANSPORT == NET_TRANSPORT_MQTT
+    const reconnect_stats_t *r = mqtt_client_reconnect_stats();
+#else
+    const reconnect_stats_t *r = tcp_client_reconnect_stats();
+#endif
+    printf("[sim] reconexão: %lu tentativas, %lu falhas, %lu adiadas, %lu disjuntor aberto\n",
+           (unsigned long) r->attempts, (unsigned long) r->failures,
+           (unsigned long) r->deferred, (unsigned long) r->trips);
+#endif
+    printf("[sim] heap livre: %u (mínimo %u)\n",
+           (unsigned) xPortGetFreeHeapSize(), (unsigned) xPortGetMinimumEverFreeHeapSize());
+    fflush(stdout);
+}
+
+static void sim_report_task(void *params) {
+    (void) params;
+
+    uint32_t report_s = sim_env_u32("SIM_REPORT_S", 10);
+    uint32_t run_s = sim_env_u32("SIM_RUN_SECONDS", 0);
+    uint32_t button_s = sim_env_u32("SIM_BUTTON_S", 0);
+    uint32_t next_report = report_s;
+    uint32_t next_button = button_s;
+
+    TickType_t last_wake = xTaskGetTickCount();
+
+    while (true) {
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(1000));
+        uint32_t now = sim_now_s();
+
+        if (button_s && now >= next_button) {
+            sim_gpio_irq(BTN_A, 0x4);   // GPIO_IRQ_EDGE_FALL
+            next_button = now + button_s;
+        }
+        if (report_s && now >= next_report) {
+            sim_print_report();
+            next_report = now + report_s;
+        }
+        if (run_s && now >= run_s) {
+            sim_print_report();
+            exit(0);
+        }
+    }
+}
+
+/* --------------- ganchos do kernel --------------- */
+
+// a tarefa de timers já roda: sobe o relatório junto com o firmware
+void vApplicationDaemonTaskStartupHook(void) {
+    telemetry_set_format((telemetry_format_t) sim_env_u32("SIM_TELEMETRY_FORMAT", TELEMETRY_FORMAT));
+    xTaskCreate(sim_report_task, "sim", configMINIMAL_STACK_SIZE * 4, NULL, REPORT_PRIORITY, NULL);
+}
+
+// sem isso a tarefa idle da porta POSIX ocupa um core do host inteiro
+void vApplicationIdleHook(void) {
+    usleep(1000);
+}
@@ -0,0 +1,123 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "pico/time.h"
+#include "pico/unique_id.h"
+#include "hardware/gpio.h"
+
+#include "sim.h"
+
+sim_stats_t sim_stats;
+
+static uint64_t sim_clock_us(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000u + (uint64_t) t.tv_nsec / 1000u;
+}
+
+static uint64_t boot_us;
+
+__attribute__((constructor))
+static void sim_time_init(void) {
+    boot_us = sim_clock_us();
+}
+
+uint64_t sim_now_us(void) {
+    return sim_clock_us() - boot_us;
+}
+
+uint32_t sim_env_u32(const char *name, uint32_t def) {
+    const char *v = getenv(name);
+    if (!v || !*v) return def;
+
+    char *end;
+    unsigned long n = strtoul(v, &end, 0);
+    return *end ? def : (uint32_t) n;
+}
+
+bool sim_env_window(const char *name) {
+    const char *spec = getenv(name);
+    if (!spec) return false;
+
+    uint32_t now = sim_now_s();
+    while (*spec) {
+        char *end;
+        unsigned long start = strtoul(spec, &end, 10);
+        if (*end != ':') return false;
+        unsigned long len = strtoul(end + 1, &end, 10);
+        if (now >= start && now < start + len) return true;
+        if (*end != ',') break;
+        spec = end + 1;
+    }
+    return false;
+}
+
+/* ---------------- pico/time ---------------- */
+
+absolute_time_t get_absolute_time(void) {
+    return sim_now_us();
+}
+
+void busy_wait_us(uint64_t us) {
+    uint64_t until = sim_clock_us() + us;
+    while (sim_clock_us() < until);
+}
+
+static bool in_task(void) {
+    return xTaskGetSchedulerState() == taskSCHEDULER_RUNNING;
+}
+
+void sleep_ms(uint32_t ms) {
+    if (in_task()) {
+        // arredonda para cima: nunca dorme menos que o pedido
+        vTaskDelay((ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS);
+        return;
+    }
+    struct timespec t = { ms / 1000, (long) (ms % 1000) * 1000000L };
+    nanosleep(&t, NULL);
+}
+
+void sleep_us(uint64_t us) {
+    if (us >= 1000) {
+        sleep_ms((uint32_t) ((us + 999) / 1000));
+    }
+    else {
+        busy_wait_us(us);
+    }
+}
+
+/* --------------- hardware/gpio -------------- */
+
+// GPIOs não têm efeito; guarda só o callback do botão
+static gpio_irq_callback_t irq_callback;
+
+void gpio_init(uint gpio) { (void) gpio; }
+void gpio_set_dir(uint gpio, bool out) { (void) gpio; (void) out; }
+void gpio_pull_up(uint gpio) { (void) gpio; }
+void gpio_set_function(uint gpio, enum gpio_function fn) { (void) gpio; (void) fn; }
+
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t event_mask, bool enabled, gpio_irq_callback_t callback) {
+    (void) gpio;
+    (void) event_mask;
+    if (enabled) {
+        irq_callback = callback;
+    }
+}
+
+void sim_gpio_irq(unsigned gpio, uint32_t events) {
+    if (irq_callback) {
+        irq_callback(gpio, events);
+    }
+}
+
+/* ------------- pico/unique_id -------------- */
+
+void pico_get_unique_board_id_string(char *id_out, uint len) {
+    const char *id = getenv("SIM_STATION_ID");
+    if (!id || !*id) id = "E6605838830F5A2B";
+    snprintf(id_out, len, "%s", id);
+}